@@ -0,0 +1,196 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: aimPreview.cpp
+//
+// Desc: Predicted path of the red ball while the player aims.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "aimPreview.h"
+#include <cmath>
+
+// longest path drawn, in table units
+const float MAX_PATH_LENGTH = 40.0f;
+
+CAimPreview::CAimPreview(void)
+{
+    m_pointCount = 0;
+    invalidate();
+}
+
+void CAimPreview::invalidate(void)
+{
+    m_valid = false;
+    m_gridBricksLeft = -1;
+    m_grid.clear();
+}
+
+void CAimPreview::update(const CGameSession& session)
+{
+    const BallState& red = session.getRedBall();
+    const BallState& white = session.getWhiteBall();
+
+    if (m_valid && m_keyRedX == red.x && m_keyRedZ == red.z &&
+        m_keyWhiteX == white.x && m_keyWhiteZ == white.z &&
+        m_keyBricksLeft == session.getBricksLeft())
+        return;
+
+    m_keyRedX = red.x;
+    m_keyRedZ = red.z;
+    m_keyWhiteX = white.x;
+    m_keyWhiteZ = white.z;
+    m_keyBricksLeft = session.getBricksLeft();
+    m_valid = true;
+
+    // the grid only changes when a brick goes away
+    if (m_gridBricksLeft != session.getBricksLeft()) {
+        int count = session.getBrickCount();
+        std::vector<float> x(count), z(count);
+        std::vector<unsigned char> alive(count);
+        for (int i = 0; i < count; i++) {
+            x[i] = session.getBrick(i).x;
+            z[i] = session.getBrick(i).z;
+            alive[i] = session.isBrickAlive(i) ? 1 : 0;
+        }
+        m_grid.build(count > 0 ? &x[0] : NULL, count > 0 ? &z[0] : NULL,
+            count > 0 ? &alive[0] : NULL, count, (float)(M_RADIUS + M_RADIUS));
+        m_gridBricksLeft = session.getBricksLeft();
+    }
+
+    trace(session);
+}
+
+// same circle test the brick grid uses, for the white ball
+static bool sweepBall(float x, float z, float dx, float dz, float cx, float cz, float reach, float* t)
+{
+    float mx = x - cx;
+    float mz = z - cz;
+    float along = mx * dx + mz * dz;
+    float c = mx * mx + mz * mz - reach * reach;
+    if (along >= 0.0f)
+        return false;
+    if (c <= 0.0f) {
+        *t = 0.0f;
+        return true;
+    }
+    float disc = along * along - c;
+    if (disc < 0.0f)
+        return false;
+    *t = -along - sqrt(disc);
+    return true;
+}
+
+void CAimPreview::trace(const CGameSession& session)
+{
+    const BallState& red = session.getRedBall();
+    const BallState& white = session.getWhiteBall();
+    const float radius = (float)M_RADIUS;
+
+    m_pointCount = 0;
+
+    float vx, vz;
+    session.getShotVelocity(&vx, &vz);
+    float speed = sqrt(vx * vx + vz * vz);
+    if (!(speed > 0.0f))
+        return;
+
+    float x = red.x;
+    float z = red.z;
+    float dx = vx / speed;
+    float dz = vz / speed;
+    float remaining = MAX_PATH_LENGTH;
+
+    // under the closed-form model without a speed floor the ball rolls out
+    if (session.getConfig().analyticMotion) {
+        double stop = motionStopDistance(session.getMotionModel(), speed);
+        if (stop < remaining)
+            remaining = (float)stop;
+    }
+
+    int hitBricks[MAX_BOUNCES + 1];
+    int hitCount = 0;
+
+    m_x[0] = x;
+    m_z[0] = z;
+    m_pointCount = 1;
+
+    for (int bounce = 0; bounce <= MAX_BOUNCES; bounce++) {
+        enum { HIT_NONE, HIT_WALL, HIT_BRICK, HIT_BALL } kind = HIT_NONE;
+        float best = remaining;
+        float nx = 0.0f, nz = 0.0f;
+        int id = -1;
+        float t;
+
+        // walls : half-planes moved in by the radius, or the segment boundary
+        if (session.hasCustomBoundary()) {
+            int segment;
+            float sx, sz;
+            if (session.getBoundary().sweep(x, z, dx, dz, radius, best, &t, &segment, &sx, &sz)) {
+                kind = HIT_WALL;
+                best = t;
+                id = segment;
+                nx = sx;
+                nz = sz;
+            }
+        }
+        else {
+            for (int i = 0; i < WALL_COUNT; i++) {
+                const WallState& w = session.getWall(i);
+                float rate = w.nx * dx + w.nz * dz;
+                if (rate >= 0.0f)
+                    continue;
+                float gap = w.nx * x + w.nz * z - w.d - radius;
+                t = gap > 0.0f ? gap / -rate : 0.0f;
+                if (t < best) {
+                    kind = HIT_WALL;
+                    best = t;
+                    id = i;
+                    nx = w.nx;
+                    nz = w.nz;
+                }
+            }
+        }
+
+        int brick;
+        if (m_grid.sweep(x, z, dx, dz, best, hitBricks, hitCount, &t, &brick) && t < best) {
+            kind = HIT_BRICK;
+            best = t;
+            id = brick;
+        }
+
+        if (sweepBall(x, z, dx, dz, white.x, white.z, radius + radius, &t) && t < best) {
+            kind = HIT_BALL;
+            best = t;
+        }
+
+        x += dx * best;
+        z += dz * best;
+        remaining -= best;
+        m_x[m_pointCount] = x;
+        m_z[m_pointCount] = z;
+        m_pointCount++;
+
+        if (kind == HIT_NONE || bounce == MAX_BOUNCES)
+            break;
+        if (kind == HIT_WALL && session.isDeadlyWall(id))
+            break;
+
+        // ball contacts bounce about the line between the centers
+        if (kind != HIT_WALL) {
+            const BallState& other = kind == HIT_BRICK ? session.getBrick(id) : white;
+            float ox = x - other.x;
+            float oz = z - other.z;
+            float distance = sqrt(ox * ox + oz * oz);
+            if (distance <= 0.0f)
+                break;
+            nx = ox / distance;
+            nz = oz / distance;
+            if (kind == HIT_BRICK)
+                hitBricks[hitCount++] = id;
+        }
+
+        float dot = dx * nx + dz * nz;
+        dx -= 2 * dot * nx;
+        dz -= 2 * dot * nz;
+    }
+}
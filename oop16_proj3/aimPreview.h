@@ -0,0 +1,53 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: aimPreview.h
+//
+// Desc: Predicted path of the red ball while the player aims. The path is
+//       traced geometrically (straight lines, mirror bounces off walls,
+//       bricks and the white ball) for the first few bounces, and is cached
+//       until the balls or the brick set change.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __aimPreviewH__
+#define __aimPreviewH__
+
+#include "gameSession.h"
+#include "brickGrid.h"
+
+class CAimPreview {
+public:
+    enum { MAX_BOUNCES = 8 };
+
+    CAimPreview(void);
+
+    // retraces the path when the aim changed since the last call. cheap when
+    // nothing moved, so it can run every frame and on every mouse move
+    void update(const CGameSession& session);
+
+    // forget the cached path and brick layout (after a level or reset)
+    void invalidate(void);
+
+    // path corners : the red ball center at the start and at each bounce
+    int getPointCount(void) const { return m_pointCount; }
+    float getPointX(int i) const { return m_x[i]; }
+    float getPointZ(int i) const { return m_z[i]; }
+
+private:
+    void trace(const CGameSession& session);
+
+    // what the cached path was computed from
+    float   m_keyRedX, m_keyRedZ;
+    float   m_keyWhiteX, m_keyWhiteZ;
+    int     m_keyBricksLeft;
+    bool    m_valid;
+
+    CBrickGrid  m_grid;
+    int         m_gridBricksLeft;   // brick count the grid was built for (-1 : none)
+
+    int     m_pointCount;
+    float   m_x[MAX_BOUNCES + 2];
+    float   m_z[MAX_BOUNCES + 2];
+};
+
+#endif // __aimPreviewH__
@@ -0,0 +1,210 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: ballBatch.cpp
+//
+// Desc: Batched drawing of many equal balls.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "ballBatch.h"
+#include <cmath>
+
+// detail of the batched sphere : 42 vertices, 80 triangles. the extra balls
+// are small on screen, the full 50 x 50 mesh stays with the red and white ball
+const int BATCH_SLICES = 8;
+const int BATCH_STACKS = 6;
+
+const DWORD BATCH_FVF = D3DFVF_XYZ | D3DFVF_NORMAL;
+
+CBallBatch::CBallBatch(void)
+{
+    m_faces = 0;
+    m_radius = 0;
+    m_batch = 0;
+    m_pVB = NULL;
+    m_pIB = NULL;
+    ZeroMemory(&m_mtrl, sizeof(m_mtrl));
+    m_drawCount = 0;
+    m_visibleCount = 0;
+    m_culledCount = 0;
+}
+
+bool CBallBatch::create(IDirect3DDevice9* pDevice, float radius, D3DXCOLOR color)
+{
+    if (NULL == pDevice)
+        return false;
+    destroy();
+
+    m_radius = radius;
+    m_mtrl.Ambient = color;
+    m_mtrl.Diffuse = color;
+    m_mtrl.Specular = color;
+    m_mtrl.Emissive = d3d::BLACK;
+    m_mtrl.Power = 5.0f;
+
+    // poles and rings of a sphere around the origin
+    m_sphere.clear();
+    Vertex top = { 0, radius, 0, 0, 1, 0 };
+    m_sphere.push_back(top);
+    for (int k = 1; k < BATCH_STACKS; k++) {
+        float phi = (float)PI * k / BATCH_STACKS;
+        for (int j = 0; j < BATCH_SLICES; j++) {
+            float theta = 2 * (float)PI * j / BATCH_SLICES;
+            Vertex v;
+            v.nx = sinf(phi) * cosf(theta);
+            v.ny = cosf(phi);
+            v.nz = sinf(phi) * sinf(theta);
+            v.x = v.nx * radius;    v.y = v.ny * radius;    v.z = v.nz * radius;
+            m_sphere.push_back(v);
+        }
+    }
+    Vertex bottom = { 0, -radius, 0, 0, -1, 0 };
+    m_sphere.push_back(bottom);
+
+    std::vector<WORD> faces;
+    int last = (int)m_sphere.size() - 1;
+    for (int j = 0; j < BATCH_SLICES; j++) {
+        int j1 = (j + 1) % BATCH_SLICES;
+        WORD topFan[3] = { 0, (WORD)(1 + j), (WORD)(1 + j1) };
+        faces.insert(faces.end(), topFan, topFan + 3);
+        for (int k = 0; k + 2 < BATCH_STACKS; k++) {
+            WORD a = (WORD)(1 + k * BATCH_SLICES + j), b = (WORD)(1 + k * BATCH_SLICES + j1);
+            WORD c = (WORD)(a + BATCH_SLICES), d = (WORD)(b + BATCH_SLICES);
+            WORD quad[6] = { a, c, b, b, c, d };
+            faces.insert(faces.end(), quad, quad + 6);
+        }
+        int ring = 1 + (BATCH_STACKS - 2) * BATCH_SLICES;
+        WORD bottomFan[3] = { (WORD)last, (WORD)(ring + j1), (WORD)(ring + j) };
+        faces.insert(faces.end(), bottomFan, bottomFan + 3);
+    }
+
+    // clockwise seen from outside, whichever way the rings above turn
+    for (size_t f = 0; f < faces.size(); f += 3) {
+        const Vertex& a = m_sphere[faces[f]];
+        const Vertex& b = m_sphere[faces[f + 1]];
+        const Vertex& c = m_sphere[faces[f + 2]];
+        float ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+        float vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+        float nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+        if (nx * (a.x + b.x + c.x) + ny * (a.y + b.y + c.y) + nz * (a.z + b.z + c.z) < 0) {
+            WORD swap = faces[f + 1];
+            faces[f + 1] = faces[f + 2];
+            faces[f + 2] = swap;
+        }
+    }
+    m_faces = (int)faces.size() / 3;
+
+    // as many balls per draw as 16-bit indices reach
+    int vertices = (int)m_sphere.size();
+    m_batch = 65535 / vertices;
+
+    if (FAILED(pDevice->CreateVertexBuffer(m_batch * vertices * sizeof(Vertex), D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY,
+        BATCH_FVF, D3DPOOL_DEFAULT, &m_pVB, NULL)))
+        return false;
+    if (FAILED(pDevice->CreateIndexBuffer(m_batch * (UINT)faces.size() * sizeof(WORD), D3DUSAGE_WRITEONLY,
+        D3DFMT_INDEX16, D3DPOOL_MANAGED, &m_pIB, NULL))) {
+        destroy();
+        return false;
+    }
+
+    // the index buffer never changes : ball i uses vertices i * vertices ..
+    WORD* indices;
+    if (FAILED(m_pIB->Lock(0, 0, (void**)&indices, 0))) {
+        destroy();
+        return false;
+    }
+    for (int i = 0; i < m_batch; i++) {
+        for (size_t f = 0; f < faces.size(); f++)
+            *indices++ = (WORD)(i * vertices + faces[f]);
+    }
+    m_pIB->Unlock();
+    return true;
+}
+
+void CBallBatch::destroy(void)
+{
+    if (m_pVB != NULL) {
+        m_pVB->Release();
+        m_pVB = NULL;
+    }
+    if (m_pIB != NULL) {
+        m_pIB->Release();
+        m_pIB = NULL;
+    }
+}
+
+void CBallBatch::draw(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld, const BallState* balls, int count,
+    const CFrustum* frustum)
+{
+    m_drawCount = 0;
+    m_visibleCount = 0;
+    m_culledCount = 0;
+    if (NULL == pDevice || m_pVB == NULL || count <= 0)
+        return;
+
+    // the centers moved by mWorld, tested in one batch; the balls drawn are
+    // then listed in m_order
+    const int* order = NULL;
+    if (frustum != NULL) {
+        d3d::BoundingSphere local, world;
+        local._center = D3DXVECTOR3(0, 0, 0);
+        local._radius = m_radius;
+        transformSphere(world, local, mWorld);
+
+        m_x.resize(count);  m_y.resize(count);  m_z.resize(count);
+        m_r.assign(count, world._radius);
+        m_visible.resize(count);
+        for (int i = 0; i < count; i++) {
+            const BallState& ball = balls[i];
+            m_x[i] = ball.x * mWorld._11 + ball.y * mWorld._21 + ball.z * mWorld._31 + mWorld._41;
+            m_y[i] = ball.x * mWorld._12 + ball.y * mWorld._22 + ball.z * mWorld._32 + mWorld._42;
+            m_z[i] = ball.x * mWorld._13 + ball.y * mWorld._23 + ball.z * mWorld._33 + mWorld._43;
+        }
+        int visible = frustum->cull(&m_x[0], &m_y[0], &m_z[0], &m_r[0], count, &m_visible[0]);
+        m_culledCount = count - visible;
+        if (m_culledCount > 0) {
+            m_order.clear();
+            for (int i = 0; i < count; i++) {
+                if (m_visible[i])
+                    m_order.push_back(i);
+            }
+            order = m_order.empty() ? NULL : &m_order[0];
+            count = visible;
+        }
+    }
+    m_visibleCount = count;
+    if (count == 0)
+        return;
+
+    pDevice->SetTransform(D3DTS_WORLD, &mWorld);
+    pDevice->SetMaterial(&m_mtrl);
+    pDevice->SetFVF(BATCH_FVF);
+    pDevice->SetStreamSource(0, m_pVB, 0, sizeof(Vertex));
+    pDevice->SetIndices(m_pIB);
+
+    int vertices = (int)m_sphere.size();
+    for (int first = 0; first < count; first += m_batch) {
+        int n = count - first < m_batch ? count - first : m_batch;
+
+        // discard : the driver hands out fresh memory while the last batch draws
+        Vertex* out;
+        if (FAILED(m_pVB->Lock(0, n * vertices * sizeof(Vertex), (void**)&out, D3DLOCK_DISCARD)))
+            return;
+        for (int i = 0; i < n; i++) {
+            const BallState& ball = balls[order != NULL ? order[first + i] : first + i];
+            for (int v = 0; v < vertices; v++) {
+                out->x = m_sphere[v].x + ball.x;
+                out->y = m_sphere[v].y + ball.y;
+                out->z = m_sphere[v].z + ball.z;
+                out->nx = m_sphere[v].nx;
+                out->ny = m_sphere[v].ny;
+                out->nz = m_sphere[v].nz;
+                out++;
+            }
+        }
+        m_pVB->Unlock();
+
+        pDevice->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 0, 0, n * vertices, 0, n * m_faces);
+        m_drawCount++;
+    }
+}
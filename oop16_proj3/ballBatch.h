@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: ballBatch.h
+//
+// Desc: Draws thousands of equal balls (multi-ball) in a few calls. A
+//       CSphere per ball would mean one mesh draw and one transform per ball;
+//       here a low-detail sphere is copied to every ball position into one
+//       dynamic vertex buffer, and each BATCH_BALLS balls are one indexed
+//       draw lit by the fixed-function pipeline like the other balls.
+//
+//       All device objects are made by create(), so the number of balls can
+//       change from frame to frame without device calls besides the draws.
+//       Given a frustum, balls off screen are tested out in one batch and
+//       never copied.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __ballBatchH__
+#define __ballBatchH__
+
+#include "d3dUtility.h"
+#include "gameSession.h"
+#include "frustum.h"
+#include <vector>
+
+class CBallBatch {
+public:
+    CBallBatch(void);
+    ~CBallBatch(void) {}
+
+    bool create(IDirect3DDevice9* pDevice, float radius, D3DXCOLOR color);
+    void destroy(void);
+
+    // balls[0 .. count) at their centers, with mWorld as world transform. only
+    // the ones inside 'frustum' when one is given
+    void draw(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld, const BallState* balls, int count,
+        const CFrustum* frustum = NULL);
+
+    // device draw calls made by the last draw(), and the balls it drew and culled
+    int getDrawCount(void) const { return m_drawCount; }
+    int getVisibleCount(void) const { return m_visibleCount; }
+    int getCulledCount(void) const { return m_culledCount; }
+
+private:
+    CBallBatch(const CBallBatch&);
+    CBallBatch& operator=(const CBallBatch&);
+
+    struct Vertex
+    {
+        float x, y, z;
+        float nx, ny, nz;
+    };
+
+    std::vector<Vertex>         m_sphere;       // one ball around the origin
+    float                       m_radius;
+    int                         m_faces;        // triangles of one ball
+    int                         m_batch;        // balls per draw
+    IDirect3DVertexBuffer9*     m_pVB;
+    IDirect3DIndexBuffer9*      m_pIB;
+    D3DMATERIAL9                m_mtrl;
+    int                         m_drawCount;
+    int                         m_visibleCount;
+    int                         m_culledCount;
+
+    // culling scratch : world centers, the test result and the balls drawn
+    std::vector<float>          m_x, m_y, m_z, m_r;
+    std::vector<unsigned char>  m_visible;
+    std::vector<int>            m_order;
+};
+
+#endif // __ballBatchH__
@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: ballPool.h
+//
+// Desc: Fixed-capacity store for extra balls (multi-ball). All memory is
+//       taken by reserve(); spawn() and despawn() are O(1) and never
+//       allocate. Live balls are kept packed at the front, so the step loop
+//       and the renderer walk one plain array : despawn() moves the last
+//       ball into the freed slot.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __ballPoolH__
+#define __ballPoolH__
+
+#include <vector>
+#include <cstddef>
+
+template <class T>
+class CPackedPool {
+public:
+    CPackedPool(void) { m_count = 0; }
+
+    // room for 'capacity' items. the live items are kept, those past the
+    // new capacity are dropped
+    void reserve(int capacity)
+    {
+        if (m_count > capacity)
+            m_count = capacity;
+        if (capacity != (int)m_items.size()) {
+            std::vector<T> items(capacity);
+            for (int i = 0; i < m_count; i++)
+                items[i] = m_items[i];
+            items.swap(m_items);
+        }
+    }
+
+    int  getCapacity(void) const { return (int)m_items.size(); }
+    int  getCount(void) const { return m_count; }
+    bool isFull(void) const { return m_count == (int)m_items.size(); }
+
+    // a new item at the end, uninitialized. NULL when full
+    T* spawn(void) { return m_count < (int)m_items.size() ? &m_items[m_count++] : NULL; }
+
+    // the last item takes slot i. a loop that despawns while it walks the
+    // items should go from the back
+    void despawn(int i) { m_items[i] = m_items[--m_count]; }
+
+    void clear(void) { m_count = 0; }
+
+    // replace the live items (up to the capacity)
+    void assign(const T* items, int count)
+    {
+        m_count = count < (int)m_items.size() ? count : (int)m_items.size();
+        for (int i = 0; i < m_count; i++)
+            m_items[i] = items[i];
+    }
+
+    T& operator[](int i) { return m_items[i]; }
+    const T& operator[](int i) const { return m_items[i]; }
+    const T* getItems(void) const { return m_items.empty() ? NULL : &m_items[0]; }
+
+private:
+    std::vector<T>  m_items;
+    int             m_count;
+};
+
+#endif // __ballPoolH__
@@ -0,0 +1,162 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: billiardEnv.cpp
+//
+// Desc: Batched training environment over CWorldPack.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "billiardEnv.h"
+#include "worldPack.h"
+#include <vector>
+
+static_assert(BILLIARD_ENV_OBS_SIZE == 7 + BRICK_COUNT, "observation layout out of date");
+
+// white ball start offsets drawn by a seed, in mouse pixels (about the table width)
+const int START_SPREAD = 270;
+
+struct BilliardEnv
+{
+    BilliardEnv(int count) : pack(count) {}
+
+    CWorldPack                  pack;
+    float                       timeDelta;
+    int                         frameSkip;
+
+    std::vector<unsigned>       seeds;
+    std::vector<float>          observations;
+    std::vector<float>          rewards;
+    std::vector<unsigned char>  dones;
+};
+
+// xorshift32 : the next seed of a game after it is done
+static unsigned nextSeed(unsigned seed)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static void resetGame(BilliardEnv* env, int i)
+{
+    env->pack.reset(i);
+    unsigned r = nextSeed(env->seeds[i] * 2654435761u + 1);
+    env->pack.moveWhiteBall(i, (float)((int)(r % (2 * START_SPREAD + 1)) - START_SPREAD));
+}
+
+static void observe(BilliardEnv* env, int i)
+{
+    const CWorldPack& pack = env->pack;
+    float* obs = &env->observations[i * BILLIARD_ENV_OBS_SIZE];
+
+    BallState red = pack.getRedBall(i);
+    BallState white = pack.getWhiteBall(i);
+    obs[0] = red.x;
+    obs[1] = red.z;
+    obs[2] = red.vx;
+    obs[3] = red.vz;
+    obs[4] = white.x;
+    obs[5] = white.z;
+    obs[6] = pack.isStarted(i) ? 1.0f : 0.0f;
+
+    unsigned long long mask = pack.getBrickMask(i);
+    for (int b = 0; b < BRICK_COUNT; b++)
+        obs[7 + b] = (float)(mask >> b & 1);
+}
+
+BilliardEnv* billiardEnvCreate(int count, float timeDelta, int frameSkip)
+{
+    if (count <= 0 || !(timeDelta > 0) || frameSkip <= 0)
+        return NULL;
+
+    BilliardEnv* env = new BilliardEnv(count);
+    env->timeDelta = timeDelta;
+    env->frameSkip = frameSkip;
+    env->seeds.assign(count, 0);
+    env->observations.assign(count * BILLIARD_ENV_OBS_SIZE, 0.0f);
+    env->rewards.assign(count, 0.0f);
+    env->dones.assign(count, 0);
+    billiardEnvReset(env, NULL);
+    return env;
+}
+
+void billiardEnvDestroy(BilliardEnv* env)
+{
+    delete env;
+}
+
+int billiardEnvGetCount(const BilliardEnv* env)
+{
+    return env->pack.getWorldCount();
+}
+
+void billiardEnvReset(BilliardEnv* env, const unsigned* seeds)
+{
+    int count = env->pack.getWorldCount();
+    for (int i = 0; i < count; i++) {
+        env->seeds[i] = seeds != NULL ? seeds[i] : (unsigned)i;
+        resetGame(env, i);
+        env->rewards[i] = 0;
+        env->dones[i] = 0;
+        observe(env, i);
+    }
+}
+
+void billiardEnvSetSpin(BilliardEnv* env, int spin)
+{
+    PhysicsConfig config = env->pack.getConfig();
+    config.spin = spin != 0;
+    env->pack.setConfig(config);
+}
+
+void billiardEnvStep(BilliardEnv* env, const float* actions)
+{
+    CWorldPack& pack = env->pack;
+    int count = pack.getWorldCount();
+
+    for (int i = 0; i < count; i++) {
+        env->rewards[i] = (float)pack.getBricksLeft(i);
+
+        const float* action = &actions[i * BILLIARD_ENV_ACTION_SIZE];
+        if (action[0] != 0.0f)
+            pack.moveWhiteBall(i, action[0]);
+        if (action[1] > 0.5f && pack.isStarted(i)) {
+            ShotSpin spin = { action[2], action[3], action[4] };
+            pack.shoot(i, spin);
+        }
+    }
+
+    for (int s = 0; s < env->frameSkip; s++)
+        pack.step(env->timeDelta);
+
+    for (int i = 0; i < count; i++) {
+        env->rewards[i] -= (float)pack.getBricksLeft(i);
+        if (pack.isRestart(i))
+            env->rewards[i] -= 1.0f;
+        env->dones[i] = pack.isRestart(i) || pack.isComplete(i);
+
+        // a finished game starts over right away, so the observation the
+        // next action is chosen from is the one of the game it acts on
+        if (env->dones[i]) {
+            env->seeds[i] = nextSeed(env->seeds[i] + 1);
+            resetGame(env, i);
+        }
+        observe(env, i);
+    }
+}
+
+const float* billiardEnvGetObservations(const BilliardEnv* env)
+{
+    return &env->observations[0];
+}
+
+const float* billiardEnvGetRewards(const BilliardEnv* env)
+{
+    return &env->rewards[0];
+}
+
+const unsigned char* billiardEnvGetDones(const BilliardEnv* env)
+{
+    return &env->dones[0];
+}
@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: billiardEnv.h
+//
+// Desc: Batched training environment over the stock table, with a plain C
+//       interface so it can be loaded from Python (ctypes / cffi) or any
+//       other language. One environment handle runs 'count' games in lock
+//       step on a CWorldPack.
+//
+//       Observation, reward and done buffers are owned by the environment
+//       and stay at the same address for its whole life, so a caller can
+//       wrap them once (e.g. numpy.frombuffer) and read them after every
+//       step without copying.
+//
+//       Observation of one game (BILLIARD_ENV_OBS_SIZE floats) :
+//         [0..3]   red ball x, z, vx, vz
+//         [4..5]   white ball x, z
+//         [6]      1 while the red ball waits for the shot, else 0
+//         [7..42]  1 for each stock brick still on the table, else 0
+//
+//       Action of one game (BILLIARD_ENV_ACTION_SIZE floats) :
+//         [0]      white ball movement, in mouse pixels like a right-drag
+//         [1]      > 0.5 : shoot (only while the red ball waits)
+//         [2..4]   follow, side and masse of that shot (ShotSpin), used
+//                  after billiardEnvSetSpin(env, 1)
+//
+//       Reward : +1 per brick removed in the step, -1 when the red ball
+//       reaches the bottom wall.
+//
+//       Autoreset : a game that is done at the end of a step is reset within
+//       that same step, with a new seed derived from its last one. Its done
+//       flag and reward belong to the finished game, but its observation
+//       already shows the fresh one, which the next action then acts on.
+//       The terminal observation itself is not returned.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __billiardEnvH__
+#define __billiardEnvH__
+
+#if defined(_WIN32) && defined(BILLIARD_ENV_EXPORTS)
+#define BILLIARD_ENV_API __declspec(dllexport)
+#else
+#define BILLIARD_ENV_API
+#endif
+
+#define BILLIARD_ENV_OBS_SIZE       43
+#define BILLIARD_ENV_ACTION_SIZE    5
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct BilliardEnv BilliardEnv;
+
+// timeDelta : simulated time of one physics step (the window app uses about
+// 0.0112 at 60 fps). frameSkip : physics steps per billiardEnvStep, with the
+// same action. returns NULL on bad arguments
+BILLIARD_ENV_API BilliardEnv* billiardEnvCreate(int count, float timeDelta, int frameSkip);
+BILLIARD_ENV_API void billiardEnvDestroy(BilliardEnv* env);
+
+BILLIARD_ENV_API int billiardEnvGetCount(const BilliardEnv* env);
+
+// restart every game. seeds (count entries, may be NULL for 0 .. count-1)
+// pick a random start position of the white ball
+BILLIARD_ENV_API void billiardEnvReset(BilliardEnv* env, const unsigned* seeds);
+
+// 1 : balls spin, slide and roll (spinModel.h) and shots take the spin of
+// their action. 0, the default, keeps the stock physics without spin
+BILLIARD_ENV_API void billiardEnvSetSpin(BilliardEnv* env, int spin);
+
+// actions : count * BILLIARD_ENV_ACTION_SIZE floats
+BILLIARD_ENV_API void billiardEnvStep(BilliardEnv* env, const float* actions);
+
+// count * BILLIARD_ENV_OBS_SIZE floats, count floats and count bytes
+BILLIARD_ENV_API const float* billiardEnvGetObservations(const BilliardEnv* env);
+BILLIARD_ENV_API const float* billiardEnvGetRewards(const BilliardEnv* env);
+BILLIARD_ENV_API const unsigned char* billiardEnvGetDones(const BilliardEnv* env);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __billiardEnvH__
@@ -0,0 +1,355 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: boundary.cpp
+//
+// Desc: Segment boundary with a bounding-volume hierarchy.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "boundary.h"
+#include <algorithm>
+#include <cmath>
+
+// segments per leaf
+const int LEAF_SIZE = 4;
+
+// how close two points count as the same segment end
+const float JOINT_EPSILON = 1e-4f;
+
+// normals closer than about 25 degrees : the joint is a bend of one smooth
+// cushion (an arc), not a corner between two cushions
+const float JOINT_COS = 0.9f;
+
+// deepest traversal stack a query needs. the tree is built by median split,
+// so its depth is about log2(segments / LEAF_SIZE)
+const int STACK_SIZE = 64;
+
+static float centerX(const Segment& s) { return (s.x0 + s.x1) * 0.5f; }
+static float centerZ(const Segment& s) { return (s.z0 + s.z1) * 0.5f; }
+
+void CBoundaryBVH::clear(void)
+{
+    m_segments.clear();
+    m_order.clear();
+    m_nodes.clear();
+}
+
+void CBoundaryBVH::build(const std::vector<Segment>& segments)
+{
+    clear();
+    if (segments.empty())
+        return;
+
+    m_segments = segments;
+    m_order.resize(segments.size());
+    for (size_t i = 0; i < segments.size(); i++)
+        m_order[i] = (int)i;
+
+    m_nodes.reserve(2 * segments.size() / LEAF_SIZE + 2);
+    buildNode(0, (int)segments.size());
+}
+
+// builds the subtree over m_order[begin, end) in depth-first order and returns its root
+int CBoundaryBVH::buildNode(int begin, int end)
+{
+    int index = (int)m_nodes.size();
+    m_nodes.push_back(Node());
+
+    Node node;
+    node.minX = node.minZ = 1e30f;
+    node.maxX = node.maxZ = -1e30f;
+    for (int i = begin; i < end; i++) {
+        const Segment& s = m_segments[m_order[i]];
+        node.minX = std::min(node.minX, std::min(s.x0, s.x1));
+        node.minZ = std::min(node.minZ, std::min(s.z0, s.z1));
+        node.maxX = std::max(node.maxX, std::max(s.x0, s.x1));
+        node.maxZ = std::max(node.maxZ, std::max(s.z0, s.z1));
+    }
+
+    if (end - begin <= LEAF_SIZE) {
+        node.first = begin;
+        node.count = end - begin;
+        m_nodes[index] = node;
+        return index;
+    }
+
+    // split at the median along the longer side
+    int mid = (begin + end) / 2;
+    bool alongX = node.maxX - node.minX >= node.maxZ - node.minZ;
+    const std::vector<Segment>& segs = m_segments;
+    std::nth_element(m_order.begin() + begin, m_order.begin() + mid, m_order.begin() + end,
+        [&segs, alongX](int a, int b) {
+            return alongX ? centerX(segs[a]) < centerX(segs[b]) : centerZ(segs[a]) < centerZ(segs[b]);
+        });
+
+    node.count = 0;
+    buildNode(begin, mid);
+    node.first = buildNode(mid, end);
+    m_nodes[index] = node;
+    return index;
+}
+
+int CBoundaryBVH::query(float x, float z, float radius, SegmentHit* hits, int maxHits) const
+{
+    if (m_nodes.empty() || maxHits <= 0)
+        return 0;
+
+    int found = 0;
+    int stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        int index = stack[--top];
+        const Node& node = m_nodes[index];
+        if (x + radius < node.minX || x - radius > node.maxX ||
+            z + radius < node.minZ || z - radius > node.maxZ)
+            continue;
+
+        if (node.count == 0) {
+            if (top + 2 <= STACK_SIZE) {
+                stack[top++] = node.first;
+                stack[top++] = index + 1;
+            }
+            continue;
+        }
+
+        for (int i = node.first; i < node.first + node.count; i++) {
+            const Segment& s = m_segments[m_order[i]];
+
+            // closest point on the segment to the ball center
+            float ex = s.x1 - s.x0;
+            float ez = s.z1 - s.z0;
+            float len2 = ex * ex + ez * ez;
+            float t = len2 > 0.0f ? ((x - s.x0) * ex + (z - s.z0) * ez) / len2 : 0.0f;
+            t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+
+            float dx = x - (s.x0 + t * ex);
+            float dz = z - (s.z0 + t * ez);
+            float dist2 = dx * dx + dz * dz;
+            if (dist2 >= radius * radius)
+                continue;
+
+            SegmentHit& hit = hits[found++];
+            hit.segment = m_order[i];
+            if (dist2 > 0.0f) {
+                float dist = sqrt(dist2);
+                hit.nx = dx / dist;
+                hit.nz = dz / dist;
+                hit.penetration = radius - dist;
+            }
+            else {
+                // the deepest case : no direction from the segment to the
+                // center, so the side facing the middle of the table
+                const Node& root = m_nodes[0];
+                float mx = (root.minX + root.maxX) * 0.5f - x;
+                float mz = (root.minZ + root.maxZ) * 0.5f - z;
+                float nx = len2 > 0.0f ? -ez : mx;
+                float nz = len2 > 0.0f ? ex : mz;
+                if (nx * mx + nz * mz < 0.0f) {
+                    nx = -nx;
+                    nz = -nz;
+                }
+                float length = sqrt(nx * nx + nz * nz);
+                hit.nx = length > 0.0f ? nx / length : 0.0f;
+                hit.nz = length > 0.0f ? nz / length : 1.0f;
+                hit.penetration = radius;
+            }
+            if (found == maxHits)
+                return mergeJoints(x, z, radius, hits, found);
+        }
+    }
+    return mergeJoints(x, z, radius, hits, found);
+}
+
+static bool isEnd(const Segment& s, float px, float pz)
+{
+    return (fabsf(px - s.x0) <= JOINT_EPSILON && fabsf(pz - s.z0) <= JOINT_EPSILON) ||
+        (fabsf(px - s.x1) <= JOINT_EPSILON && fabsf(pz - s.z1) <= JOINT_EPSILON);
+}
+
+// two hits on neighbouring segments are one contact when one of them is at
+// the common end (both then found the same point), or when the segments bend
+// so little that both push the ball the same way. the closest point of a hit
+// is back along its normal from the center
+bool CBoundaryBVH::shareJoint(float x, float z, float radius, const SegmentHit& a, const SegmentHit& b) const
+{
+    const Segment& sa = m_segments[a.segment];
+    const Segment& sb = m_segments[b.segment];
+    if (!isEnd(sb, sa.x0, sa.z0) && !isEnd(sb, sa.x1, sa.z1))
+        return false;
+    if (a.nx * b.nx + a.nz * b.nz >= JOINT_COS)
+        return true;
+    float da = radius - a.penetration;
+    float db = radius - b.penetration;
+    float ax = x - a.nx * da, az = z - a.nz * da;
+    float bx = x - b.nx * db, bz = z - b.nz * db;
+    return (isEnd(sa, ax, az) && isEnd(sb, ax, az)) || (isEnd(sb, bx, bz) && isEnd(sa, bx, bz));
+}
+
+int CBoundaryBVH::mergeJoints(float x, float z, float radius, SegmentHit* hits, int count) const
+{
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        SegmentHit hit = hits[i];
+        int k = 0;
+        while (k < kept && !shareJoint(x, z, radius, hits[k], hit))
+            k++;
+        if (k == kept)
+            hits[kept++] = hit;
+        else if (hit.penetration > hits[k].penetration)
+            hits[k] = hit;
+    }
+    return kept;
+}
+
+// ray from (x, z) along (dx, dz) against a circle : earliest t >= 0. only counts
+// when the ray moves towards the center
+static bool sweepCircle(float x, float z, float dx, float dz, float cx, float cz, float radius, float* t)
+{
+    float mx = x - cx;
+    float mz = z - cz;
+    float along = mx * dx + mz * dz;
+    float c = mx * mx + mz * mz - radius * radius;
+    if (along >= 0.0f)
+        return false;
+    if (c <= 0.0f) {
+        *t = 0.0f;
+        return true;
+    }
+    float disc = along * along - c;
+    if (disc < 0.0f)
+        return false;
+    *t = -along - sqrt(disc);
+    return true;
+}
+
+// circle swept along the ray against one segment : the two sides offset by
+// the radius, then the two rounded ends
+static bool sweepSegment(const Segment& s, float x, float z, float dx, float dz, float radius,
+    float* t, float* nx, float* nz)
+{
+    float ex = s.x1 - s.x0;
+    float ez = s.z1 - s.z0;
+    float len2 = ex * ex + ez * ez;
+    bool found = false;
+
+    if (len2 > 0.0f) {
+        float len = sqrt(len2);
+        float lx = -ez / len;
+        float lz = ex / len;
+        float side = lx * (x - s.x0) + lz * (z - s.z0);
+        if (side < 0.0f) {
+            lx = -lx;
+            lz = -lz;
+            side = -side;
+        }
+        float rate = lx * dx + lz * dz;
+        if (rate < 0.0f) {
+            float hit = side > radius ? (side - radius) / -rate : 0.0f;
+            float u = ((x + dx * hit - s.x0) * ex + (z + dz * hit - s.z0) * ez) / len2;
+            if (u >= 0.0f && u <= 1.0f) {
+                *t = hit;
+                *nx = lx;
+                *nz = lz;
+                found = true;
+            }
+        }
+    }
+
+    const float ends[2][2] = { { s.x0, s.z0 }, { s.x1, s.z1 } };
+    for (int i = 0; i < 2; i++) {
+        float hit;
+        if (!sweepCircle(x, z, dx, dz, ends[i][0], ends[i][1], radius, &hit) || (found && hit >= *t))
+            continue;
+        float px = x + dx * hit - ends[i][0];
+        float pz = z + dz * hit - ends[i][1];
+        float d = sqrt(px * px + pz * pz);
+        if (d <= 0.0f)
+            continue;
+        *t = hit;
+        *nx = px / d;
+        *nz = pz / d;
+        found = true;
+    }
+    return found;
+}
+
+// ray against a box : true when the ray enters it before maxT
+static bool sweepBox(float x, float z, float invX, float invZ, float minX, float minZ,
+    float maxX, float maxZ, float maxT)
+{
+    float a = (minX - x) * invX, b = (maxX - x) * invX;
+    float enter = std::min(a, b), leave = std::max(a, b);
+    a = (minZ - z) * invZ;
+    b = (maxZ - z) * invZ;
+    enter = std::max(enter, std::min(a, b));
+    leave = std::min(leave, std::max(a, b));
+    return enter <= leave && leave >= 0.0f && enter <= maxT;
+}
+
+bool CBoundaryBVH::sweep(float x, float z, float dx, float dz, float radius, float maxT,
+    float* t, int* segment, float* nx, float* nz) const
+{
+    if (m_nodes.empty())
+        return false;
+
+    // a zero component gives an infinite slab, so the box test stays a plain
+    // compare on that axis
+    float invX = dx != 0.0f ? 1.0f / dx : 1e30f;
+    float invZ = dz != 0.0f ? 1.0f / dz : 1e30f;
+
+    float best = maxT;
+    int bestSegment = -1;
+    float bestNx = 0.0f, bestNz = 0.0f;
+
+    int stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        int index = stack[--top];
+        const Node& node = m_nodes[index];
+        if (!sweepBox(x, z, invX, invZ, node.minX - radius, node.minZ - radius,
+            node.maxX + radius, node.maxZ + radius, best))
+            continue;
+
+        if (node.count == 0) {
+            if (top + 2 <= STACK_SIZE) {
+                stack[top++] = node.first;
+                stack[top++] = index + 1;
+            }
+            continue;
+        }
+
+        for (int i = node.first; i < node.first + node.count; i++) {
+            float hit = 0.0f, hx = 0.0f, hz = 0.0f;
+            if (sweepSegment(m_segments[m_order[i]], x, z, dx, dz, radius, &hit, &hx, &hz) && hit <= best) {
+                best = hit;
+                bestSegment = m_order[i];
+                bestNx = hx;
+                bestNz = hz;
+            }
+        }
+    }
+
+    if (bestSegment < 0)
+        return false;
+    *t = best;
+    *segment = bestSegment;
+    *nx = bestNx;
+    *nz = bestNz;
+    return true;
+}
+
+void CBoundaryBVH::getBounds(float* minX, float* minZ, float* maxX, float* maxZ) const
+{
+    if (m_nodes.empty()) {
+        *minX = *minZ = *maxX = *maxZ = 0.0f;
+        return;
+    }
+    *minX = m_nodes[0].minX;
+    *minZ = m_nodes[0].minZ;
+    *maxX = m_nodes[0].maxX;
+    *maxZ = m_nodes[0].maxZ;
+}
@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: boundary.h
+//
+// Desc: Table boundary made of line segments (straight cushions, or arcs
+//       split into short segments by the level loader), stored in a
+//       bounding-volume hierarchy so a ball only tests the few segments near
+//       it. Used for custom tables in place of the four stock walls.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __boundaryH__
+#define __boundaryH__
+
+#include <vector>
+
+// segment flags
+const unsigned short SEGMENT_DEADLY = 1;   // touching it ends the round, like the stock bottom wall
+
+struct Segment
+{
+    float x0, z0;
+    float x1, z1;
+    unsigned short flags;
+};
+
+// ball-vs-segment overlap found by CBoundaryBVH::query
+struct SegmentHit
+{
+    int   segment;
+    float nx, nz;           // unit normal from the closest point on the segment to the ball
+    float penetration;
+};
+
+class CBoundaryBVH {
+public:
+    CBoundaryBVH(void) {}
+
+    // rebuilds the hierarchy. segments are copied
+    void build(const std::vector<Segment>& segments);
+    void clear(void);
+
+    bool empty(void) const { return m_segments.empty(); }
+    int getSegmentCount(void) const { return (int)m_segments.size(); }
+    const Segment& getSegment(int i) const { return m_segments[i]; }
+
+    // writes at most maxHits overlaps of the circle (x, z, radius) into hits
+    // and returns how many were written. a center right on a segment gets the
+    // segment normal on the side of the middle of the bounds. two segments
+    // touched at their common end give one hit, see mergeJoints()
+    int query(float x, float z, float radius, SegmentHit* hits, int maxHits) const;
+
+    // keeps only the deepest of hits on two neighbouring segments that are
+    // one contact : the closest point of one is their common end, or the
+    // normals are nearly the same (the joint of an arc). a ball there is then
+    // pushed out once, not once per segment. returns the hits left
+    int mergeJoints(float x, float z, float radius, SegmentHit* hits, int count) const;
+
+    // earliest contact of a circle of 'radius' moving from (x, z) along the unit
+    // direction (dx, dz) within maxT. the normal points from the segment to the circle
+    bool sweep(float x, float z, float dx, float dz, float radius, float maxT,
+        float* t, int* segment, float* nx, float* nz) const;
+
+    // bounds of all segments
+    void getBounds(float* minX, float* minZ, float* maxX, float* maxZ) const;
+
+private:
+    struct Node
+    {
+        float minX, minZ, maxX, maxZ;
+        int   first;    // leaf : first index into m_order. inner : right child (left child follows the node)
+        int   count;    // leaf : segment count. inner : 0
+    };
+
+    int buildNode(int begin, int end);
+    bool shareJoint(float x, float z, float radius, const SegmentHit& a, const SegmentHit& b) const;
+
+    std::vector<Segment>    m_segments;
+    std::vector<int>        m_order;
+    std::vector<Node>       m_nodes;
+};
+
+#endif // __boundaryH__
@@ -0,0 +1,236 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: brickGrid.cpp
+//
+// Desc: Uniform grid over the brick centers with swept-circle casts.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "brickGrid.h"
+#include <cmath>
+#include <algorithm>
+
+// upper bound on cells per axis so a sparse, huge level stays small
+const int MAX_GRID_DIM = 1024;
+
+CBrickGrid::CBrickGrid(void)
+{
+    clear();
+}
+
+void CBrickGrid::clear(void)
+{
+    m_minX = m_minZ = 0.0f;
+    m_cell = 1.0f;
+    m_cols = m_rows = 0;
+    m_reach = 0.0f;
+    m_x.clear();
+    m_z.clear();
+    m_cellStart.clear();
+    m_items.clear();
+}
+
+void CBrickGrid::build(const float* x, const float* z, const unsigned char* alive, int count, float reach)
+{
+    clear();
+    m_reach = reach;
+
+    for (int i = 0; i < count; i++) {
+        m_x.push_back(x[i]);
+        m_z.push_back(z[i]);
+    }
+    if (count == 0)
+        return;
+
+    float minX = x[0], maxX = x[0], minZ = z[0], maxZ = z[0];
+    for (int i = 1; i < count; i++) {
+        minX = std::min(minX, x[i]);    maxX = std::max(maxX, x[i]);
+        minZ = std::min(minZ, z[i]);    maxZ = std::max(maxZ, z[i]);
+    }
+    m_minX = minX - reach;
+    m_minZ = minZ - reach;
+    float width = maxX - minX + 2 * reach;
+    float depth = maxZ - minZ + 2 * reach;
+
+    // a cell is at least one brick reach across, and about one brick per cell
+    m_cell = std::max(2 * reach, (float)sqrt(width * depth / count));
+    m_cell = std::max(m_cell, std::max(width, depth) / MAX_GRID_DIM);
+    m_cols = std::max(1, (int)ceil(width / m_cell));
+    m_rows = std::max(1, (int)ceil(depth / m_cell));
+
+    // counting pass, then fill (compressed rows)
+    m_cellStart.assign(m_cols * m_rows + 1, 0);
+    for (int pass = 0; pass < 2; pass++) {
+        std::vector<int> cursor;
+        if (pass == 1) {
+            for (int c = 0; c < m_cols * m_rows; c++)
+                m_cellStart[c + 1] += m_cellStart[c];
+            m_items.resize(m_cellStart[m_cols * m_rows]);
+            cursor.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+        }
+        for (int i = 0; i < count; i++) {
+            if (alive != NULL && !alive[i])
+                continue;
+            int c0, r0, c1, r1;
+            brickCells(i, &c0, &r0, &c1, &r1);
+            for (int r = r0; r <= r1; r++) {
+                for (int c = c0; c <= c1; c++) {
+                    if (pass == 0)
+                        m_cellStart[r * m_cols + c + 1]++;
+                    else
+                        m_items[cursor[r * m_cols + c]++] = i;
+                }
+            }
+        }
+    }
+}
+
+void CBrickGrid::brickCells(int b, int* c0, int* r0, int* c1, int* r1) const
+{
+    *c0 = std::max(0, (int)((m_x[b] - m_reach - m_minX) / m_cell));
+    *c1 = std::min(m_cols - 1, (int)((m_x[b] + m_reach - m_minX) / m_cell));
+    *r0 = std::max(0, (int)((m_z[b] - m_reach - m_minZ) / m_cell));
+    *r1 = std::min(m_rows - 1, (int)((m_z[b] + m_reach - m_minZ) / m_cell));
+}
+
+bool CBrickGrid::hitBrick(int b, float x, float z, float dx, float dz, float* t) const
+{
+    float mx = x - m_x[b];
+    float mz = z - m_z[b];
+    float along = mx * dx + mz * dz;
+    float c = mx * mx + mz * mz - m_reach * m_reach;
+
+    if (c <= 0.0f) {
+        // already touching : counts only when moving towards the center
+        if (along >= 0.0f)
+            return false;
+        *t = 0.0f;
+        return true;
+    }
+    if (along >= 0.0f)
+        return false;
+
+    float disc = along * along - c;
+    if (disc < 0.0f)
+        return false;
+    *t = -along - sqrt(disc);
+    return true;
+}
+
+int CBrickGrid::cellBricks(float x, float z, const int** bricks) const
+{
+    if (m_items.empty())
+        return 0;
+    int col = (int)floor((x - m_minX) / m_cell);
+    int row = (int)floor((z - m_minZ) / m_cell);
+    if (col < 0 || col >= m_cols || row < 0 || row >= m_rows)
+        return 0;
+    int cell = row * m_cols + col;
+    *bricks = m_items.data() + m_cellStart[cell];
+    return m_cellStart[cell + 1] - m_cellStart[cell];
+}
+
+int CBrickGrid::columnOf(float x) const
+{
+    int col = (int)floor((x - m_minX) / m_cell);
+    return std::min(m_cols - 1, std::max(0, col));
+}
+
+int CBrickGrid::rowOf(float z) const
+{
+    int row = (int)floor((z - m_minZ) / m_cell);
+    return std::min(m_rows - 1, std::max(0, row));
+}
+
+int CBrickGrid::cellItems(int col, int row, const int** bricks) const
+{
+    int cell = row * m_cols + col;
+    *bricks = m_items.data() + m_cellStart[cell];
+    return m_cellStart[cell + 1] - m_cellStart[cell];
+}
+
+bool CBrickGrid::sweep(float x, float z, float dx, float dz, float maxT,
+    const int* exclude, int excludeCount, float* t, int* brick) const
+{
+    if (m_items.empty())
+        return false;
+
+    const float BIG = 1e30f;
+    float maxX = m_minX + m_cols * m_cell;
+    float maxZ = m_minZ + m_rows * m_cell;
+
+    // clip the ray to the grid bounds
+    float t0 = 0.0f;
+    float t1 = maxT;
+    if (dx != 0.0f) {
+        float a = (m_minX - x) / dx, b = (maxX - x) / dx;
+        t0 = std::max(t0, std::min(a, b));
+        t1 = std::min(t1, std::max(a, b));
+    }
+    else if (x < m_minX || x > maxX) {
+        return false;
+    }
+    if (dz != 0.0f) {
+        float a = (m_minZ - z) / dz, b = (maxZ - z) / dz;
+        t0 = std::max(t0, std::min(a, b));
+        t1 = std::min(t1, std::max(a, b));
+    }
+    else if (z < m_minZ || z > maxZ) {
+        return false;
+    }
+    if (t0 > t1)
+        return false;
+
+    int col = std::min(m_cols - 1, std::max(0, (int)((x + dx * t0 - m_minX) / m_cell)));
+    int row = std::min(m_rows - 1, std::max(0, (int)((z + dz * t0 - m_minZ) / m_cell)));
+
+    int stepX = dx > 0.0f ? 1 : -1;
+    int stepZ = dz > 0.0f ? 1 : -1;
+    float deltaX = dx != 0.0f ? m_cell / fabs(dx) : BIG;
+    float deltaZ = dz != 0.0f ? m_cell / fabs(dz) : BIG;
+    float nextX = dx > 0.0f ? (m_minX + (col + 1) * m_cell - x) / dx
+        : (dx < 0.0f ? (m_minX + col * m_cell - x) / dx : BIG);
+    float nextZ = dz > 0.0f ? (m_minZ + (row + 1) * m_cell - z) / dz
+        : (dz < 0.0f ? (m_minZ + row * m_cell - z) / dz : BIG);
+
+    float best = BIG;
+    int bestBrick = -1;
+
+    for (;;) {
+        int cell = row * m_cols + col;
+        for (int k = m_cellStart[cell]; k < m_cellStart[cell + 1]; k++) {
+            int b = m_items[k];
+            float hit;
+            if (!hitBrick(b, x, z, dx, dz, &hit) || hit >= best || hit > maxT)
+                continue;
+            if (std::find(exclude, exclude + excludeCount, b) != exclude + excludeCount)
+                continue;
+            best = hit;
+            bestBrick = b;
+        }
+
+        // a hit inside this cell can't be beaten by a later cell
+        float cellExit = std::min(nextX, nextZ);
+        if (best <= cellExit || cellExit > t1)
+            break;
+
+        if (nextX < nextZ) {
+            col += stepX;
+            nextX += deltaX;
+            if (col < 0 || col >= m_cols)
+                break;
+        }
+        else {
+            row += stepZ;
+            nextZ += deltaZ;
+            if (row < 0 || row >= m_rows)
+                break;
+        }
+    }
+
+    if (bestBrick < 0)
+        return false;
+    *t = best;
+    *brick = bestBrick;
+    return true;
+}
@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: brickGrid.h
+//
+// Desc: Uniform grid over the brick centers. Each brick is stored in every
+//       cell its reach (brick radius + moving ball radius) touches, so a
+//       swept-circle cast only has to visit the cells along the ray.
+//       CSpatialIndex walks the same cells for its queries.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __brickGridH__
+#define __brickGridH__
+
+#include <vector>
+
+class CBrickGrid {
+public:
+    CBrickGrid(void);
+
+    // x, z : brick centers. alive may be NULL (every brick present).
+    // reach : distance between centers at which a ball touches a brick
+    void build(const float* x, const float* z, const unsigned char* alive, int count, float reach);
+    void clear(void);
+
+    float getReach(void) const { return m_reach; }
+
+    // earliest contact of a ball moving from (x, z) along the unit direction
+    // (dx, dz) within maxT, ignoring the bricks listed in 'exclude'.
+    // a ball that already touches a brick hits it at t = 0 if it moves inwards
+    bool sweep(float x, float z, float dx, float dz, float maxT,
+        const int* exclude, int excludeCount, float* t, int* brick) const;
+
+    // bricks stored in the cell of the point (x, z) : every brick whose reach
+    // covers that point, and maybe a few more. returns their count
+    int cellBricks(float x, float z, const int** bricks) const;
+
+    // the cells themselves, for queries that walk them (spatialQuery.h).
+    // columnOf / rowOf clamp to the grid
+    int getColumns(void) const { return m_cols; }
+    int getRows(void) const { return m_rows; }
+    float getCellSize(void) const { return m_cell; }
+    float getMinX(void) const { return m_minX; }
+    float getMinZ(void) const { return m_minZ; }
+    float getX(int brick) const { return m_x[brick]; }
+    float getZ(int brick) const { return m_z[brick]; }
+    int columnOf(float x) const;
+    int rowOf(float z) const;
+    // the block of cells brick b is stored in
+    void brickCells(int b, int* c0, int* r0, int* c1, int* r1) const;
+    // bricks stored in cell (col, row). returns their count
+    int cellItems(int col, int row, const int** bricks) const;
+
+private:
+    bool hitBrick(int b, float x, float z, float dx, float dz, float* t) const;
+
+    float               m_minX, m_minZ;
+    float               m_cell;
+    int                 m_cols, m_rows;
+    float               m_reach;
+
+    std::vector<float>  m_x, m_z;
+    std::vector<int>    m_cellStart;    // m_items[m_cellStart[c] .. m_cellStart[c + 1]) are in cell c
+    std::vector<int>    m_items;
+};
+
+#endif // __brickGridH__
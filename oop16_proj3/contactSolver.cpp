@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: contactSolver.cpp
+//
+// Desc: Sequential impulse contact solver.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "contactSolver.h"
+#include "gameSession.h"
+
+// the other bodies do not move, so an impulse is simply a change of the
+// ball's velocity along the contact normal
+void solveContacts(BallState& ball, SolverContact* contacts, int count, int iterations)
+{
+    // closing speeds are taken before the warm start changes the velocity
+    for (int i = 0; i < count; i++) {
+        SolverContact& c = contacts[i];
+        c.closing = -((ball.vx - c.bodyVX) * c.nx + (ball.vz - c.bodyVZ) * c.nz);
+        if (!(c.flags & SOLVE_VELOCITY) || c.impulse < 0)
+            c.impulse = 0;
+        ball.vx += c.impulse * c.nx;
+        ball.vz += c.impulse * c.nz;
+    }
+
+    for (int n = 0; n < iterations; n++) {
+        for (int i = 0; i < count; i++) {
+            SolverContact& c = contacts[i];
+            if (!(c.flags & SOLVE_VELOCITY))
+                continue;
+
+            // leave with restitution times the closing speed, or at least not approach
+            float target = c.closing > 0 ? c.restitution * c.closing : 0;
+            float speed = (ball.vx - c.bodyVX) * c.nx + (ball.vz - c.bodyVZ) * c.nz;
+            float impulse = c.impulse + target - speed;
+            if (impulse < 0)
+                impulse = 0;
+            float delta = impulse - c.impulse;
+            c.impulse = impulse;
+            ball.vx += delta * c.nx;
+            ball.vz += delta * c.nz;
+        }
+    }
+
+    // the same for positions : each contact may only push the ball outwards,
+    // by as much as is left of its penetration after the other pushes
+    float pushX = 0, pushZ = 0;
+    for (int i = 0; i < count; i++)
+        contacts[i].push = 0;
+    for (int n = 0; n < (iterations > 0 ? iterations : 1); n++) {
+        for (int i = 0; i < count; i++) {
+            SolverContact& c = contacts[i];
+            if (!(c.flags & SOLVE_POSITION))
+                continue;
+
+            float push = c.push + c.penetration - (pushX * c.nx + pushZ * c.nz);
+            if (push < 0)
+                push = 0;
+            float delta = push - c.push;
+            c.push = push;
+            pushX += delta * c.nx;
+            pushZ += delta * c.nz;
+        }
+    }
+    ball.x += pushX;
+    ball.z += pushZ;
+}
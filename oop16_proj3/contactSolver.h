@@ -0,0 +1,54 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: contactSolver.h
+//
+// Desc: Sequential impulse solver for the contacts of one moving ball against
+//       bodies that do not give way (walls, bricks, the paddle balls).
+//
+//       Resolving contacts one after the other makes the result depend on
+//       their order: a ball touching two bricks is reflected twice, a ball in
+//       a corner may be pushed back into the first wall by the second. Here
+//       all contacts of the ball are solved together. Each keeps an
+//       accumulated impulse that may only push; the solver sweeps over the
+//       contacts a few times, correcting each one's impulse towards its target
+//       speed, until they agree. Positions are corrected the same way.
+//
+//       Starting from last step's impulses (warm start) lets contacts that
+//       last several steps settle in one or two sweeps.
+//
+//       CGameSession solves the red ball and each extra ball this way. The
+//       other body never gives way, and that is the game's rule rather than
+//       a shortcut : walls and bricks are fixed, the paddle balls follow the
+//       players, and the extra balls pass through each other and the red
+//       ball. There are no contacts between two free balls, so no impulse is
+//       shared between two moving bodies.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __contactSolverH__
+#define __contactSolverH__
+
+struct BallState;
+
+enum SolverFlags
+{
+    SOLVE_VELOCITY = 1,     // the contact stops the ball moving into the body, with restitution
+    SOLVE_POSITION = 2      // the ball is pushed out by 'penetration'
+};
+
+struct SolverContact
+{
+    int     flags;          // SolverFlags
+    float   nx, nz;         // unit normal, pointing towards the ball
+    float   penetration;    // overlap along the normal
+    float   bodyVX, bodyVZ; // velocity of the other body
+    float   restitution;    // share of the closing speed the ball leaves with (1 : elastic)
+    float   impulse;        // in : last step's impulse (0 : cold start), out : this step's
+    float   closing;        // out : closing speed before the solve (> 0 : approaching)
+    float   push;           // out : how far this contact pushed the ball
+};
+
+// solves 'count' contacts of 'ball' together, with 'iterations' sweeps
+void solveContacts(BallState& ball, SolverContact* contacts, int count, int iterations);
+
+#endif // __contactSolverH__
@@ -23,8 +23,8 @@ bool d3d::InitD3D(
 	// Create the main application window.
 	//
 
-	// WNDCLASS :  Ŭ   ϴ  
-	// â Ÿ, ⺻  ν(WndProc), , Ŀ  
+	// WNDCLASS : 윈도우 클래스에 대한 정보를 설정하는 데 사용
+	// 창의 스타일, 기본 윈도우 프로시저(WndProc), 아이콘, 커서 등을 설정
 	WNDCLASS wc;       
 
 	wc.style         = CS_HREDRAW | CS_VREDRAW;
@@ -44,7 +44,7 @@ bool d3d::InitD3D(
 		return false;
 	}
 	
-	//  츦 
+	// 실제 윈도우를 생성
 	HWND hwnd = 0;
     hwnd = ::CreateWindow("Direct3D9App",
         "Virtual Billiard", 
@@ -79,14 +79,14 @@ bool d3d::InitD3D(
 	}
 
 	// Step 2: Check for hardware vp.
-	// ׷ ī   
-	// ϵ ȯ    ȮϿ  ó  
+	// 그래픽 카드의 기능을 가져옴 
+	// 하드웨어 변환 및 조명 기능을 확인하여 적합한 처리 방법 결정
 
 	D3DCAPS9 caps;
 	d3d9->GetDeviceCaps(D3DADAPTER_DEFAULT, deviceType, &caps);  
 	
 	int vp = 0;
-	if( caps.DevCaps & D3DDEVCAPS_HWTRANSFORMANDLIGHT )  // ϵ  ȯ   O
+	if( caps.DevCaps & D3DDEVCAPS_HWTRANSFORMANDLIGHT )  // 하드웨어 가속 변환과 조명이 지원 O
 		vp = D3DCREATE_HARDWARE_VERTEXPROCESSING;
 	else
 		vp = D3DCREATE_SOFTWARE_VERTEXPROCESSING;
@@ -98,8 +98,8 @@ bool d3d::InitD3D(
     UINT w = rc.right - rc.left;
     UINT h = rc.bottom - rc.top;
 
-	// D3DPRESENT_PARAMETERS : Direct3D ġ    
-	// ػ,  ,  ø,  ȿ   
+	// D3DPRESENT_PARAMETERS : Direct3D 장치에 대한 설정 포함 
+	// 해상도, 백버퍼 형식, 다중 샘플링, 스왑 효과 등 설정 
 	D3DPRESENT_PARAMETERS d3dpp;
 	d3dpp.BackBufferWidth            = w;
 	d3dpp.BackBufferHeight           = h;
@@ -111,7 +111,7 @@ bool d3d::InitD3D(
 	d3dpp.hDeviceWindow              = hwnd;
 	d3dpp.Windowed                   = windowed;
 	d3dpp.EnableAutoDepthStencil     = true; 
-	d3dpp.AutoDepthStencilFormat     = D3DFMT_D24S8;  // ڵ  ٽ   
+	d3dpp.AutoDepthStencilFormat     = D3DFMT_D24S8;  // 자동 깊이 스텐실 형식 설정 
 	d3dpp.Flags                      = 0;
 	d3dpp.FullScreen_RefreshRateInHz = D3DPRESENT_RATE_DEFAULT;
 	d3dpp.PresentationInterval       = D3DPRESENT_INTERVAL_IMMEDIATE;
@@ -139,7 +139,7 @@ bool d3d::InitD3D(
 			&d3dpp,
 			device);
 
-		// 2° õ ϸ d3d9 ü ϰ ޽   false ȯ 
+		// 2번째 시도도 실패하면 d3d9 객체를 해제하고 오류메시지 띄운 후 false 반환 
 		if( FAILED(hr) )
 		{
 			d3d9->Release(); // done with d3d9 object
@@ -153,37 +153,45 @@ bool d3d::InitD3D(
 	return true;
 }
 
-// Direct3D ø̼ ޽   - α׷  
-int d3d::EnterMsgLoop( bool (*ptr_display)(float timeDelta) )
+// Direct3D 애플리케이션의 메시지 루프 구현 - 프로그램의 실행 관리
+int d3d::EnterMsgLoop( bool (*ptr_display)(float timeDelta), const double* timeScale, void (*ptr_wait)(void) )
 {
-	MSG msg;   // Windows ޽ 
-	::ZeroMemory(&msg, sizeof(MSG));   // ޽ ü ʱȭ =>    ʿ    ʵ 
+	MSG msg;   // Windows 메시지 저장
+	::ZeroMemory(&msg, sizeof(MSG));   // 메시지 구조체 초기화 => 루프 시작 전 불필요한 값이 들어 있지 않도록 함
 
-	// lastTime :    ð  (и )
-	//  Ӱ    ð (timeDelta) 
+	// lastTime : 루프 실행 시작 시간 저장 (밀리 초)
+	// 이전 프레임과 현재 프레임 간의 시간 차이(timeDelta) 계산
 	static double lastTime = (double)timeGetTime(); 
 
 	while(msg.message != WM_QUIT)
 	{
-		if(::PeekMessage(&msg, 0, 0, 0, PM_REMOVE))  // PeekMessage : ޽ ť ޽ Ȯ
+		// a paced frame waits first : input arriving during the wait is still
+		// read below, and timeDelta includes the wait
+		if(ptr_wait)
+			ptr_wait();
+
+		// handle every pending message before the next frame, so all mouse
+		// moves since the last frame are applied together in that frame
+		while(msg.message != WM_QUIT && ::PeekMessage(&msg, 0, 0, 0, PM_REMOVE))  // PeekMessage : 메시지 큐에서 메시지 확인
 		{
-			::TranslateMessage(&msg);  // Ű Է ޽ ó ȭ
-			::DispatchMessage(&msg);   // ޽ óϴ ν(WndProc) 
+			::TranslateMessage(&msg);  // 키보드 입력 메시지 처리를 간소화
+			::DispatchMessage(&msg);   // 메시지를 처리하는 프로시저(WndProc)로 전달
 		}
-		else  // ޽   ȭ 
+		if(msg.message != WM_QUIT)  // 메시지가 없을 경우 화면 갱신
         {	
 			double currTime  = (double)timeGetTime();
-			double timeDelta = (currTime - lastTime)*0.0007;
-			// * 0.0007: ð    ϴ  -> α׷    ӵ 
-			ptr_display((float)timeDelta);  //  ϴ ܺ Լ(ͷ ޵) ȣ -> ȭ 
+			double timeDelta = (currTime - lastTime)*(timeScale ? *timeScale : 0.0007);
+			// * 0.0007: 시간 배율 조정을 위해 사용하는 상수 -> 프로그램에서 프레임 간 동작 속도를 조절
+			// (-config 파일의 clockScale 로 바꿀 수 있음)
+			ptr_display((float)timeDelta);  // 렌더링을 담당하는 외부 함수(포인터로 전달됨) 호출 -> 화면 갱신
 
-			lastTime = currTime;   // ð Ʈ ->   
+			lastTime = currTime;   // 시간 업데이트 -> 다음 루프에서 사용
         }
     }
     return msg.wParam;
 }
 
-// Directional Light(Ư ⿡  ) ʱȭ Լ
+// Directional Light(특정 방향에서 오는 빛) 초기화 함수
 D3DLIGHT9 d3d::InitDirectionalLight(D3DXVECTOR3* direction, D3DXCOLOR* color)
 {
 	D3DLIGHT9 light;
@@ -262,7 +270,7 @@ d3d::BoundingBox::BoundingBox()
 	_max.z = -INFINITY;
 }
 
-// ־ 3D  p BoundingBox ȿ ԵǾ ִ Ȯ 
+// 주어진 3D 점 p가 BoundingBox 안에 포함되어 있는지 확인 
 bool d3d::BoundingBox::isPointInside(D3DXVECTOR3& p)
 {
 	if( p.x >= _min.x && p.y >= _min.y && p.z >= _min.z &&
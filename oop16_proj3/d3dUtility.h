@@ -36,7 +36,9 @@ namespace d3d
 		IDirect3DDevice9** device);// [out]The created device.
 
 	int EnterMsgLoop( 
-		bool (*ptr_display)(float timeDelta));
+		bool (*ptr_display)(float timeDelta),
+		const double* timeScale = 0,  // [in] timeDelta per millisecond, read every frame (0 : 0.0007)
+		void (*ptr_wait)(void) = 0);  // [in] called before each frame reads its messages (frame pacing)
 
 	LRESULT CALLBACK WndProc(
 		HWND hwnd,
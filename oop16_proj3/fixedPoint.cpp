@@ -0,0 +1,20 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: fixedPoint.cpp
+//
+// Desc: Q16.16 fixed-point numbers for the deterministic physics build.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "fixedPoint.h"
+
+void makeFixedPhysicsConfig(const PhysicsConfig& config, FixedPhysicsConfig& fixedConfig)
+{
+    fixedConfig.decreaseRate = fxFromFloat((float)config.decreaseRate);
+    fixedConfig.friction = fxFromFloat((float)((1 - config.decreaseRate) * 400));
+    fixedConfig.minVelocity = fxFromFloat(config.minVelocity);
+    fixedConfig.slowBoost = fxFromFloat(config.slowBoost);
+    fixedConfig.maxSpeed = fxFromFloat(config.maxSpeed);
+    fixedConfig.timeScale = fxFromFloat(config.timeScale);
+    fixedConfig.shotSpeed = fxFromFloat((float)config.shotSpeed);
+}
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: fixedPoint.h
+//
+// Desc: Q16.16 fixed-point numbers for the deterministic physics build.
+//       Float results may differ between compilers and CPUs (x87 or SSE,
+//       fused multiply-add, library sqrt / acos / pow), which breaks lockstep
+//       play and replay checks between machines. Integer math gives the same
+//       bits everywhere.
+//
+//       Building with PHYSICS_FIXED_POINT defined makes CGameSession run its
+//       rules on these numbers; nothing else changes. BallState keeps its
+//       floats, but every value in them is then an exact Q16.16 number (table
+//       values stay far below 256, so 24 float bits hold them), and moving
+//       between the two loses nothing.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __fixedPointH__
+#define __fixedPointH__
+
+#include "physicsConfig.h"
+#include <cmath>
+
+typedef int fixed;      // Q16.16
+
+const int   FIXED_SHIFT = 16;
+const fixed FIXED_ONE = 1 << FIXED_SHIFT;
+
+// compile-time constant, rounded to nearest
+#define FIXED_CONST(v) ((fixed)((v) * 65536.0 + ((v) < 0 ? -0.5 : 0.5)))
+
+// rounded to nearest; exact for floats that already are Q16.16 values
+inline fixed fxFromFloat(float v)
+{
+    double scaled = (double)v * 65536.0;
+    return (fixed)(scaled + (scaled < 0 ? -0.5 : 0.5));
+}
+
+// for floats that hold a Q16.16 value (all simulation state) : exact, and
+// cheaper than rounding
+inline fixed fxExact(float v) { return (fixed)(v * 65536.0f); }
+
+inline float fxToFloat(fixed v) { return (float)v * (1.0f / 65536.0f); }
+
+inline fixed fxMul(fixed a, fixed b) { return (fixed)(((long long)a * b) >> FIXED_SHIFT); }
+inline fixed fxDiv(fixed a, fixed b) { return (fixed)((long long)a * FIXED_ONE / b); }
+inline fixed fxAbs(fixed v) { return v < 0 ? -v : v; }
+
+// floor(sqrt(v)) for v below 2^62. the double root is only a first guess;
+// the integer checks make the result exact, whatever the machine's rounding
+inline unsigned fxIsqrt(unsigned long long v)
+{
+    unsigned long long r = (unsigned long long)sqrt((double)(long long)v);
+    while (r > 0 && r * r > v)
+        r--;
+    while ((r + 1) * (r + 1) <= v)
+        r++;
+    return (unsigned)r;
+}
+
+// length of (x, z) : the root of a Q32.32 square is Q16.16
+inline fixed fxLength(fixed x, fixed z)
+{
+    return (fixed)fxIsqrt((unsigned long long)((long long)x * x + (long long)z * z));
+}
+
+// PhysicsConfig in Q16.16, converted once per setConfig()
+struct FixedPhysicsConfig
+{
+    fixed   decreaseRate;
+    fixed   friction;       // (1 - decreaseRate) * 400, the time-dependent part
+    fixed   minVelocity;
+    fixed   slowBoost;
+    fixed   maxSpeed;
+    fixed   timeScale;
+    fixed   shotSpeed;
+};
+
+void makeFixedPhysicsConfig(const PhysicsConfig& config, FixedPhysicsConfig& fixedConfig);
+
+#endif // __fixedPointH__
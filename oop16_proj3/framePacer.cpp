@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: framePacer.cpp
+//
+// Desc: Frame pacing and input latency measurement.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "framePacer.h"
+#include <algorithm>
+#include <thread>
+
+// sleep() may wake up late by about a scheduler tick, so the last part of
+// the wait is spent yielding instead
+const std::chrono::microseconds SPIN_MARGIN(1500);
+
+CFramePacer::CFramePacer(void)
+{
+    m_period = Clock::duration::zero();
+    m_deadline = Clock::now();
+    m_pending = false;
+    m_inFlight = false;
+    m_sampleCount = 0;
+    m_totalMs = 0.0;
+    m_maxMs = 0.0;
+}
+
+void CFramePacer::setTargetFps(float fps)
+{
+    if (fps > 0.0f)
+        m_period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    else
+        m_period = Clock::duration::zero();
+    m_deadline = Clock::now();
+}
+
+void CFramePacer::waitForFrame(void)
+{
+    if (m_period == Clock::duration::zero())
+        return;
+
+    Clock::time_point now = Clock::now();
+    if (m_deadline - now > SPIN_MARGIN)
+        std::this_thread::sleep_until(m_deadline - SPIN_MARGIN);
+    while (Clock::now() < m_deadline)
+        std::this_thread::yield();
+
+    // a frame that ran long starts a new schedule instead of bursting to catch up
+    m_deadline += m_period;
+    now = Clock::now();
+    if (m_deadline < now)
+        m_deadline = now + m_period;
+}
+
+void CFramePacer::markInput(void)
+{
+    if (!m_pending) {
+        m_pending = true;
+        m_pendingTime = Clock::now();
+    }
+}
+
+void CFramePacer::consumeInput(void)
+{
+    if (!m_pending)
+        return;
+    m_pending = false;
+
+    // keep the older stamp if the last frame never got presented
+    if (!m_inFlight) {
+        m_inFlight = true;
+        m_inFlightTime = m_pendingTime;
+    }
+}
+
+void CFramePacer::framePresented(void)
+{
+    if (!m_inFlight)
+        return;
+    m_inFlight = false;
+
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - m_inFlightTime).count();
+    if ((int)m_recent.size() < RECENT_SAMPLES)
+        m_recent.push_back((float)ms);
+    else
+        m_recent[m_sampleCount % RECENT_SAMPLES] = (float)ms;
+    m_sampleCount++;
+    m_totalMs += ms;
+    m_maxMs = std::max(m_maxMs, ms);
+}
+
+double CFramePacer::getMeanMs(void) const
+{
+    return m_sampleCount > 0 ? m_totalMs / m_sampleCount : 0.0;
+}
+
+double CFramePacer::getPercentileMs(double percentile) const
+{
+    if (m_recent.empty())
+        return 0.0;
+
+    std::vector<float> sorted(m_recent);
+    size_t rank = (size_t)(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+    rank = std::min(rank, sorted.size() - 1);
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+}
@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: framePacer.h
+//
+// Desc: Frame pacing and input latency measurement. Mouse input is only
+//       stamped when it arrives; the frame applies it right before the
+//       physics step, and the time from the oldest applied input to the
+//       end of Present() is kept as a latency sample.
+//
+//       With a target rate the pacer waits at the start of the frame, not
+//       after Present(), so input that arrives during the wait still makes
+//       it into the frame.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __framePacerH__
+#define __framePacerH__
+
+#include <chrono>
+#include <vector>
+
+class CFramePacer {
+public:
+    CFramePacer(void);
+
+    // 0 : no waiting, render as fast as possible (the default)
+    void setTargetFps(float fps);
+
+    // start of a frame : sleep until the next frame is due
+    void waitForFrame(void);
+
+    // an input event arrived. only the oldest one since the last frame counts
+    void markInput(void);
+    // the pending input is applied to the frame being built now
+    void consumeInput(void);
+    // the frame was presented : closes the latency sample of consumed input
+    void framePresented(void);
+
+    int    getSampleCount(void) const { return m_sampleCount; }
+    double getMeanMs(void) const;
+    double getMaxMs(void) const { return m_maxMs; }
+    // percentile (0..100) over the most recent samples
+    double getPercentileMs(double percentile) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    enum { RECENT_SAMPLES = 1024 };
+
+    Clock::duration     m_period;       // zero : pacing off
+    Clock::time_point   m_deadline;
+
+    bool                m_pending;      // input arrived since the last consumeInput()
+    Clock::time_point   m_pendingTime;
+    bool                m_inFlight;     // consumed input waiting for Present()
+    Clock::time_point   m_inFlightTime;
+
+    int                 m_sampleCount;
+    double              m_totalMs;
+    double              m_maxMs;
+    std::vector<float>  m_recent;       // ring of the last RECENT_SAMPLES samples
+};
+
+#endif // __framePacerH__
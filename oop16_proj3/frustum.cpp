@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: frustum.cpp
+//
+// Desc: Frustum planes from a view * projection matrix and sphere tests.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "frustum.h"
+#include <cmath>
+#include <algorithm>
+
+CFrustum::CFrustum(void)
+{
+    // everything inside : 0 x + 0 y + 0 z + 1 >= 0
+    for (int i = 0; i < PLANES; i++) {
+        m_planes[i].a = m_planes[i].b = m_planes[i].c = 0;
+        m_planes[i].d = 1;
+    }
+}
+
+// a point p is inside when its clip coordinates (p * m) satisfy -w <= x <= w,
+// -w <= y <= w and 0 <= z <= w. each of these is a plane : a column of m plus
+// or minus the w column
+void CFrustum::extract(const D3DXMATRIX& m)
+{
+    float column[4][4];
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++)
+            column[c][r] = m.m[r][c];
+    }
+    const float* x = column[0];
+    const float* y = column[1];
+    const float* z = column[2];
+    const float* w = column[3];
+    for (int k = 0; k < 4; k++) {
+        float plane[PLANES] = {
+            w[k] + x[k],    // left
+            w[k] - x[k],    // right
+            w[k] + y[k],    // bottom
+            w[k] - y[k],    // top
+            z[k],           // near
+            w[k] - z[k],    // far
+        };
+        for (int i = 0; i < PLANES; i++)
+            (&m_planes[i].a)[k] = plane[i];
+    }
+
+    // unit normals, so a plane gives the distance to compare with a radius
+    for (int i = 0; i < PLANES; i++) {
+        D3DXPLANE& p = m_planes[i];
+        float length = sqrtf(p.a * p.a + p.b * p.b + p.c * p.c);
+        if (length > 0) {
+            p.a /= length;  p.b /= length;  p.c /= length;  p.d /= length;
+        }
+    }
+}
+
+bool CFrustum::isVisible(const d3d::BoundingSphere& sphere) const
+{
+    for (int i = 0; i < PLANES; i++) {
+        const D3DXPLANE& p = m_planes[i];
+        if (p.a * sphere._center.x + p.b * sphere._center.y + p.c * sphere._center.z + p.d < -sphere._radius)
+            return false;
+    }
+    return true;
+}
+
+// the planes are plain scalars and the spheres __restrict arrays, so the
+// loop has no branch and no aliasing for the compiler to worry about
+static int cullSpheres(const D3DXPLANE* planes, const float* __restrict x, const float* __restrict y,
+    const float* __restrict z, const float* __restrict r, int count, unsigned char* __restrict visible)
+{
+    const float a0 = planes[0].a, b0 = planes[0].b, c0 = planes[0].c, d0 = planes[0].d;
+    const float a1 = planes[1].a, b1 = planes[1].b, c1 = planes[1].c, d1 = planes[1].d;
+    const float a2 = planes[2].a, b2 = planes[2].b, c2 = planes[2].c, d2 = planes[2].d;
+    const float a3 = planes[3].a, b3 = planes[3].b, c3 = planes[3].c, d3 = planes[3].d;
+    const float a4 = planes[4].a, b4 = planes[4].b, c4 = planes[4].c, d4 = planes[4].d;
+    const float a5 = planes[5].a, b5 = planes[5].b, c5 = planes[5].c, d5 = planes[5].d;
+    int inside = 0;
+    for (int i = 0; i < count; i++) {
+        // the nearest plane decides : inside when no plane has the center
+        // further out than the radius
+        float nearest = std::min(std::min(
+            std::min(a0 * x[i] + b0 * y[i] + c0 * z[i] + d0, a1 * x[i] + b1 * y[i] + c1 * z[i] + d1),
+            std::min(a2 * x[i] + b2 * y[i] + c2 * z[i] + d2, a3 * x[i] + b3 * y[i] + c3 * z[i] + d3)),
+            std::min(a4 * x[i] + b4 * y[i] + c4 * z[i] + d4, a5 * x[i] + b5 * y[i] + c5 * z[i] + d5));
+        unsigned char in = (unsigned char)(nearest >= -r[i]);
+        visible[i] = in;
+        inside += in;
+    }
+    return inside;
+}
+
+int CFrustum::cull(const float* x, const float* y, const float* z, const float* r, int count,
+    unsigned char* visible) const
+{
+    return cullSpheres(m_planes, x, y, z, r, count, visible);
+}
+
+void transformSphere(d3d::BoundingSphere& out, const d3d::BoundingSphere& local, const D3DXMATRIX& m)
+{
+    const D3DXVECTOR3& c = local._center;
+    D3DXVECTOR3 center(
+        c.x * m._11 + c.y * m._21 + c.z * m._31 + m._41,
+        c.x * m._12 + c.y * m._22 + c.z * m._32 + m._42,
+        c.x * m._13 + c.y * m._23 + c.z * m._33 + m._43);
+    float scale = std::max(std::max(
+        m._11 * m._11 + m._12 * m._12 + m._13 * m._13,
+        m._21 * m._21 + m._22 * m._22 + m._23 * m._23),
+        m._31 * m._31 + m._32 * m._32 + m._33 * m._33);
+    out._center = center;
+    out._radius = local._radius * sqrtf(scale);
+}
@@ -0,0 +1,45 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: frustum.h
+//
+// Desc: View frustum culling. The six planes come straight out of the
+//       view * projection matrix, and spheres are tested in batches from one
+//       array per coordinate, a branch free loop the compiler runs 4 spheres
+//       at a time. Objects outside the frustum (the table rotated or moved
+//       partly off screen) are then not drawn at all.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __frustumH__
+#define __frustumH__
+
+#include "d3dUtility.h"
+
+class CFrustum {
+public:
+    CFrustum(void);
+
+    // planes of mViewProj (view * projection, Direct3D clip space with
+    // 0 <= z <= w). until the first call every sphere is visible
+    void extract(const D3DXMATRIX& mViewProj);
+
+    // whether a world space sphere is at least partly inside
+    bool isVisible(const d3d::BoundingSphere& sphere) const;
+
+    // visible[i] = 1 when sphere i (center x/y/z[i], radius r[i]) is at least
+    // partly inside, else 0. returns how many are visible
+    int cull(const float* x, const float* y, const float* z, const float* r, int count,
+        unsigned char* visible) const;
+
+private:
+    enum { PLANES = 6 };
+
+    // a x + b y + c z + d >= 0 inside, (a, b, c) unit length
+    D3DXPLANE   m_planes[PLANES];
+};
+
+// world space bounds of 'local' (object space) moved by mWorld. a scaled
+// matrix scales the radius by its largest axis
+void transformSphere(d3d::BoundingSphere& out, const d3d::BoundingSphere& local, const D3DXMATRIX& mWorld);
+
+#endif // __frustumH__
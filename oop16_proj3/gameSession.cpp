@@ -0,0 +1,1132 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: gameSession.cpp
+//
+// Desc: Headless game core. The rules here are the ones the window
+//       application used to run inline in CSphere, CWall and Display().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "gameSession.h"
+#include <cmath>
+#include <algorithm>
+
+// initialize the position (coordinate) of each ball
+const float spherePos[BRICK_COUNT][2] = {
+
+    // outer frame
+    {-1.47f,-4}, {-1.05f,-4}, {-0.63f,-4}, {-0.21f,-4}, {0.21f,-4}, {0.63f,-4}, {1.05f,-4}, {1.47f,-4},
+    {-1.89f, -3.58f}, {1.89f, -3.58f},
+    {-2.31f, -3.16f}, {-2.31f, -2.74f}, {-2.31f, -2.32f}, {-2.31f, -1.9f}, {-2.31f, -1.48f}, {-2.31f, -1.06f},
+    {2.31f, -3.16f}, {2.31f, -2.74f}, {2.31f, -2.32f}, {2.31f, -1.9f}, {2.31f, -1.48f}, {2.31f, -1.06f},
+    // eyes
+    {-1.05f,-2.74f}, {-1.05f,-2.32f}, {1.05f,-2.74f}, {1.05f,-2.32f},
+    // nose
+    {0, -1.48f}, {0, -1.06f},
+    // mouth
+    {-1.47f, -0.64f}, {-1.05f,-0.22f}, {-0.63f,0.2f}, {-0.21f,0.2f}, {0.21f,0.2f}, {0.63f,0.2f}, {1.05f,-0.22f}, {1.47f, -0.64f}
+
+};
+
+// -----------------------------------------------------------------------------
+// Ball / wall rules
+// -----------------------------------------------------------------------------
+
+static void setBall(BallState& ball, float x, float y, float z)
+{
+    ball.x = x;     ball.y = y;     ball.z = z;
+    ball.vx = 0;    ball.vz = 0;
+    ball.wx = 0;    ball.wy = 0;    ball.wz = 0;
+}
+
+static ContactEvent makeContact(ContactKind kind, int a, int b, float nx, float nz, float penetration, float relativeSpeed)
+{
+    ContactEvent c;
+    c.kind = (short)kind;
+    c.a = (short)a;
+    c.b = (short)b;
+    c.reserved = 0;
+    c.nx = nx;
+    c.nz = nz;
+    c.penetration = penetration;
+    c.relativeSpeed = relativeSpeed;
+    return c;
+}
+
+#ifdef PHYSICS_FIXED_POINT
+
+// Q16.16 rules. they read and write the floats of BallState and ContactEvent,
+// which only ever hold exact Q16.16 values in this build
+
+static const fixed FIXED_RADIUS = FIXED_CONST(M_RADIUS);
+static const fixed FIXED_STOP = FIXED_CONST(0.01);          // slower velocity components are zeroed
+static const fixed FIXED_PADDLE_STEP = FIXED_CONST(-0.01);  // paddle movement per mouse pixel
+
+static float quantize(float v)
+{
+    return fxToFloat(fxFromFloat(v));
+}
+
+static bool hasIntersected(const BallState& a, const BallState& b)
+{
+    long long dx = fxExact(a.x) - fxExact(b.x);
+    long long dy = fxExact(a.y) - fxExact(b.y);
+    long long dz = fxExact(a.z) - fxExact(b.z);
+    long long radiusSum = 2 * FIXED_RADIUS;
+    return dx * dx + dy * dy + dz * dz <= radiusSum * radiusSum;
+}
+
+static void reflect(BallState& ball, float nx, float nz)
+{
+    fixed fnx = fxExact(nx);
+    fixed fnz = fxExact(nz);
+    fixed vx = fxExact(ball.vx);
+    fixed vz = fxExact(ball.vz);
+    fixed dot = fxMul(fnx, vx) + fxMul(fnz, vz);
+    ball.vx = fxToFloat(vx - 2 * fxMul(fnx, dot));
+    ball.vz = fxToFloat(vz - 2 * fxMul(fnz, dot));
+}
+
+static void ballUpdate(BallState& ball, fixed dt, const FixedPhysicsConfig& config)
+{
+    fixed vx = fxExact(ball.vx);
+    fixed vz = fxExact(ball.vz);
+
+    if (fxAbs(vx) > FIXED_STOP || fxAbs(vz) > FIXED_STOP) {
+        fixed scale = fxMul(config.timeScale, dt);
+        ball.x = fxToFloat(fxExact(ball.x) + fxMul(scale, vx));
+        ball.z = fxToFloat(fxExact(ball.z) + fxMul(scale, vz));
+    }
+    else {
+        vx = 0;
+        vz = 0;
+    }
+    vx = fxMul(vx, config.decreaseRate);
+    vz = fxMul(vz, config.decreaseRate);
+
+    fixed rate = FIXED_ONE - fxMul(config.friction, dt);
+    if (rate < 0)
+        rate = 0;
+
+    fixed newVelocityX = fxMul(vx, rate);
+    fixed newVelocityZ = fxMul(vz, rate);
+
+    vx = newVelocityX < config.minVelocity ? fxMul(newVelocityX, config.slowBoost) : newVelocityX;
+    vz = newVelocityZ < config.minVelocity ? fxMul(newVelocityZ, config.slowBoost) : newVelocityZ;
+
+    // floor(speed) > maxSpeed, without the root for the usual slower ball
+    long long speed2 = (long long)newVelocityX * newVelocityX + (long long)newVelocityZ * newVelocityZ;
+    long long limit = config.maxSpeed + 1;
+    if (speed2 >= limit * limit) {
+        fixed speedFactor = fxDiv(config.maxSpeed, (fixed)fxIsqrt((unsigned long long)speed2));
+        vx = fxMul(newVelocityX, speedFactor);
+        vz = fxMul(newVelocityZ, speedFactor);
+    }
+    ball.vx = fxToFloat(vx);
+    ball.vz = fxToFloat(vz);
+}
+
+// closing speed of a ball moving along -(nx, nz)
+static float closingSpeed(const BallState& ball, float nx, float nz)
+{
+    return fxToFloat(-(fxMul(fxExact(ball.vx), fxExact(nx)) + fxMul(fxExact(ball.vz), fxExact(nz))));
+}
+
+static ContactEvent ballContact(ContactKind kind, int a, int b, const BallState& ball, const BallState& other)
+{
+    fixed dx = fxExact(ball.x) - fxExact(other.x);
+    fixed dz = fxExact(ball.z) - fxExact(other.z);
+    fixed distance = fxLength(dx, dz);
+    fixed nx = distance > 0 ? fxDiv(dx, distance) : 0;
+    fixed nz = distance > 0 ? fxDiv(dz, distance) : FIXED_ONE;
+    fixed rvx = fxExact(ball.vx) - fxExact(other.vx);
+    fixed rvz = fxExact(ball.vz) - fxExact(other.vz);
+    fixed closing = -(fxMul(rvx, nx) + fxMul(rvz, nz));
+    return makeContact(kind, a, b, fxToFloat(nx), fxToFloat(nz), fxToFloat(2 * FIXED_RADIUS - distance), fxToFloat(closing));
+}
+
+static void ballWallPenetration(const FixedTable& table, const BallState& ball, float out[WALL_COUNT])
+{
+    fixed x = fxExact(ball.x);
+    fixed z = fxExact(ball.z);
+    for (int k = 0; k < WALL_COUNT; k++) {
+        fixed side = fxMul(table.nx[k], x) + fxMul(table.nz[k], z) - table.d[k];
+        out[k] = fxToFloat(FIXED_RADIUS - side);
+    }
+}
+
+// whether the ball overlaps brick i
+static inline bool brickIntersected(const FixedTable& table, int i, fixed x, long long dy, fixed z)
+{
+    // most bricks are rejected along x alone, before any multiply
+    long long radiusSum = 2 * FIXED_RADIUS;
+    long long dx = x - table.brickX[i];
+    if (dx > radiusSum || dx < -radiusSum)
+        return false;
+    long long dz = z - table.brickZ[i];
+    return dx * dx + dy * dy + dz * dz <= radiusSum * radiusSum;
+}
+
+// exact test of one segment picked by the float BVH query, as CBoundaryBVH::query does it
+static bool segmentContact(const Segment& s, const BallState& ball, const SegmentHit& candidate, SegmentHit* hit)
+{
+    fixed x0 = fxExact(s.x0), z0 = fxExact(s.z0);
+    long long ex = fxExact(s.x1) - x0;
+    long long ez = fxExact(s.z1) - z0;
+    long long px = fxExact(ball.x) - x0;
+    long long pz = fxExact(ball.z) - z0;
+
+    // closest point at along / len2 of the segment
+    long long len2 = ex * ex + ez * ez;
+    long long along = px * ex + pz * ez;
+    if (len2 <= 0 || along < 0)
+        along = 0;
+    else if (along > len2)
+        along = len2;
+
+    long long dx = len2 > 0 ? px - ex * along / len2 : px;
+    long long dz = len2 > 0 ? pz - ez * along / len2 : pz;
+    long long dist2 = dx * dx + dz * dz;
+    if (dist2 >= (long long)FIXED_RADIUS * FIXED_RADIUS)
+        return false;
+
+    // center on the segment : the side the float query picked, rounded
+    fixed dist = dist2 > 0 ? (fixed)fxIsqrt((unsigned long long)dist2) : 0;
+    if (dist <= 0) {
+        hit->nx = fxToFloat(fxFromFloat(candidate.nx));
+        hit->nz = fxToFloat(fxFromFloat(candidate.nz));
+        hit->penetration = fxToFloat(FIXED_RADIUS);
+        return true;
+    }
+    hit->nx = fxToFloat(fxDiv((fixed)dx, dist));
+    hit->nz = fxToFloat(fxDiv((fixed)dz, dist));
+    hit->penetration = fxToFloat(FIXED_RADIUS - dist);
+    return true;
+}
+
+// push the ball back out of the wall along the wall normal
+static void pushOut(BallState& ball, const ContactEvent& c)
+{
+    fixed penetration = fxExact(c.penetration);
+    ball.x = fxToFloat(fxExact(ball.x) + fxMul(fxExact(c.nx), penetration));
+    ball.z = fxToFloat(fxExact(ball.z) + fxMul(fxExact(c.nz), penetration));
+}
+
+static void bounce(BallState& ball, const ContactEvent& c, const FixedPhysicsConfig& config)
+{
+    fixed nx = fxExact(c.nx);
+    fixed nz = fxExact(c.nz);
+    fixed vx = fxExact(ball.vx);
+    fixed vz = fxExact(ball.vz);
+
+    // only bounce a ball that is still moving into the wall
+    fixed dotProduct = fxMul(vx, nx) + fxMul(vz, nz);
+    if (dotProduct >= 0)
+        return;
+
+    fixed reflectionX = vx - 2 * fxMul(dotProduct, nx);
+    fixed reflectionZ = vz - 2 * fxMul(dotProduct, nz);
+
+    // speed < minVelocity, compared squared
+    fixed minVelocity = config.minVelocity;
+    long long speed2 = (long long)reflectionX * reflectionX + (long long)reflectionZ * reflectionZ;
+    if (speed2 < (long long)minVelocity * minVelocity) {
+        if (reflectionX != 0)
+            reflectionX = reflectionX > 0 ? minVelocity : -minVelocity;
+        if (reflectionZ != 0)
+            reflectionZ = reflectionZ > 0 ? minVelocity : -minVelocity;
+    }
+
+    ball.vx = fxToFloat(reflectionX);
+    ball.vz = fxToFloat(reflectionZ);
+}
+
+#else
+
+static float quantize(float v)
+{
+    return v;
+}
+
+// use the center coordinates of two balls to return whether they are in contact
+static bool hasIntersected(const BallState& a, const BallState& b)
+{
+    float dx = a.x - b.x;
+    float dy = a.y - b.y;
+    float dz = a.z - b.z;
+    float radiusSum = (float)(M_RADIUS + M_RADIUS);
+    return dx * dx + dy * dy + dz * dz <= radiusSum * radiusSum;
+}
+
+// reflect ball's velocity about the unit normal (nx, nz)
+static void reflect(BallState& ball, float nx, float nz)
+{
+    float dot = nx * ball.vx + nz * ball.vz;
+    ball.vx = -2 * nx * dot + ball.vx;
+    ball.vz = -2 * nz * dot + ball.vz;
+}
+
+// move the ball and adjust its speed not to become too slow or too large
+static void ballUpdate(BallState& ball, float timeDiff, const PhysicsConfig& config)
+{
+    if (fabs(ball.vx) > 0.01 || fabs(ball.vz) > 0.01) {
+        ball.x += config.timeScale * timeDiff * ball.vx;
+        ball.z += config.timeScale * timeDiff * ball.vz;
+    }
+    else {
+        ball.vx = 0;
+        ball.vz = 0;
+    }
+    ball.vx = (float)(ball.vx * config.decreaseRate);
+    ball.vz = (float)(ball.vz * config.decreaseRate);
+
+    double rate = 1 - (1 - config.decreaseRate) * timeDiff * 400;
+    if (rate < 0)
+        rate = 0;
+
+    float newVelocityX = (float)(ball.vx * rate);
+    float newVelocityZ = (float)(ball.vz * rate);
+
+    float mul = config.slowBoost;
+
+    ball.vx = newVelocityX < config.minVelocity ? newVelocityX * mul : newVelocityX;
+    ball.vz = newVelocityZ < config.minVelocity ? newVelocityZ * mul : newVelocityZ;
+
+    // cap the speed so it never grows too large
+    float maxSpeed = config.maxSpeed;
+    float currentSpeed = sqrt(newVelocityX * newVelocityX + newVelocityZ * newVelocityZ);
+    if (currentSpeed > maxSpeed) {
+        float speedFactor = maxSpeed / currentSpeed;
+        ball.vx = newVelocityX * speedFactor;
+        ball.vz = newVelocityZ * speedFactor;
+    }
+}
+
+// contact between a moving ball and another ball. the normal points from 'other' to 'ball'
+static ContactEvent ballContact(ContactKind kind, int a, int b, const BallState& ball, const BallState& other)
+{
+    float dx = ball.x - other.x;
+    float dz = ball.z - other.z;
+    float distance = sqrt(dx * dx + dz * dz);
+    float nx = dx / distance;
+    float nz = dz / distance;
+    float closing = -((ball.vx - other.vx) * nx + (ball.vz - other.vz) * nz);
+    return makeContact(kind, a, b, nx, nz, (float)(M_RADIUS + M_RADIUS) - distance, closing);
+}
+
+static float closingSpeed(const BallState& ball, float nx, float nz)
+{
+    return -(ball.vx * nx + ball.vz * nz);
+}
+
+static void ballWallPenetration(const WallPlanes& planes, const BallState& ball, float out[WALL_COUNT])
+{
+    wallPenetration(planes, ball.x, ball.z, (float)M_RADIUS, out);
+}
+
+// push the ball back out of the wall along the wall normal
+static void pushOut(BallState& ball, const ContactEvent& c)
+{
+    ball.x += c.nx * c.penetration;
+    ball.z += c.nz * c.penetration;
+}
+
+static void bounce(BallState& ball, const ContactEvent& c, const PhysicsConfig& config)
+{
+    // only bounce a ball that is still moving into the wall
+    float dotProduct = ball.vx * c.nx + ball.vz * c.nz;
+    if (dotProduct >= 0.0f)
+        return;
+
+    // R = V - 2 * (V . N) * N
+    float reflectionX = ball.vx - 2 * dotProduct * c.nx;
+    float reflectionZ = ball.vz - 2 * dotProduct * c.nz;
+
+    // too slow after the bounce : every moving component gets at least minVelocity
+    float minVelocity = config.minVelocity;
+    if (sqrt(reflectionX * reflectionX + reflectionZ * reflectionZ) < minVelocity) {
+        if (reflectionX != 0.0f)
+            reflectionX = reflectionX > 0.0f ? minVelocity : -minVelocity;
+        if (reflectionZ != 0.0f)
+            reflectionZ = reflectionZ > 0.0f ? minVelocity : -minVelocity;
+    }
+
+    ball.vx = reflectionX;
+    ball.vz = reflectionZ;
+}
+
+#endif // PHYSICS_FIXED_POINT
+
+// box wall centered at (x, z). its inner face is the long side facing (cx, cz)
+static WallState makeWall(float x, float z, float width, float depth, float cx, float cz)
+{
+    WallState wall;
+    wall.x = x;
+    wall.z = z;
+    wall.width = width;
+    wall.depth = depth;
+
+    if (depth < width) {
+        wall.nx = 0.0f;
+        wall.nz = cz > z ? 1.0f : -1.0f;
+        wall.d = wall.nz * (z + wall.nz * depth / 2.0f);
+    }
+    else {
+        wall.nx = cx > x ? 1.0f : -1.0f;
+        wall.nz = 0.0f;
+        wall.d = wall.nx * (x + wall.nx * width / 2.0f);
+    }
+    return wall;
+}
+
+void wallPenetration(const WallPlanes& planes, float x, float z, float radius, float out[WALL_COUNT])
+{
+    for (int k = 0; k < WALL_COUNT; k++)
+        out[k] = radius - (planes.nx[k] * x + planes.nz[k] * z - planes.d[k]);
+}
+
+void wallPenetrations(const WallPlanes& planes, const float* x, const float* z, int count, float radius, float* out)
+{
+    for (int i = 0; i < count; i++)
+        wallPenetration(planes, x[i], z[i], radius, out + i * WALL_COUNT);
+}
+
+// every brick, dead or alive. a little more than the touching distance so
+// the Q16.16 test never misses a brick the float grid left out
+static void buildBrickGrid(CBrickGrid& grid, const std::vector<BallState>& bricks)
+{
+    std::vector<float> x(bricks.size()), z(bricks.size());
+    for (size_t i = 0; i < bricks.size(); i++) {
+        x[i] = bricks[i].x;
+        z[i] = bricks[i].z;
+    }
+    grid.build(x.empty() ? NULL : &x[0], z.empty() ? NULL : &z[0], NULL, (int)bricks.size(), (float)(M_RADIUS + M_RADIUS) + 0.01f);
+}
+
+// -----------------------------------------------------------------------------
+// CGameSession
+// -----------------------------------------------------------------------------
+
+CGameSession::CGameSession(void)
+{
+    m_level = NULL;
+    m_hasRival = false;
+    m_shotSpin.follow = 0;
+    m_shotSpin.side = 0;
+    m_shotSpin.masse = 0;
+    PhysicsConfig config;
+    defaultPhysicsConfig(config);
+    setConfig(config);
+    reset();
+}
+
+void CGameSession::setConfig(const PhysicsConfig& config)
+{
+    m_config = config;
+    makeMotionModel(config, m_motion);
+    makeFixedPhysicsConfig(config, m_fixed);
+
+    // the pool takes its memory here, never during play
+    m_extra.reserve(config.multiBall > 0 ? config.multiBallLimit : 0);
+    if (config.multiBall > 0 && m_brickGrid.getReach() == 0.0f)
+        buildBrickGrid(m_brickGrid, m_bricks);
+}
+
+void CGameSession::load(const LevelData* level)
+{
+    m_level = level;
+    if (level != NULL) {
+        std::vector<Segment> segments = level->boundary;
+        for (size_t i = 0; i < segments.size(); i++) {
+            segments[i].x0 = quantize(segments[i].x0);
+            segments[i].z0 = quantize(segments[i].z0);
+            segments[i].x1 = quantize(segments[i].x1);
+            segments[i].z1 = quantize(segments[i].z1);
+        }
+        m_boundary.build(segments);
+    }
+    else
+        m_boundary.clear();
+    reset();
+}
+
+bool CGameSession::isDeadlyWall(int id) const
+{
+    if (hasCustomBoundary())
+        return (m_boundary.getSegment(id).flags & SEGMENT_DEADLY) != 0;
+    return id == WALL_BOTTOM;
+}
+
+void CGameSession::reset(void)
+{
+    // walls : upper, right, left, bottom
+    m_walls[WALL_TOP] = makeWall(0.0f, -4.5f, 6.24f, 0.12f, 0.0f, 0.0f);
+    m_walls[WALL_RIGHT] = makeWall(-3.06f, 0.0f, 0.12f, 9.0f, 0.0f, 0.0f);
+    m_walls[WALL_LEFT] = makeWall(3.06f, 0.0f, 0.12f, 9.0f, 0.0f, 0.0f);
+    m_walls[WALL_BOTTOM] = makeWall(0.0f, 4.5f, 6.24f, 0.12f, 0.0f, 0.0f);
+    for (int i = 0; i < WALL_COUNT; i++) {
+        m_planes.nx[i] = m_walls[i].nx;
+        m_planes.nz[i] = m_walls[i].nz;
+        m_planes.d[i] = quantize(m_walls[i].d);
+    }
+
+    // the white ball moves between the side walls, or across the whole boundary
+    if (hasCustomBoundary()) {
+        float minZ, maxZ;
+        m_boundary.getBounds(&m_minX, &minZ, &m_maxX, &maxZ);
+        m_minX += (float)M_RADIUS;
+        m_maxX -= (float)M_RADIUS;
+    }
+    else {
+        m_minX = (float)(m_walls[WALL_RIGHT].d * m_walls[WALL_RIGHT].nx + M_RADIUS);
+        m_maxX = (float)(m_walls[WALL_LEFT].d * m_walls[WALL_LEFT].nx - M_RADIUS);
+    }
+    m_minX = quantize(m_minX);
+    m_maxX = quantize(m_maxX);
+
+    // every position is on the Q16.16 grid in the fixed-point build
+    const float radius = quantize((float)M_RADIUS);
+
+    float startX = 0.0f;
+    float startZ = 4.2f;
+    if (m_level != NULL) {
+        int count = (int)m_level->brickX.size();
+        m_bricks.resize(count);
+        for (int i = 0; i < count; i++)
+            setBall(m_bricks[i], quantize(m_level->brickX[i]), radius, quantize(m_level->brickZ[i]));
+        startX = m_level->startX;
+        startZ = m_level->startZ;
+    }
+    else {
+        m_bricks.resize(BRICK_COUNT);
+        for (int i = 0; i < BRICK_COUNT; i++)
+            setBall(m_bricks[i], quantize(spherePos[i][0]), radius, quantize(spherePos[i][1]));
+    }
+    m_alive.assign(m_bricks.size(), 1);
+    m_bricksLeft = (int)m_bricks.size();
+
+    m_extra.clear();
+    if (m_config.multiBall > 0)
+        buildBrickGrid(m_brickGrid, m_bricks);
+    else
+        m_brickGrid.clear();
+
+#ifdef PHYSICS_FIXED_POINT
+    m_fixedTable.brickX.resize(m_bricks.size());
+    m_fixedTable.brickZ.resize(m_bricks.size());
+    for (size_t i = 0; i < m_bricks.size(); i++) {
+        m_fixedTable.brickX[i] = fxExact(m_bricks[i].x);
+        m_fixedTable.brickZ[i] = fxExact(m_bricks[i].z);
+    }
+    m_fixedTable.brickY = fxExact(radius);
+    for (int k = 0; k < WALL_COUNT; k++) {
+        m_fixedTable.nx[k] = fxExact(m_planes.nx[k]);
+        m_fixedTable.nz[k] = fxExact(m_planes.nz[k]);
+        m_fixedTable.d[k] = fxExact(m_planes.d[k]);
+    }
+#endif
+
+    setBall(m_white, quantize(startX), radius, quantize(startZ));
+    setBall(m_red, m_white.x, radius, quantize(startZ - (float)(M_RADIUS + M_RADIUS)));
+
+    // the rival starts mirrored across the middle of the table
+    float minX, minZ, maxX, maxZ;
+    if (hasCustomBoundary())
+        m_boundary.getBounds(&minX, &minZ, &maxX, &maxZ);
+    else
+        minZ = maxZ = 0.0f;
+    setBall(m_rival, quantize(startX), radius, quantize(minZ + maxZ - startZ));
+
+    m_contacts.clear();
+    m_removed.clear();
+    m_impulses.clear();
+
+    m_start = true;
+    m_restart = false;
+    m_complete = false;
+}
+
+void CGameSession::step(float timeDelta)
+{
+    m_contacts.clear();
+    m_removed.clear();
+    if (m_restart || m_complete)
+        return;
+
+    // update the position of each ball
+    BallState redcoord = m_red;
+
+#ifdef PHYSICS_FIXED_POINT
+    // the closed-form model needs exp(), so this build always steps frame by frame
+    fixed dt = fxFromFloat(timeDelta);
+    ballUpdate(m_red, dt, m_fixed);
+    ballUpdate(m_white, dt, m_fixed);
+#else
+    if (m_config.analyticMotion) {
+        advanceBall(m_motion, m_red, timeDelta);
+        advanceBall(m_motion, m_white, timeDelta);
+    }
+    else {
+        ballUpdate(m_red, timeDelta, m_config);
+        ballUpdate(m_white, timeDelta, m_config);
+    }
+    if (m_config.spin) {
+        float slide = m_config.slideFriction * timeDelta;
+        float spinDecay = m_config.spinFriction * timeDelta;
+        spinFriction(m_red.vx, m_red.vz, m_red.wx, m_red.wy, m_red.wz, (float)M_RADIUS, slide, spinDecay);
+        spinFriction(m_white.vx, m_white.vz, m_white.wx, m_white.wy, m_white.wz, (float)M_RADIUS, slide, spinDecay);
+    }
+#endif
+
+    if (m_start) {
+        m_red.x = m_white.x;
+        m_red.y = redcoord.y;
+        m_red.z = redcoord.z;
+    }
+
+    findContacts();
+    resolveContacts();
+    stepExtraBalls(timeDelta);
+    checkGameOver();
+    removeBricks();
+    releaseMultiBall();
+
+    if (m_bricksLeft == 0) {
+        m_complete = true;
+    }
+
+    notifyListeners();
+    removeLostExtraBalls();
+}
+
+void CGameSession::addContactListener(ContactListener listener, void* user)
+{
+    Listener l = { listener, user };
+    m_listeners.push_back(l);
+}
+
+void CGameSession::removeContactListener(ContactListener listener, void* user)
+{
+    for (size_t i = 0; i < m_listeners.size(); i++) {
+        if (m_listeners[i].fn == listener && m_listeners[i].user == user) {
+            m_listeners.erase(m_listeners.begin() + i);
+            return;
+        }
+    }
+}
+
+// narrow phase : red ball against walls, bricks and the paddle balls
+void CGameSession::findContacts(void)
+{
+    findWallContacts(BALL_RED, m_red);
+    findBrickContacts(BALL_RED, m_red, NULL, (int)m_bricks.size());
+
+    if (hasIntersected(m_white, m_red))
+        m_contacts.push_back(ballContact(CONTACT_BALL, BALL_RED, BALL_WHITE, m_red, m_white));
+    if (m_hasRival && hasIntersected(m_rival, m_red))
+        m_contacts.push_back(ballContact(CONTACT_BALL, BALL_RED, BALL_RIVAL, m_red, m_rival));
+}
+
+// walls or boundary segments touched by ball 'id'
+void CGameSession::findWallContacts(int id, const BallState& ball)
+{
+    if (hasCustomBoundary()) {
+        const int MAX_SEGMENT_HITS = 16;
+        SegmentHit hits[MAX_SEGMENT_HITS];
+#ifdef PHYSICS_FIXED_POINT
+        // the float query only picks candidates, with a margin; segmentContact decides
+        int count = m_boundary.query(ball.x, ball.z, (float)M_RADIUS + 0.01f, hits, MAX_SEGMENT_HITS);
+        int kept = 0;
+        for (int i = 0; i < count; i++) {
+            SegmentHit candidate = hits[i];
+            if (segmentContact(m_boundary.getSegment(candidate.segment), ball, candidate, &hits[kept]))
+                hits[kept++].segment = candidate.segment;
+        }
+        count = m_boundary.mergeJoints(ball.x, ball.z, (float)M_RADIUS, hits, kept);
+#else
+        int count = m_boundary.query(ball.x, ball.z, (float)M_RADIUS, hits, MAX_SEGMENT_HITS);
+#endif
+        for (int i = 0; i < count; i++) {
+            float closing = closingSpeed(ball, hits[i].nx, hits[i].nz);
+            m_contacts.push_back(makeContact(CONTACT_WALL, id, hits[i].segment,
+                hits[i].nx, hits[i].nz, hits[i].penetration, closing));
+        }
+    }
+    else {
+        float penetration[WALL_COUNT];
+#ifdef PHYSICS_FIXED_POINT
+        ballWallPenetration(m_fixedTable, ball, penetration);
+#else
+        ballWallPenetration(m_planes, ball, penetration);
+#endif
+
+        for (int k = 0; k < WALL_COUNT; k++) {
+            if (penetration[k] <= 0.0f)
+                continue;
+            float nx = m_planes.nx[k];
+            float nz = m_planes.nz[k];
+            float closing = closingSpeed(ball, nx, nz);
+            m_contacts.push_back(makeContact(CONTACT_WALL, id, k, nx, nz, penetration[k], closing));
+        }
+    }
+}
+
+// live bricks touched by ball 'id' among 'bricks' (NULL : bricks 0 .. count - 1)
+void CGameSession::findBrickContacts(int id, const BallState& ball, const int* bricks, int count)
+{
+#ifdef PHYSICS_FIXED_POINT
+    fixed x = fxExact(ball.x);
+    fixed z = fxExact(ball.z);
+    long long dy = fxExact(ball.y) - m_fixedTable.brickY;
+    for (int k = 0; k < count; k++) {
+        int i = bricks != NULL ? bricks[k] : k;
+        if (m_alive[i] && brickIntersected(m_fixedTable, i, x, dy, z))
+            m_contacts.push_back(ballContact(CONTACT_BRICK, id, i, ball, m_bricks[i]));
+    }
+#else
+    for (int k = 0; k < count; k++) {
+        int i = bricks != NULL ? bricks[k] : k;
+        if (m_alive[i] && hasIntersected(m_bricks[i], ball))
+            m_contacts.push_back(ballContact(CONTACT_BRICK, id, i, ball, m_bricks[i]));
+    }
+#endif
+}
+
+// response pass : push balls out of walls and reflect velocities
+void CGameSession::resolveContacts(void)
+{
+#ifndef PHYSICS_FIXED_POINT
+    // the impulses become the last step's once stepExtraBalls() added theirs
+    if (m_config.solverIterations > 0) {
+        m_nextImpulses.clear();
+        for (int ball = BALL_RED; ball <= BALL_RIVAL; ball++)
+            solveBallContacts(ball, 0, m_contacts.size());
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < m_contacts.size(); i++) {
+        const ContactEvent& c = m_contacts[i];
+        BallState& ball = getBall(c.a);
+
+        float normalSpeed = ball.vx * c.nx + ball.vz * c.nz;
+
+        if (c.kind != CONTACT_WALL) {
+            reflect(ball, c.nx, c.nz);
+            contactSpin(ball, c, ball.vx * c.nx + ball.vz * c.nz - normalSpeed);
+            continue;
+        }
+
+        pushOut(ball, c);
+
+        // the bottom wall ends the round instead of bouncing
+        if (!isDeadlyWall(c.b)) {
+#ifdef PHYSICS_FIXED_POINT
+            bounce(ball, c, m_fixed);
+#else
+            bounce(ball, c, m_config);
+#endif
+            contactSpin(ball, c, ball.vx * c.nx + ball.vz * c.nz - normalSpeed);
+        }
+    }
+}
+
+// a spinning ball trades side spin for sideways speed where it touched
+// something. nothing in the fixed-point build or without spin
+#ifdef PHYSICS_FIXED_POINT
+void CGameSession::contactSpin(BallState&, const ContactEvent&, float)
+{
+}
+#else
+void CGameSession::contactSpin(BallState& ball, const ContactEvent& c, float normalImpulse)
+{
+    if (!m_config.spin)
+        return;
+    float bodyVX = 0, bodyVZ = 0;
+    if (c.kind == CONTACT_BALL) {
+        bodyVX = getBall(c.b).vx;
+        bodyVZ = getBall(c.b).vz;
+    }
+    contactFriction(ball, c.nx, c.nz, bodyVX, bodyVZ, normalImpulse, m_config.contactFriction);
+}
+#endif
+
+// m_impulses is kept sorted by ball, so a ball finds its own quickly
+static bool impulseBefore(const ContactImpulse& x, const ContactImpulse& y)
+{
+    return x.a < y.a;
+}
+
+// every contact of one ball at once, warm started from the impulses of the
+// last step. the same rules as above : walls push out and bounce, unless
+// deadly; bricks and balls reflect
+void CGameSession::solveBallContacts(int ball, size_t first, size_t end)
+{
+    m_solver.clear();
+    for (size_t i = first; i < end; i++) {
+        const ContactEvent& c = m_contacts[i];
+        if (c.a != ball)
+            continue;
+
+        SolverContact s;
+        s.nx = c.nx;
+        s.nz = c.nz;
+        s.penetration = c.penetration;
+        s.bodyVX = 0;
+        s.bodyVZ = 0;
+        s.restitution = 1;
+        s.impulse = 0;
+        if (c.kind == CONTACT_WALL)
+            s.flags = isDeadlyWall(c.b) ? SOLVE_POSITION : SOLVE_POSITION | SOLVE_VELOCITY;
+        else
+            s.flags = SOLVE_VELOCITY;
+        if (c.kind == CONTACT_BALL) {
+            s.bodyVX = getBall(c.b).vx;
+            s.bodyVZ = getBall(c.b).vz;
+        }
+        ContactImpulse key = { 0, (short)c.a, 0, 0, 0 };
+        std::vector<ContactImpulse>::const_iterator last = std::lower_bound(m_impulses.begin(), m_impulses.end(), key, impulseBefore);
+        for (; last != m_impulses.end() && last->a == c.a; ++last) {
+            if (last->kind == c.kind && last->b == c.b)
+                s.impulse = last->impulse;
+        }
+        m_solver.push_back(s);
+    }
+    if (m_solver.empty())
+        return;
+
+    BallState& state = getBall(ball);
+    solveContacts(state, &m_solver[0], (int)m_solver.size(), m_config.solverIterations);
+
+    // a wall bounce that left the ball too slow speeds it up, as in bounce()
+    // extra balls do not spin
+    bool bounced = false;
+    for (size_t i = first, k = 0; i < end; i++) {
+        const ContactEvent& c = m_contacts[i];
+        if (c.a != ball)
+            continue;
+        const SolverContact& s = m_solver[k++];
+        if (c.kind == CONTACT_WALL && (s.flags & SOLVE_VELOCITY) && s.closing > 0)
+            bounced = true;
+        if ((s.flags & SOLVE_VELOCITY) && ball < BALL_EXTRA)
+            contactSpin(state, c, s.impulse);
+        if (s.impulse > 0) {
+            ContactImpulse impulse = { c.kind, c.a, c.b, 0, s.impulse };
+            m_nextImpulses.push_back(impulse);
+        }
+    }
+    float minVelocity = m_config.minVelocity;
+    if (bounced && sqrt(state.vx * state.vx + state.vz * state.vz) < minVelocity) {
+        if (state.vx != 0.0f)
+            state.vx = state.vx > 0.0f ? minVelocity : -minVelocity;
+        if (state.vz != 0.0f)
+            state.vz = state.vz > 0.0f ? minVelocity : -minVelocity;
+    }
+}
+
+// extra balls : moved by the rules of the red ball, then pushed out of walls
+// and bounced off walls and bricks like the red ball, one contact after the
+// other or with the solver. their contacts join the stream, so removeBricks()
+// clears what they hit. a ball on a deadly wall is only listed here : its
+// slot has to stay the one its contacts name until the listeners ran
+void CGameSession::stepExtraBalls(float timeDelta)
+{
+    m_lostExtra.clear();
+#ifdef PHYSICS_FIXED_POINT
+    fixed dt = fxFromFloat(timeDelta);
+#endif
+    for (int i = m_extra.getCount() - 1; i >= 0; i--) {
+        BallState& ball = m_extra[i];
+#ifdef PHYSICS_FIXED_POINT
+        ballUpdate(ball, dt, m_fixed);
+#else
+        if (m_config.analyticMotion)
+            advanceBall(m_motion, ball, timeDelta);
+        else
+            ballUpdate(ball, timeDelta, m_config);
+#endif
+
+        size_t first = m_contacts.size();
+        findWallContacts(BALL_EXTRA + i, ball);
+        const int* bricks = NULL;
+        int count = m_brickGrid.cellBricks(ball.x, ball.z, &bricks);
+        findBrickContacts(BALL_EXTRA + i, ball, bricks, count);
+
+        bool lost = false;
+        for (size_t k = first; k < m_contacts.size(); k++) {
+            const ContactEvent& c = m_contacts[k];
+            if (c.kind == CONTACT_WALL && isDeadlyWall(c.b))
+                lost = true;
+        }
+        if (lost)
+            m_lostExtra.push_back(i);
+#ifndef PHYSICS_FIXED_POINT
+        if (m_config.solverIterations > 0) {
+            solveBallContacts(BALL_EXTRA + i, first, m_contacts.size());
+            continue;
+        }
+#endif
+
+        for (size_t k = first; k < m_contacts.size(); k++) {
+            const ContactEvent& c = m_contacts[k];
+            if (c.kind != CONTACT_WALL) {
+                reflect(ball, c.nx, c.nz);
+                continue;
+            }
+            pushOut(ball, c);
+            if (!isDeadlyWall(c.b)) {
+#ifdef PHYSICS_FIXED_POINT
+                bounce(ball, c, m_fixed);
+#else
+                bounce(ball, c, m_config);
+#endif
+            }
+        }
+    }
+#ifndef PHYSICS_FIXED_POINT
+    if (m_config.solverIterations > 0) {
+        m_impulses.swap(m_nextImpulses);
+        std::stable_sort(m_impulses.begin(), m_impulses.end(), impulseBefore);
+    }
+#endif
+}
+
+// from the back, so the ball moved into a freed slot is never one still listed.
+// the solver impulses of a moved ball follow it to its new slot
+void CGameSession::removeLostExtraBalls(void)
+{
+    for (size_t k = 0; k < m_lostExtra.size(); k++) {
+        int lost = BALL_EXTRA + m_lostExtra[k];
+        int moved = BALL_EXTRA + m_extra.getCount() - 1;
+        size_t kept = 0;
+        for (size_t i = 0; i < m_impulses.size(); i++) {
+            if (m_impulses[i].a == lost)
+                continue;
+            m_impulses[kept] = m_impulses[i];
+            if (m_impulses[kept].a == moved)
+                m_impulses[kept].a = (short)lost;
+            kept++;
+        }
+        m_impulses.resize(kept);
+        m_extra.despawn(m_lostExtra[k]);
+    }
+    if (!m_lostExtra.empty())
+        std::stable_sort(m_impulses.begin(), m_impulses.end(), impulseBefore);
+    m_lostExtra.clear();
+}
+
+// game-over pass : the red ball reaching the bottom wall restarts the game
+void CGameSession::checkGameOver(void)
+{
+    for (size_t i = 0; i < m_contacts.size(); i++) {
+        const ContactEvent& c = m_contacts[i];
+        if (c.kind == CONTACT_WALL && c.a == BALL_RED && isDeadlyWall(c.b))
+            m_restart = true;
+    }
+}
+
+// brick pass : every brick touched this step disappears
+void CGameSession::removeBricks(void)
+{
+    if (m_restart)
+        return;
+
+    for (size_t i = 0; i < m_contacts.size(); i++) {
+        const ContactEvent& c = m_contacts[i];
+        if (c.kind == CONTACT_BRICK && m_alive[c.b]) {
+            m_alive[c.b] = 0;
+            m_bricksLeft--;
+            m_removed.push_back(c.b);
+        }
+    }
+}
+
+// power-up pass : the red ball breaking a power-up brick releases a burst of
+// extra balls where the brick was
+void CGameSession::releaseMultiBall(void)
+{
+    if (m_restart || m_config.multiBall <= 0)
+        return;
+
+    for (size_t i = 0; i < m_contacts.size(); i++) {
+        const ContactEvent& c = m_contacts[i];
+        if (c.kind == CONTACT_BRICK && c.a == BALL_RED && c.b % MULTI_BALL_EVERY == 0)
+            spawnBurst(m_bricks[c.b].x, m_bricks[c.b].z, m_config.multiBall);
+    }
+}
+
+// directions walk the edge of a square and are scaled to unit length in
+// Q16.16, so both builds release the same fan without sin / cos
+int CGameSession::spawnBurst(float x, float z, int count)
+{
+    const float radius = quantize((float)M_RADIUS);
+    int spawned = 0;
+    for (int k = 0; k < count; k++) {
+        BallState* ball = m_extra.spawn();
+        if (ball == NULL)
+            break;
+
+        fixed t = (fixed)((long long)k * 8 * FIXED_ONE / count);     // 0 .. 8 around the square
+        fixed u = (t & (2 * FIXED_ONE - 1)) - FIXED_ONE;              // -1 .. 1 along one side
+        fixed px, pz;
+        switch (t >> (FIXED_SHIFT + 1)) {
+        case 0:  px = u;            pz = -FIXED_ONE;    break;
+        case 1:  px = FIXED_ONE;    pz = u;             break;
+        case 2:  px = -u;           pz = FIXED_ONE;     break;
+        default: px = -FIXED_ONE;   pz = -u;            break;
+        }
+        fixed length = fxLength(px, pz);
+
+        setBall(*ball, x, radius, z);
+#ifdef PHYSICS_FIXED_POINT
+        ball->vx = fxToFloat(fxMul(fxDiv(px, length), m_fixed.maxSpeed));
+        ball->vz = fxToFloat(fxMul(fxDiv(pz, length), m_fixed.maxSpeed));
+#else
+        ball->vx = fxToFloat(fxDiv(px, length)) * m_config.maxSpeed;
+        ball->vz = fxToFloat(fxDiv(pz, length)) * m_config.maxSpeed;
+#endif
+        spawned++;
+    }
+    return spawned;
+}
+
+void CGameSession::notifyListeners(void)
+{
+    if (m_contacts.empty())
+        return;
+    for (size_t i = 0; i < m_listeners.size(); i++)
+        m_listeners[i].fn(*this, &m_contacts[0], (int)m_contacts.size(), m_listeners[i].user);
+}
+
+void CGameSession::moveWhiteBall(float dx)
+{
+    movePaddle(m_white, dx);
+}
+
+void CGameSession::moveRivalBall(float dx)
+{
+    if (m_hasRival)
+        movePaddle(m_rival, dx);
+}
+
+void CGameSession::movePaddle(BallState& paddle, float dx)
+{
+#ifdef PHYSICS_FIXED_POINT
+    float x = fxToFloat(fxExact(paddle.x) + fxMul(fxFromFloat(dx), FIXED_PADDLE_STEP));
+#else
+    float x = paddle.x + dx * (-0.01f);
+#endif
+
+    if (x < m_minX) {
+        paddle.x = m_minX;
+    }
+    else if (x <= m_maxX) {
+        paddle.x = x;
+    }
+    else {
+        paddle.x = m_maxX;
+    }
+}
+
+void CGameSession::saveSnapshot(SessionSnapshot& snapshot) const
+{
+    snapshot.red = m_red;
+    snapshot.white = m_white;
+    snapshot.rival = m_rival;
+    snapshot.extra.assign(m_extra.getItems(), m_extra.getItems() + m_extra.getCount());
+    snapshot.alive = m_alive;      // keeps its capacity, so no allocation once warmed up
+    snapshot.impulses = m_impulses;
+    snapshot.bricksLeft = m_bricksLeft;
+    snapshot.start = m_start;
+    snapshot.restart = m_restart;
+    snapshot.complete = m_complete;
+}
+
+void CGameSession::loadSnapshot(const SessionSnapshot& snapshot)
+{
+    m_red = snapshot.red;
+    m_white = snapshot.white;
+    m_rival = snapshot.rival;
+    m_extra.assign(snapshot.extra.empty() ? NULL : &snapshot.extra[0], (int)snapshot.extra.size());
+    m_alive = snapshot.alive;
+    m_impulses = snapshot.impulses;
+    m_bricksLeft = snapshot.bricksLeft;
+    m_start = snapshot.start;
+    m_restart = snapshot.restart;
+    m_complete = snapshot.complete;
+    m_contacts.clear();
+}
+
+static unsigned fnv1a(unsigned hash, const void* data, size_t size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ p[i]) * 16777619u;
+    return hash;
+}
+
+unsigned snapshotChecksum(const SessionSnapshot& snapshot)
+{
+    const BallState* balls[3] = { &snapshot.red, &snapshot.white, &snapshot.rival };
+    unsigned hash = 2166136261u;
+    for (int i = 0; i < 3; i++) {
+        float values[8] = { balls[i]->x, balls[i]->y, balls[i]->z, balls[i]->vx, balls[i]->vz,
+            balls[i]->wx, balls[i]->wy, balls[i]->wz };
+        hash = fnv1a(hash, values, sizeof(values));
+    }
+    if (!snapshot.alive.empty())
+        hash = fnv1a(hash, &snapshot.alive[0], snapshot.alive.size());
+    unsigned char flags[3] = { snapshot.start, snapshot.restart, snapshot.complete };
+    hash = fnv1a(hash, &snapshot.bricksLeft, sizeof(snapshot.bricksLeft));
+    hash = fnv1a(hash, flags, sizeof(flags));
+    if (!snapshot.impulses.empty())
+        hash = fnv1a(hash, &snapshot.impulses[0], snapshot.impulses.size() * sizeof(ContactImpulse));
+    if (!snapshot.extra.empty())
+        hash = fnv1a(hash, &snapshot.extra[0], snapshot.extra.size() * sizeof(BallState));
+    return hash;
+}
+
+// launch the red ball away from the white ball
+void CGameSession::shoot(void)
+{
+    m_start = false;
+    getShotVelocity(&m_red.vx, &m_red.vz);
+#ifndef PHYSICS_FIXED_POINT
+    if (m_config.spin)
+        applyShotSpin(m_red, m_shotSpin);
+#endif
+}
+
+void CGameSession::getShotVelocity(float* vx, float* vz) const
+{
+#ifdef PHYSICS_FIXED_POINT
+    // the angle of shotVelocity() cancels out : its result is (dx, -dz) * shotSpeed,
+    // except on the axes, where its quadrant tests overlap and flip one sign
+    // (a serve straight up, dx = 0, gives (0, dz) * shotSpeed)
+    fixed dx = fxExact(m_red.x) - fxExact(m_white.x);
+    fixed dz = fxExact(m_red.z) - fxExact(m_white.z);
+    fixed x = dz == 0 ? fxAbs(dx) : dx;
+    fixed z = dx == 0 ? -fxAbs(dz) : -dz;
+    *vx = fxToFloat(fxMul(x, m_fixed.shotSpeed));
+    *vz = fxToFloat(fxMul(z, m_fixed.shotSpeed));
+#else
+    shotVelocity(m_red.x, m_red.z, m_white.x, m_white.z, m_config.shotSpeed, vx, vz);
+#endif
+}
+
+void shotVelocity(float redX, float redZ, float whiteX, float whiteZ, double shotSpeed, float* vx, float* vz)
+{
+    double dx = redX - whiteX;
+    double dz = redZ - whiteZ;
+
+    double theta = acos(sqrt(pow(dx, 2)) / sqrt(pow(dx, 2) + pow(dz, 2)));   // quadrant 1
+    if (dz <= 0 && dx >= 0) { theta = -theta; }        // quadrant 4
+    if (dz >= 0 && dx <= 0) { theta = PI - theta; }    // quadrant 2
+    if (dz <= 0 && dx <= 0) { theta = PI + theta; }    // quadrant 3
+
+    double distance = sqrt(pow(dx, 2) + pow(dz, 2));
+
+    double speedMultiplier = shotSpeed;
+    *vx = (float)(distance * cos(theta) * speedMultiplier);
+    *vz = (float)(-distance * sin(theta) * speedMultiplier);
+}
@@ -0,0 +1,299 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: gameSession.h
+//
+// Desc: Headless game core. A CGameSession owns one complete game (table,
+//       bricks, red/white ball and the start/restart/complete flags) as plain
+//       data with no Direct3D dependency, so it can be stepped by the window
+//       application or by a server process hosting many sessions.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __gameSessionH__
+#define __gameSessionH__
+
+#include "level.h"
+#include "physicsConfig.h"
+#include "motionModel.h"
+#include "fixedPoint.h"
+#include "contactSolver.h"
+#include "spinModel.h"
+#include "ballPool.h"
+#include "brickGrid.h"
+#include <vector>
+#include <cstddef>
+
+#define M_RADIUS 0.21   // ball radius
+#define PI 3.14159265
+#define M_HEIGHT 0.01
+// defaults of PhysicsConfig
+#define DECREASE_RATE 0.9982// velocity decrease rate - friction / drag simulation 0.9982
+
+const float MIN_VELOCITY = 2;
+
+// stock brick layout
+const int BRICK_COUNT = 36;
+extern const float spherePos[BRICK_COUNT][2];
+
+// number of boundary walls around the table
+const int WALL_COUNT = 4;
+
+// every 6th brick holds a multi-ball power-up (PhysicsConfig::multiBall)
+const int MULTI_BALL_EVERY = 6;
+
+// -----------------------------------------------------------------------------
+// Plain simulation state
+// -----------------------------------------------------------------------------
+
+struct BallState
+{
+    float x, y, z;      // center
+    float vx, vz;       // velocity on the table plane
+    float wx, wy, wz;   // angular velocity (spin, see spinModel.h)
+};
+
+// moving balls, as used in ContactEvent::a. the rival paddle only exists in versus play.
+// extra ball i of a multi-ball burst is BALL_EXTRA + i, its slot during that step.
+// balls lost in a step leave the pool only after the listeners have seen its contacts
+enum BallId { BALL_RED = 0, BALL_WHITE = 1, BALL_RIVAL = 2, BALL_EXTRA = 3 };
+
+typedef CPackedPool<BallState> CBallPool;
+
+// walls : upper, right, left, bottom
+enum WallId { WALL_TOP = 0, WALL_RIGHT = 1, WALL_LEFT = 2, WALL_BOTTOM = 3 };
+
+// what a moving ball touched
+enum ContactKind { CONTACT_BRICK = 0, CONTACT_WALL = 1, CONTACT_BALL = 2 };
+
+// one entry of the contact stream produced by the narrow phase of step()
+struct ContactEvent
+{
+    short kind;             // ContactKind
+    short a;                // moving ball (BallId)
+    short b;                // brick index, WallId or BallId depending on kind
+    short reserved;
+    float nx, nz;           // unit contact normal, pointing towards ball a
+    float penetration;      // overlap depth along the normal
+    float relativeSpeed;    // closing speed along the normal (> 0 when approaching)
+};
+
+class CGameSession;
+
+// gameplay rules subscribe to the contact stream. listeners run once per step,
+// after the built-in passes, with every contact of that step
+typedef void (*ContactListener)(CGameSession& session, const ContactEvent* events, int count, void* user);
+
+struct WallState
+{
+    float x, z;         // center
+    float width, depth; // extent along x and z
+    float nx, nz;       // unit normal of the inner face, pointing into the table
+    float d;            // the inner face is the line nx * x + nz * z = d
+};
+
+// every wall as a half-plane, laid out so one loop tests all walls at once
+struct WallPlanes
+{
+    float nx[WALL_COUNT];
+    float nz[WALL_COUNT];
+    float d[WALL_COUNT];
+};
+
+// penetration of a ball at (x, z) into each wall (<= 0 means no contact).
+// branch free, for a single ball and for 'count' balls (out is count * WALL_COUNT)
+void wallPenetration(const WallPlanes& planes, float x, float z, float radius, float out[WALL_COUNT]);
+void wallPenetrations(const WallPlanes& planes, const float* x, const float* z, int count, float radius, float* out);
+
+// Q16.16 copy of the fixed parts of a table, so the PHYSICS_FIXED_POINT build
+// does not convert every brick and wall in every step. empty in the float build
+struct FixedTable
+{
+    std::vector<fixed>  brickX, brickZ;
+    fixed               brickY;
+    fixed               nx[WALL_COUNT], nz[WALL_COUNT], d[WALL_COUNT];
+};
+
+// impulse a contact ended a step with, to warm start the solver in the next
+// step when the same contact is still there
+struct ContactImpulse
+{
+    short kind;             // ContactKind
+    short a;
+    short b;
+    short reserved;
+    float impulse;
+};
+
+// the part of a session that changes during play : enough to put a session
+// back to an earlier step (rollback) without copying the table
+struct SessionSnapshot
+{
+    BallState                   red, white, rival;
+    std::vector<BallState>      extra;          // multi-ball
+    std::vector<unsigned char>  alive;
+    std::vector<ContactImpulse> impulses;
+    int                         bricksLeft;
+    bool                        start, restart, complete;
+};
+
+// FNV-1a over the bytes of a snapshot, to compare two simulations
+unsigned snapshotChecksum(const SessionSnapshot& snapshot);
+
+// launch velocity of a red ball aimed away from the white ball (what shoot() uses)
+void shotVelocity(float redX, float redZ, float whiteX, float whiteZ, double shotSpeed, float* vx, float* vz);
+
+// -----------------------------------------------------------------------------
+// CGameSession class definition
+//
+// Define PHYSICS_FIXED_POINT to build the rules on Q16.16 integers
+// (fixedPoint.h) : the same results on every compiler and CPU, for lockstep
+// and replay checks across machines. Positions are then rounded to 1 / 65536
+// and analyticMotion, solverIterations and spin are ignored. The API is the
+// same in both builds
+// -----------------------------------------------------------------------------
+
+class CGameSession {
+public:
+    CGameSession(void);
+
+    // play 'level' from now on (NULL : the stock table). the level is not
+    // copied and must outlive the session; its boundary is built here once
+    void load(const LevelData* level);
+
+    // put the table back into the level's start layout (what Setup() does for the app)
+    void reset(void);
+
+    // physics values used from the next step on. the table is not reset
+    void setConfig(const PhysicsConfig& config);
+    const PhysicsConfig& getConfig(void) const { return m_config; }
+    const MotionModel& getMotionModel(void) const { return m_motion; }
+
+    // advance the game by one frame. does nothing once restart or complete is set
+    void step(float timeDelta);
+
+    // player input: move the white ball along x by a mouse delta, and launch the red ball
+    void moveWhiteBall(float dx);
+    void shoot(void);
+
+    // the velocity shoot() would give the red ball right now
+    void getShotVelocity(float* vx, float* vz) const;
+
+    // spin of the next shots when the config has spin on
+    void setShotSpin(const ShotSpin& spin) { m_shotSpin = spin; }
+    const ShotSpin& getShotSpin(void) const { return m_shotSpin; }
+
+    // extra balls of the multi-ball power-up. they bounce off walls and
+    // bricks like the red ball and clear bricks, but pass through each other
+    // and the paddles, and a deadly wall only takes the ball away.
+    // spawnBurst() releases 'count' of them from (x, z) in a fan; it returns
+    // how many fit under multiBallLimit. nothing here allocates
+    int  spawnBurst(float x, float z, int count);
+    int  getExtraBallCount(void) const { return m_extra.getCount(); }
+    const BallState* getExtraBalls(void) const { return m_extra.getItems(); }
+
+    // second paddle for versus play, facing the white ball across the table.
+    // takes effect at the next reset()
+    void setRival(bool enabled) { m_hasRival = enabled; }
+    bool hasRival(void) const { return m_hasRival; }
+    void moveRivalBall(float dx);
+    const BallState& getRivalBall(void) const { return m_rival; }
+
+    // save and restore the play state. the level and config are not part of it
+    void saveSnapshot(SessionSnapshot& snapshot) const;
+    void loadSnapshot(const SessionSnapshot& snapshot);
+
+    bool isStarted(void)  const { return m_start; }
+    bool isRestart(void)  const { return m_restart; }
+    bool isComplete(void) const { return m_complete; }
+
+    const BallState& getRedBall(void)   const { return m_red; }
+    const BallState& getWhiteBall(void) const { return m_white; }
+
+    int  getBrickCount(void) const { return (int)m_bricks.size(); }
+    int  getBricksLeft(void) const { return m_bricksLeft; }
+    bool isBrickAlive(int i) const { return m_alive[i] != 0; }
+    const BallState& getBrick(int i) const { return m_bricks[i]; }
+
+    const WallState& getWall(int i) const { return m_walls[i]; }
+
+    // custom tables replace the four stock walls with a segment boundary
+    bool hasCustomBoundary(void) const { return !m_boundary.empty(); }
+    const CBoundaryBVH& getBoundary(void) const { return m_boundary; }
+
+    // whether touching wall (or boundary segment) 'id' ends the round
+    bool isDeadlyWall(int id) const;
+
+    // contacts found by the last step()
+    int getContactCount(void) const { return (int)m_contacts.size(); }
+    const ContactEvent& getContact(int i) const { return m_contacts[i]; }
+    const ContactEvent* getContacts(void) const { return m_contacts.empty() ? NULL : &m_contacts[0]; }
+
+    // bricks the last step() removed, each once, in the order they went
+    int getRemovedCount(void) const { return (int)m_removed.size(); }
+    int getRemovedBrick(int i) const { return m_removed[i]; }
+
+    void addContactListener(ContactListener listener, void* user);
+    void removeContactListener(ContactListener listener, void* user);
+
+private:
+    BallState& getBall(int id)
+    {
+        return id == BALL_RED ? m_red : id == BALL_WHITE ? m_white : id == BALL_RIVAL ? m_rival : m_extra[id - BALL_EXTRA];
+    }
+    void movePaddle(BallState& paddle, float dx);
+
+    // the stages of step(). the narrow phase only appends to m_contacts; each
+    // following pass walks that array and applies one kind of consequence
+    void findContacts(void);
+    void findWallContacts(int id, const BallState& ball);
+    void findBrickContacts(int id, const BallState& ball, const int* bricks, int count);
+    void resolveContacts(void);
+    void stepExtraBalls(float timeDelta);
+    // m_contacts[first .. end) that belong to 'ball' are solved together
+    void solveBallContacts(int ball, size_t first, size_t end);
+    void contactSpin(BallState& ball, const ContactEvent& c, float normalImpulse);
+    void checkGameOver(void);
+    void removeBricks(void);
+    void releaseMultiBall(void);
+    void removeLostExtraBalls(void);
+    void notifyListeners(void);
+
+    struct Listener
+    {
+        ContactListener fn;
+        void*           user;
+    };
+
+    PhysicsConfig               m_config;
+    MotionModel                 m_motion;       // closed form of m_config
+    FixedPhysicsConfig          m_fixed;        // m_config in Q16.16
+    BallState                   m_red;
+    BallState                   m_white;
+    BallState                   m_rival;
+    CBallPool                   m_extra;        // multi-ball, capacity multiBallLimit
+    std::vector<int>            m_lostExtra;    // extra balls lost this step, back to front
+    std::vector<BallState>      m_bricks;
+    std::vector<unsigned char>  m_alive;
+    int                         m_bricksLeft;
+    WallState                   m_walls[WALL_COUNT];
+    WallPlanes                  m_planes;
+    FixedTable                  m_fixedTable;   // bricks and walls in Q16.16
+    CBrickGrid                  m_brickGrid;    // bricks near a point, for the extra balls
+    const LevelData*            m_level;
+    CBoundaryBVH                m_boundary;
+    float                       m_minX, m_maxX;     // white ball range
+    std::vector<ContactEvent>   m_contacts;
+    std::vector<int>            m_removed;      // bricks removeBricks() took away this step
+    std::vector<ContactImpulse> m_impulses;     // solver impulses of the last step
+    std::vector<ContactImpulse> m_nextImpulses;
+    std::vector<SolverContact>  m_solver;
+    std::vector<Listener>       m_listeners;
+    bool                        m_hasRival;
+    ShotSpin                    m_shotSpin;
+
+    bool    m_start;      // red ball follows the white ball until space is pressed
+    bool    m_restart;    // red ball reached the bottom wall
+    bool    m_complete;   // every brick is gone
+};
+
+#endif // __gameSessionH__
@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: level.cpp
+//
+// Desc: Level description and its text file format.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "level.h"
+#include "gameSession.h"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+void makeStockLevel(LevelData& level)
+{
+    level.brickX.resize(BRICK_COUNT);
+    level.brickZ.resize(BRICK_COUNT);
+    for (int i = 0; i < BRICK_COUNT; i++) {
+        level.brickX[i] = spherePos[i][0];
+        level.brickZ[i] = spherePos[i][1];
+    }
+    level.boundary.clear();
+    level.startX = 0.0f;
+    level.startZ = 4.2f;
+}
+
+static Segment makeSegment(float x0, float z0, float x1, float z1, bool deadly)
+{
+    Segment s;
+    s.x0 = x0;  s.z0 = z0;
+    s.x1 = x1;  s.z1 = z1;
+    s.flags = deadly ? SEGMENT_DEADLY : 0;
+    return s;
+}
+
+bool loadLevel(const char* path, LevelData& level)
+{
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL)
+        return false;
+
+    level.brickX.clear();
+    level.brickZ.clear();
+    level.boundary.clear();
+    level.startX = 0.0f;
+    level.startZ = 4.2f;
+
+    char line[256];
+    int lineNo = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp) != NULL) {
+        lineNo++;
+
+        char word[32] = "";
+        char flag[32] = "";
+        float a, b, c, d, e;
+        int n;
+
+        if (sscanf(line, "%31s", word) != 1 || word[0] == '#')
+            continue;
+
+        if (strcmp(word, "brick") == 0 && sscanf(line, "%*s %f %f", &a, &b) == 2) {
+            level.brickX.push_back(a);
+            level.brickZ.push_back(b);
+        }
+        else if (strcmp(word, "white") == 0 && sscanf(line, "%*s %f %f", &a, &b) == 2) {
+            level.startX = a;
+            level.startZ = b;
+        }
+        else if (strcmp(word, "segment") == 0 && sscanf(line, "%*s %f %f %f %f %31s", &a, &b, &c, &d, flag) >= 4) {
+            level.boundary.push_back(makeSegment(a, b, c, d, strcmp(flag, "deadly") == 0));
+        }
+        else if (strcmp(word, "arc") == 0 && sscanf(line, "%*s %f %f %f %f %f %d %31s", &a, &b, &c, &d, &e, &n, flag) >= 6 && n > 0) {
+            bool deadly = strcmp(flag, "deadly") == 0;
+            float t0 = (float)(d * PI / 180.0);
+            float t1 = (float)(e * PI / 180.0);
+            for (int i = 0; i < n; i++) {
+                float u0 = t0 + (t1 - t0) * i / n;
+                float u1 = t0 + (t1 - t0) * (i + 1) / n;
+                level.boundary.push_back(makeSegment(
+                    a + c * cos(u0), b + c * sin(u0),
+                    a + c * cos(u1), b + c * sin(u1), deadly));
+            }
+        }
+        else {
+            printf("%s(%d) : bad level line\n", path, lineNo);
+            ok = false;
+        }
+    }
+
+    fclose(fp);
+    return ok;
+}
+
+bool saveLevel(const char* path, const LevelData& level)
+{
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL)
+        return false;
+
+    fprintf(fp, "# billiard level\n");
+    fprintf(fp, "white %g %g\n", level.startX, level.startZ);
+    for (size_t i = 0; i < level.boundary.size(); i++) {
+        const Segment& s = level.boundary[i];
+        fprintf(fp, "segment %g %g %g %g%s\n", s.x0, s.z0, s.x1, s.z1,
+            (s.flags & SEGMENT_DEADLY) ? " deadly" : "");
+    }
+    for (size_t i = 0; i < level.brickX.size(); i++)
+        fprintf(fp, "brick %g %g\n", level.brickX[i], level.brickZ[i]);
+
+    bool ok = ferror(fp) == 0;
+    fclose(fp);
+    return ok;
+}
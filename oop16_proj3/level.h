@@ -0,0 +1,38 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: level.h
+//
+// Desc: Level description and its text file format.
+//
+//       # comment
+//       brick   <x> <z>
+//       white   <x> <z>                                   white ball start
+//       segment <x0> <z0> <x1> <z1> [deadly]              straight cushion
+//       arc     <cx> <cz> <r> <deg0> <deg1> <n> [deadly]  curved cushion, n segments
+//
+//       A level without segments uses the four stock walls.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __levelH__
+#define __levelH__
+
+#include "boundary.h"
+#include <vector>
+
+struct LevelData
+{
+    std::vector<float>      brickX;
+    std::vector<float>      brickZ;
+    std::vector<Segment>    boundary;   // empty : stock walls
+    float                   startX;     // white ball start
+    float                   startZ;
+};
+
+// the hand-made 36 brick layout on the stock table
+void makeStockLevel(LevelData& level);
+
+bool loadLevel(const char* path, LevelData& level);
+bool saveLevel(const char* path, const LevelData& level);
+
+#endif // __levelH__
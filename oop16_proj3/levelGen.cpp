@@ -0,0 +1,471 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: levelGen.cpp
+//
+// Desc: Procedural brick layouts with grid-accelerated overlap rejection.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "levelGen.h"
+#include "gameSession.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+// Poisson-disk candidates tried around each brick before it is retired
+const int POISSON_TRIES = 16;
+// candidates are placed this much (relative) beyond the spacing
+const float POISSON_GAP = 1e-3f;
+
+// positions this close to a mirror axis count as lying on it
+const float AXIS_EPSILON = 1e-4f;
+
+// relative rounding slack on the squared brick spacing
+const float SPACING_TOLERANCE = 1e-5f;
+
+// a candidate is tested against the 5 x 5 cells around it
+const int GRID_BORDER = 2;
+
+// share of a custom table's depth left open in front of the white ball, about
+// what the stock area leaves
+const float OPEN_SHARE = 0.4f;
+
+// position stored in an empty grid cell : far from everything, but its
+// squared distance still fits in a float
+const float EMPTY_CELL = 1e18f;
+
+void defaultLevelGenParams(LevelGenParams& params)
+{
+    params.pattern = PATTERN_POISSON;
+    params.symmetry = SYMMETRY_NONE;
+    params.seed = 1;
+    params.spacing = (float)(M_RADIUS + M_RADIUS);
+    params.density = 1.0f;
+    params.maxBricks = 0;
+    params.clearance = 0.0f;
+    params.minX = -3.0f;
+    params.minZ = -4.44f;
+    params.maxX = 3.0f;
+    params.maxZ = 1.0f;
+    params.mask = NULL;
+    params.maskCols = params.maskRows = 0;
+}
+
+void fitLevelGenArea(const LevelData& level, LevelGenParams& params)
+{
+    if (level.boundary.empty()) {
+        LevelGenParams stock;
+        defaultLevelGenParams(stock);
+        params.minX = stock.minX;
+        params.minZ = stock.minZ;
+        params.maxX = stock.maxX;
+        params.maxZ = stock.maxZ;
+        return;
+    }
+
+    const Segment& first = level.boundary[0];
+    float minX = std::min(first.x0, first.x1), maxX = std::max(first.x0, first.x1);
+    float minZ = std::min(first.z0, first.z1), maxZ = std::max(first.z0, first.z1);
+    for (size_t i = 1; i < level.boundary.size(); i++) {
+        const Segment& s = level.boundary[i];
+        minX = std::min(minX, std::min(s.x0, s.x1));
+        maxX = std::max(maxX, std::max(s.x0, s.x1));
+        minZ = std::min(minZ, std::min(s.z0, s.z1));
+        maxZ = std::max(maxZ, std::max(s.z0, s.z1));
+    }
+
+    // the end of the table the white ball starts at stays open
+    float open = OPEN_SHARE * (maxZ - minZ);
+    if (level.startZ > (minZ + maxZ) / 2)
+        maxZ -= open;
+    else
+        minZ += open;
+    params.minX = minX;
+    params.minZ = minZ;
+    params.maxX = maxX;
+    params.maxZ = maxZ;
+}
+
+void makeTextMask(const char* const* lines, int rows, std::vector<unsigned char>& mask, int* cols)
+{
+    int width = 0;
+    for (int r = 0; r < rows; r++)
+        width = std::max(width, (int)strlen(lines[r]));
+
+    mask.assign(width * rows, 0);
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; lines[r][c] != '\0'; c++)
+            mask[r * width + c] = lines[r][c] != ' ' && lines[r][c] != '.';
+    }
+    *cols = width;
+}
+
+bool loadMaskPGM(const char* path, std::vector<unsigned char>& mask, int* cols, int* rows)
+{
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL)
+        return false;
+
+    int width = 0, height = 0, maxValue = 0;
+    bool ok = fscanf(fp, "P5 %d %d %d", &width, &height, &maxValue) == 3 &&
+        width > 0 && height > 0 && maxValue > 0 && maxValue < 256 && fgetc(fp) != EOF;
+    if (ok) {
+        mask.resize(width * height);
+        ok = fread(&mask[0], 1, mask.size(), fp) == mask.size();
+    }
+    fclose(fp);
+    if (!ok)
+        return false;
+
+    for (size_t i = 0; i < mask.size(); i++)
+        mask[i] = mask[i] * 2 > maxValue;
+    *cols = width;
+    *rows = height;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Placement state
+// -----------------------------------------------------------------------------
+
+// xorshift32. the same seed gives the same level with every compiler
+struct Random
+{
+    unsigned state;
+
+    explicit Random(unsigned seed) : state(seed * 2654435761u + 0x9e3779b9u) { if (state == 0) state = 1; }
+
+    unsigned nextInt(void)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    // [0, 1)
+    float next(void) { return (nextInt() >> 8) * (1.0f / 16777216.0f); }
+};
+
+class CPlacer {
+public:
+    CPlacer(const LevelGenParams& params, const LevelData& level);
+
+    // places the point and its mirror images if all of them fit
+    bool tryPlace(float x, float z);
+
+    // the part of the area that is mirrored into the rest
+    float domainMaxX(void) const { return m_params.symmetry != SYMMETRY_NONE ? m_cx : m_params.maxX; }
+    float domainMaxZ(void) const { return m_params.symmetry == SYMMETRY_MIRROR_XZ ? m_cz : m_params.maxZ; }
+    float getCenterX(void) const { return m_cx; }
+    float getCenterZ(void) const { return m_cz; }
+
+    int getCellCount(void) const { return m_cols * m_rows; }
+    void getCell(int cell, float* x, float* z, float* size) const;
+
+    // every accepted point and its images form a group, kept or dropped together
+    std::vector<float>  x, z;
+    std::vector<int>    groupStart;
+
+private:
+    int images(float px, float pz, float* ix, float* iz) const;
+    bool fits(float px, float pz) const;
+    bool insideBoundary(float px, float pz) const;
+
+    const LevelGenParams&   m_params;
+    float                   m_cx, m_cz;
+    float                   m_spacing2;
+
+    // walls : the stock half-planes, or the level's segments
+    bool                    m_custom;
+    WallPlanes              m_planes;
+    CBoundaryBVH            m_boundary;
+    float                   m_wallGap;
+
+    // white and red ball at their start positions
+    float                   m_ballX[2], m_ballZ[2];
+    float                   m_ballGap2;
+
+    // background grid : position of the brick in each cell (EMPTY_CELL when
+    // none), with a border of empty cells so a test never leaves the grid
+    float                   m_originX, m_originZ;
+    float                   m_cell;
+    int                     m_cols, m_rows;
+    std::vector<float>      m_gridX, m_gridZ;
+};
+
+CPlacer::CPlacer(const LevelGenParams& params, const LevelData& level)
+    : m_params(params)
+{
+    const float radius = (float)M_RADIUS;
+
+    m_cx = (params.minX + params.maxX) / 2;
+    m_cz = (params.minZ + params.maxZ) / 2;
+    m_spacing2 = params.spacing * params.spacing;
+
+    m_custom = !level.boundary.empty();
+    if (m_custom) {
+        m_boundary.build(level.boundary);
+    }
+    else {
+        CGameSession stock;
+        for (int k = 0; k < WALL_COUNT; k++) {
+            m_planes.nx[k] = stock.getWall(k).nx;
+            m_planes.nz[k] = stock.getWall(k).nz;
+            m_planes.d[k] = stock.getWall(k).d;
+        }
+    }
+    m_wallGap = radius + params.clearance;
+
+    m_ballX[0] = level.startX;
+    m_ballZ[0] = level.startZ;
+    m_ballX[1] = level.startX;
+    m_ballZ[1] = level.startZ - (float)(M_RADIUS + M_RADIUS);
+    m_ballGap2 = (radius + radius + params.clearance) * (radius + radius + params.clearance);
+
+    // cell diagonal = spacing, so a cell never holds two bricks
+    m_cell = params.spacing / sqrt(2.0f);
+    m_originX = params.minX - GRID_BORDER * m_cell;
+    m_originZ = params.minZ - GRID_BORDER * m_cell;
+    m_cols = (int)ceil((params.maxX - params.minX) / m_cell) + 1 + 2 * GRID_BORDER;
+    m_rows = (int)ceil((params.maxZ - params.minZ) / m_cell) + 1 + 2 * GRID_BORDER;
+    m_gridX.assign(m_cols * m_rows, EMPTY_CELL);
+    m_gridZ.assign(m_cols * m_rows, EMPTY_CELL);
+}
+
+void CPlacer::getCell(int cell, float* px, float* pz, float* size) const
+{
+    *px = m_originX + (cell % m_cols) * m_cell;
+    *pz = m_originZ + (cell / m_cols) * m_cell;
+    *size = m_cell;
+}
+
+// the point and its mirror images. 0 when the point is outside the mirrored
+// domain or so close to an axis that it would overlap its own image
+int CPlacer::images(float px, float pz, float* ix, float* iz) const
+{
+    float half = m_params.spacing / 2;
+    int countX = 1, countZ = 1;
+
+    if (m_params.symmetry != SYMMETRY_NONE) {
+        float gap = m_cx - px;
+        if (gap < -AXIS_EPSILON || (gap > AXIS_EPSILON && gap < half))
+            return 0;
+        countX = gap > AXIS_EPSILON ? 2 : 1;
+    }
+    if (m_params.symmetry == SYMMETRY_MIRROR_XZ) {
+        float gap = m_cz - pz;
+        if (gap < -AXIS_EPSILON || (gap > AXIS_EPSILON && gap < half))
+            return 0;
+        countZ = gap > AXIS_EPSILON ? 2 : 1;
+    }
+
+    int n = 0;
+    for (int a = 0; a < countX; a++) {
+        for (int b = 0; b < countZ; b++) {
+            ix[n] = a == 0 ? px : 2 * m_cx - px;
+            iz[n] = b == 0 ? pz : 2 * m_cz - pz;
+            n++;
+        }
+    }
+    return n;
+}
+
+// even-odd crossing test against every boundary segment
+bool CPlacer::insideBoundary(float px, float pz) const
+{
+    bool inside = false;
+    for (int i = 0; i < m_boundary.getSegmentCount(); i++) {
+        const Segment& s = m_boundary.getSegment(i);
+        if ((s.z0 > pz) != (s.z1 > pz)) {
+            float crossX = s.x0 + (pz - s.z0) / (s.z1 - s.z0) * (s.x1 - s.x0);
+            if (px < crossX)
+                inside = !inside;
+        }
+    }
+    return inside;
+}
+
+bool CPlacer::fits(float px, float pz) const
+{
+    const LevelGenParams& p = m_params;
+    if (px < p.minX || px > p.maxX || pz < p.minZ || pz > p.maxZ)
+        return false;
+
+    // neighbours first : they reject most candidates and are the cheapest test.
+    // the small tolerance lets lattice neighbours exactly 'spacing' apart pass
+    int col = (int)((px - m_originX) / m_cell);
+    int row = (int)((pz - m_originZ) / m_cell);
+    float limit = m_spacing2 * (1 - SPACING_TOLERANCE);
+    int close = 0;
+    for (int r = row - GRID_BORDER; r <= row + GRID_BORDER; r++) {
+        const float* gx = &m_gridX[r * m_cols + col - GRID_BORDER];
+        const float* gz = &m_gridZ[r * m_cols + col - GRID_BORDER];
+        for (int c = 0; c <= 2 * GRID_BORDER; c++) {
+            float dx = px - gx[c];
+            float dz = pz - gz[c];
+            close |= dx * dx + dz * dz < limit;
+        }
+    }
+    if (close)
+        return false;
+
+    if (p.mask != NULL) {
+        int c = std::min(p.maskCols - 1, (int)((px - p.minX) / (p.maxX - p.minX) * p.maskCols));
+        int r = std::min(p.maskRows - 1, (int)((pz - p.minZ) / (p.maxZ - p.minZ) * p.maskRows));
+        if (!p.mask[r * p.maskCols + c])
+            return false;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        float dx = px - m_ballX[i];
+        float dz = pz - m_ballZ[i];
+        if (dx * dx + dz * dz < m_ballGap2)
+            return false;
+    }
+
+    if (m_custom) {
+        SegmentHit hit;
+        return m_boundary.query(px, pz, m_wallGap, &hit, 1) == 0 && insideBoundary(px, pz);
+    }
+
+    float penetration[WALL_COUNT];
+    wallPenetration(m_planes, px, pz, m_wallGap, penetration);
+    for (int k = 0; k < WALL_COUNT; k++) {
+        if (penetration[k] > 0.0f)
+            return false;
+    }
+    return true;
+}
+
+bool CPlacer::tryPlace(float px, float pz)
+{
+    float ix[4], iz[4];
+    int n = images(px, pz, ix, iz);
+    if (n == 0)
+        return false;
+    for (int i = 0; i < n; i++) {
+        if (!fits(ix[i], iz[i]))
+            return false;
+    }
+
+    groupStart.push_back((int)x.size());
+    for (int i = 0; i < n; i++) {
+        int cell = (int)((iz[i] - m_originZ) / m_cell) * m_cols + (int)((ix[i] - m_originX) / m_cell);
+        m_gridX[cell] = ix[i];
+        m_gridZ[cell] = iz[i];
+        x.push_back(ix[i]);
+        z.push_back(iz[i]);
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Patterns
+// -----------------------------------------------------------------------------
+
+// Bridson's Poisson-disk sampling over the mirrored domain. when growth
+// stops, every grid cell gets one random try so separate islands of a mask
+// are filled too
+static void placePoisson(CPlacer& placer, const LevelGenParams& params, Random& random)
+{
+    const float PI_F = (float)PI;
+    std::vector<int> active;
+    float maxX = placer.domainMaxX();
+    float maxZ = placer.domainMaxZ();
+
+    for (int cell = 0; cell < placer.getCellCount(); cell++) {
+        float cx, cz, size;
+        placer.getCell(cell, &cx, &cz, &size);
+        if (cx > maxX || cz > maxZ)
+            continue;
+        if (!placer.tryPlace(cx + random.next() * size, cz + random.next() * size))
+            continue;
+        active.push_back((int)placer.groupStart.size() - 1);
+
+        while (!active.empty()) {
+            int pick = (int)active.size() - 1;
+            int group = active[pick];
+            float px = placer.x[placer.groupStart[group]];
+            float pz = placer.z[placer.groupStart[group]];
+
+            // candidates just outside the spacing, at evenly stepped angles from
+            // a random start : denser than random radii and far fewer misses
+            bool grown = false;
+            float start = random.next() * 2 * PI_F;
+            float distance = params.spacing * (1 + POISSON_GAP);
+            for (int t = 0; t < POISSON_TRIES && !grown; t++) {
+                float angle = start + t * (2 * PI_F / POISSON_TRIES);
+                if (placer.tryPlace(px + distance * cos(angle), pz + distance * sin(angle))) {
+                    active.push_back((int)placer.groupStart.size() - 1);
+                    grown = true;
+                }
+            }
+            if (!grown) {
+                active[pick] = active.back();
+                active.pop_back();
+            }
+        }
+    }
+}
+
+// lattice anchored at the area center, so mirrored lattices line up
+static void placeLattice(CPlacer& placer, const LevelGenParams& params)
+{
+    float step = params.spacing;
+    float rowStep = params.pattern == PATTERN_HEX ? step * sqrt(3.0f) / 2 : step;
+    float cx = placer.getCenterX();
+    float cz = placer.getCenterZ();
+
+    int row0 = (int)floor((params.minZ - cz) / rowStep);
+    int row1 = (int)ceil((placer.domainMaxZ() - cz) / rowStep);
+    int col0 = (int)floor((params.minX - cx) / step) - 1;
+    int col1 = (int)ceil((placer.domainMaxX() - cx) / step);
+
+    for (int j = row0; j <= row1; j++) {
+        float offset = params.pattern == PATTERN_HEX && (j & 1) ? step / 2 : 0.0f;
+        for (int i = col0; i <= col1; i++)
+            placer.tryPlace(cx + offset + i * step, cz + j * rowStep);
+    }
+}
+
+int generateLevel(const LevelGenParams& params, LevelData& level)
+{
+    LevelGenParams p = params;
+    p.spacing = std::max(p.spacing, (float)(M_RADIUS + M_RADIUS));
+    p.density = std::min(1.0f, std::max(0.0f, p.density));
+
+    level.brickX.clear();
+    level.brickZ.clear();
+    if (p.maxX <= p.minX || p.maxZ <= p.minZ || (p.mask != NULL && (p.maskCols <= 0 || p.maskRows <= 0)))
+        return 0;
+
+    Random random(p.seed);
+    CPlacer placer(p, level);
+    if (p.pattern == PATTERN_POISSON)
+        placePoisson(placer, p, random);
+    else
+        placeLattice(placer, p);
+
+    // thin out whole groups (a brick with its mirror images) in random order
+    int groups = (int)placer.groupStart.size();
+    std::vector<int> order(groups);
+    for (int g = 0; g < groups; g++)
+        order[g] = g;
+    for (int g = groups - 1; g > 0; g--)
+        std::swap(order[g], order[random.nextInt() % (g + 1)]);
+
+    int keep = (int)(p.density * groups + 0.5f);
+    for (int k = 0; k < keep; k++) {
+        int g = order[k];
+        int begin = placer.groupStart[g];
+        int end = g + 1 < groups ? placer.groupStart[g + 1] : (int)placer.x.size();
+        if (p.maxBricks > 0 && (int)level.brickX.size() + end - begin > p.maxBricks)
+            continue;
+        for (int i = begin; i < end; i++) {
+            level.brickX.push_back(placer.x[i]);
+            level.brickZ.push_back(placer.z[i]);
+        }
+    }
+    return (int)level.brickX.size();
+}
@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: levelGen.h
+//
+// Desc: Procedural brick layouts. Bricks are placed as a Poisson-disk
+//       pattern or on a square / hexagonal lattice, optionally limited by a
+//       shape mask (from text or a PGM image) and mirrored for symmetry.
+//       Every brick keeps at least 'spacing' between centers and stays clear
+//       of the table walls (or the level's boundary segments) and of the
+//       start positions of the white and red ball.
+//
+//       Candidates are tested against a background grid with one cell per
+//       spacing / sqrt(2), so each cell holds at most one brick and a test
+//       only looks at the 5 x 5 cells around it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __levelGenH__
+#define __levelGenH__
+
+#include "level.h"
+#include <vector>
+
+enum LevelPattern
+{
+    PATTERN_POISSON = 0,    // random, evenly spread
+    PATTERN_SQUARE,         // square lattice
+    PATTERN_HEX             // hexagonal lattice (densest packing)
+};
+
+enum LevelSymmetry
+{
+    SYMMETRY_NONE = 0,
+    SYMMETRY_MIRROR_X,      // left / right mirror about the area center
+    SYMMETRY_MIRROR_XZ      // mirrored along both axes
+};
+
+struct LevelGenParams
+{
+    LevelPattern    pattern;
+    LevelSymmetry   symmetry;
+    unsigned        seed;
+
+    float           spacing;        // minimum distance between brick centers (at least 2 * M_RADIUS)
+    float           density;        // 0..1 : share of the possible positions that get a brick
+    int             maxBricks;      // 0 : no limit
+    float           clearance;      // extra gap between a brick and the walls
+
+    float           minX, minZ;     // area the bricks are placed in
+    float           maxX, maxZ;
+
+    // optional shape mask laid over the area, row 0 at minZ. a brick is
+    // only placed where the mask is non-zero
+    const unsigned char* mask;
+    int             maskCols, maskRows;
+};
+
+// stock table above the white ball, touching bricks, full density
+void defaultLevelGenParams(LevelGenParams& params);
+// the area of 'level' : its boundary's bounding box without the end the
+// white ball starts at, or the stock area when it has the stock walls
+void fitLevelGenArea(const LevelData& level, LevelGenParams& params);
+
+// mask from lines of text : any character other than ' ' or '.' is filled
+void makeTextMask(const char* const* lines, int rows, std::vector<unsigned char>& mask, int* cols);
+// mask from a binary PGM (P5) image : pixels brighter than half are filled
+bool loadMaskPGM(const char* path, std::vector<unsigned char>& mask, int* cols, int* rows);
+
+// replaces the bricks of 'level' and keeps its boundary and start position.
+// returns the number of bricks placed
+int generateLevel(const LevelGenParams& params, LevelData& level);
+
+#endif // __levelGenH__
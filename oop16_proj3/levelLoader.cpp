@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: levelLoader.cpp
+//
+// Desc: Background level loading.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "levelLoader.h"
+#include "levelGen.h"
+
+CLevelLoader::CLevelLoader(void)
+{
+    m_state = STATE_IDLE;
+    m_generate = false;
+    m_seed = 0;
+    m_result = NULL;
+}
+
+CLevelLoader::~CLevelLoader(void)
+{
+    if (m_thread.joinable())
+        m_thread.join();
+    delete m_result;
+}
+
+bool CLevelLoader::start(const char* path, bool generate, unsigned seed)
+{
+    if (m_state.load() != STATE_IDLE)
+        return false;
+    if (m_thread.joinable())
+        m_thread.join();
+
+    m_path = path != NULL ? path : "";
+    m_generate = generate;
+    m_seed = seed;
+    m_result = NULL;
+
+    m_state = STATE_LOADING;
+    m_thread = std::thread(&CLevelLoader::run, this);
+    return true;
+}
+
+LoadedWorld* CLevelLoader::take(bool* failed)
+{
+    *failed = false;
+    if (m_state.load(std::memory_order_acquire) != STATE_DONE)
+        return NULL;
+
+    m_thread.join();
+    LoadedWorld* world = m_result;
+    m_result = NULL;
+    m_state = STATE_IDLE;
+
+    *failed = world == NULL;
+    return world;
+}
+
+void CLevelLoader::run(void)
+{
+    LoadedWorld* world = new LoadedWorld;
+
+    bool ok = true;
+    if (m_path.empty())
+        makeStockLevel(world->level);
+    else
+        ok = loadLevel(m_path.c_str(), world->level);
+
+    if (ok && m_generate) {
+        LevelGenParams params;
+        defaultLevelGenParams(params);
+        fitLevelGenArea(world->level, params);
+        params.seed = m_seed;
+        generateLevel(params, world->level);
+    }
+
+    if (ok) {
+        // boundary BVH and start layout
+        world->session.load(&world->level);
+    }
+    else {
+        delete world;
+        world = NULL;
+    }
+
+    m_result = world;
+    m_state.store(STATE_DONE, std::memory_order_release);
+}
@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: levelLoader.h
+//
+// Desc: Builds the next table on a background thread. The thread parses the
+//       level file (or generates a layout), then loads it into a fresh
+//       CGameSession, which builds the boundary BVH and the start layout.
+//       The render thread polls take() once per frame and gets the finished
+//       world in one piece; the current table keeps running until then.
+//
+//       Direct3D objects are not created here. The device is not created
+//       multithreaded, so the app builds them itself in small batches per
+//       frame before it swaps the new world in.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __levelLoaderH__
+#define __levelLoaderH__
+
+#include "gameSession.h"
+#include <string>
+#include <thread>
+#include <atomic>
+
+// a table ready to play. the session points at 'level', so a LoadedWorld is
+// never copied and must outlive the session it was built with
+struct LoadedWorld
+{
+    LevelData       level;
+    CGameSession    session;
+};
+
+class CLevelLoader {
+public:
+    CLevelLoader(void);
+    ~CLevelLoader(void);
+
+    // start building a world. path : level file, NULL or "" for the stock
+    // table. generate : replace its bricks with generateLevel() using 'seed'.
+    // returns false while an earlier load is still running
+    bool start(const char* path, bool generate, unsigned seed);
+
+    bool isBusy(void) const { return m_state.load() != STATE_IDLE; }
+
+    // the finished world (the caller deletes it), or NULL while loading or
+    // when nothing was requested. *failed is set when the level file could
+    // not be read
+    LoadedWorld* take(bool* failed);
+
+private:
+    CLevelLoader(const CLevelLoader&);
+    CLevelLoader& operator=(const CLevelLoader&);
+
+    enum { STATE_IDLE = 0, STATE_LOADING, STATE_DONE };
+
+    void run(void);
+
+    std::thread         m_thread;
+    std::atomic<int>    m_state;
+
+    // request and result, owned by the loader thread while STATE_LOADING
+    std::string         m_path;
+    bool                m_generate;
+    unsigned            m_seed;
+    LoadedWorld*        m_result;
+};
+
+#endif // __levelLoaderH__
@@ -0,0 +1,142 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: motionModel.cpp
+//
+// Desc: Closed-form ball motion under exponential friction.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "motionModel.h"
+#include "gameSession.h"
+#include <cmath>
+
+// ballUpdate() zeroes a velocity whose components are both below this
+const double STOP_SPEED = 0.01;
+
+// milliseconds per frame the per-frame friction factor is spread over
+const double REFERENCE_FRAME_MS = 1000.0 / 60.0;
+
+void makeMotionModel(const PhysicsConfig& config, MotionModel& model)
+{
+    double frame = REFERENCE_FRAME_MS * config.clockScale;
+    double k = (1 - config.decreaseRate) * 400;
+    if (frame > 0 && config.decreaseRate > 0)
+        k -= log(config.decreaseRate) / frame;
+
+    model.k = k;
+    model.timeScale = config.timeScale;
+    model.floorSpeed = config.minVelocity;
+    model.stopSpeed = STOP_SPEED;
+    model.maxSpeed = config.maxSpeed;
+}
+
+// the speed where the exponential part ends, and the speed after it
+static double limitSpeed(const MotionModel& model)
+{
+    return model.floorSpeed > model.stopSpeed ? model.floorSpeed : model.stopSpeed;
+}
+
+static double finalSpeed(const MotionModel& model, double speed0)
+{
+    if (model.floorSpeed > model.stopSpeed)
+        return speed0 < model.floorSpeed ? speed0 : model.floorSpeed;
+    return 0;
+}
+
+static double clampSpeed(const MotionModel& model, double speed0)
+{
+    return speed0 > model.maxSpeed ? model.maxSpeed : speed0;
+}
+
+// length of the exponential part (MOTION_NEVER without friction)
+static double decayTime(const MotionModel& model, double speed0)
+{
+    double limit = limitSpeed(model);
+    if (speed0 <= limit)
+        return 0;
+    if (!(model.k > 0))
+        return MOTION_NEVER;
+    return log(speed0 / limit) / model.k;
+}
+
+// distance of the exponential part after time t (t within the part)
+static double decayDistance(const MotionModel& model, double speed0, double t)
+{
+    if (!(model.k > 0))
+        return model.timeScale * speed0 * t;
+    return model.timeScale * speed0 * -expm1(-model.k * t) / model.k;
+}
+
+double motionSpeed(const MotionModel& model, double speed0, double t)
+{
+    speed0 = clampSpeed(model, speed0);
+    if (t < decayTime(model, speed0))
+        return speed0 * exp(-model.k * t);
+    return finalSpeed(model, speed0);
+}
+
+double motionDistance(const MotionModel& model, double speed0, double t)
+{
+    speed0 = clampSpeed(model, speed0);
+    double t1 = decayTime(model, speed0);
+    if (t < t1)
+        return decayDistance(model, speed0, t);
+    return decayDistance(model, speed0, t1) + model.timeScale * finalSpeed(model, speed0) * (t - t1);
+}
+
+double motionTimeToStop(const MotionModel& model, double speed0)
+{
+    speed0 = clampSpeed(model, speed0);
+    if (finalSpeed(model, speed0) > 0)
+        return MOTION_NEVER;
+    return decayTime(model, speed0);
+}
+
+double motionStopDistance(const MotionModel& model, double speed0)
+{
+    double t = motionTimeToStop(model, speed0);
+    if (t == MOTION_NEVER)
+        return MOTION_NEVER;
+    return decayDistance(model, clampSpeed(model, speed0), t);
+}
+
+double motionTimeToTravel(const MotionModel& model, double speed0, double distance)
+{
+    speed0 = clampSpeed(model, speed0);
+    if (distance <= 0)
+        return 0;
+    if (!(speed0 > 0) || !(model.timeScale > 0))
+        return MOTION_NEVER;
+
+    // within the exponential part : invert d(t)
+    double t1 = decayTime(model, speed0);
+    double d1 = t1 == MOTION_NEVER ? MOTION_NEVER : decayDistance(model, speed0, t1);
+    if (distance <= d1) {
+        if (!(model.k > 0))
+            return distance / (model.timeScale * speed0);
+        return -log1p(-distance * model.k / (model.timeScale * speed0)) / model.k;
+    }
+
+    // then at constant speed, if the ball still moves
+    double s = finalSpeed(model, speed0);
+    if (!(s > 0))
+        return MOTION_NEVER;
+    return t1 + (distance - d1) / (model.timeScale * s);
+}
+
+void advanceBall(const MotionModel& model, BallState& ball, float t)
+{
+    double speed0 = sqrt((double)ball.vx * ball.vx + (double)ball.vz * ball.vz);
+    if (!(speed0 > 0))
+        return;
+
+    double dx = ball.vx / speed0;
+    double dz = ball.vz / speed0;
+    double distance = motionDistance(model, speed0, t);
+    double speed = motionSpeed(model, speed0, t);
+
+    ball.x = (float)(ball.x + dx * distance);
+    ball.z = (float)(ball.z + dz * distance);
+    ball.vx = (float)(dx * speed);
+    ball.vz = (float)(dz * speed);
+}
@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: motionModel.h
+//
+// Desc: Closed-form ball motion. The per-frame law of ballUpdate() depends on
+//       the frame rate and can only be advanced one frame at a time. Here the
+//       same friction is a continuous exponential decay of the speed,
+//
+//           s(t) = s0 * exp(-k t)          d(t) = timeScale * s0 * (1 - exp(-k t)) / k
+//
+//       until the speed reaches a floor (minVelocity, the ball then rolls on
+//       at that speed) or, without a floor, the stop speed (the ball rests).
+//       Friction never turns a ball, so position and velocity after any time
+//       come from two evaluations, and the inverse questions (when does the
+//       ball stop, when has it rolled a given distance) have exact answers.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __motionModelH__
+#define __motionModelH__
+
+#include "physicsConfig.h"
+#include <cfloat>
+
+struct BallState;
+
+// answer of the time and distance queries when the event never happens
+const float MOTION_NEVER = FLT_MAX;
+
+struct MotionModel
+{
+    double  k;              // decay rate per unit of timeDelta
+    double  timeScale;      // distance per velocity and timeDelta
+    double  floorSpeed;     // the speed never decays below this (0 : no floor)
+    double  stopSpeed;      // without a floor, slower balls rest
+    double  maxSpeed;       // a faster ball is slowed to this first
+};
+
+// k is the time-dependent friction of ballUpdate() plus its per-frame factor
+// taken as if frames came at 60 Hz
+void makeMotionModel(const PhysicsConfig& config, MotionModel& model);
+
+// speed and distance rolled after time t, for a ball starting at speed0
+double motionSpeed(const MotionModel& model, double speed0, double t);
+double motionDistance(const MotionModel& model, double speed0, double t);
+
+// time until the ball rests, and the distance it rolls until then
+double motionTimeToStop(const MotionModel& model, double speed0);
+double motionStopDistance(const MotionModel& model, double speed0);
+
+// time until the ball has rolled 'distance'
+double motionTimeToTravel(const MotionModel& model, double speed0, double distance);
+
+// move a ball along its velocity by time t, in O(1) for any t
+void advanceBall(const MotionModel& model, BallState& ball, float t);
+
+#endif // __motionModelH__
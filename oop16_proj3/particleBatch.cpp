@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: particleBatch.cpp
+//
+// Desc: Point sprite drawing of the particles.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "particleBatch.h"
+
+const DWORD PARTICLE_FVF = D3DFVF_XYZ | D3DFVF_DIFFUSE;
+
+// float render states are passed as their bits
+static DWORD floatBits(float f)
+{
+    return *(DWORD*)&f;
+}
+
+CParticleBatch::CParticleBatch(void)
+{
+    m_pVB = NULL;
+    m_capacity = 0;
+    m_offset = 0;
+    m_pointSize = 0;
+    m_drawCount = 0;
+    m_discardCount = 0;
+}
+
+bool CParticleBatch::create(IDirect3DDevice9* pDevice, int vertices, float pointSize)
+{
+    if (NULL == pDevice || vertices <= 0)
+        return false;
+    destroy();
+
+    if (FAILED(pDevice->CreateVertexBuffer(vertices * sizeof(ParticleVertex),
+        D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY | D3DUSAGE_POINTS, PARTICLE_FVF, D3DPOOL_DEFAULT, &m_pVB, NULL)))
+        return false;
+    m_capacity = vertices;
+    m_offset = 0;
+    m_pointSize = pointSize;
+    return true;
+}
+
+void CParticleBatch::destroy(void)
+{
+    if (m_pVB != NULL) {
+        m_pVB->Release();
+        m_pVB = NULL;
+    }
+    m_capacity = 0;
+}
+
+void CParticleBatch::draw(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld, const CParticleSystem& particles)
+{
+    m_drawCount = 0;
+    m_discardCount = 0;
+    int count = particles.getCount();
+    if (NULL == pDevice || m_pVB == NULL || count <= 0)
+        return;
+
+    pDevice->SetTransform(D3DTS_WORLD, &mWorld);
+    pDevice->SetFVF(PARTICLE_FVF);
+    pDevice->SetStreamSource(0, m_pVB, 0, sizeof(ParticleVertex));
+
+    // glowing sprites that shrink with the distance and never hide each other
+    pDevice->SetRenderState(D3DRS_LIGHTING, FALSE);
+    pDevice->SetRenderState(D3DRS_POINTSPRITEENABLE, TRUE);
+    pDevice->SetRenderState(D3DRS_POINTSCALEENABLE, TRUE);
+    pDevice->SetRenderState(D3DRS_POINTSIZE, floatBits(m_pointSize));
+    pDevice->SetRenderState(D3DRS_POINTSIZE_MIN, floatBits(1.0f));
+    pDevice->SetRenderState(D3DRS_POINTSCALE_A, floatBits(0.0f));
+    pDevice->SetRenderState(D3DRS_POINTSCALE_B, floatBits(0.0f));
+    pDevice->SetRenderState(D3DRS_POINTSCALE_C, floatBits(1.0f));
+    pDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+    pDevice->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+    pDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_ONE);
+    pDevice->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
+
+    for (int first = 0; first < count; ) {
+        // append while the ring has room, start it over when it does not
+        DWORD flags = D3DLOCK_NOOVERWRITE;
+        if (m_offset >= m_capacity) {
+            m_offset = 0;
+            flags = D3DLOCK_DISCARD;
+            m_discardCount++;
+        }
+        int n = count - first < m_capacity - m_offset ? count - first : m_capacity - m_offset;
+
+        ParticleVertex* out;
+        if (FAILED(m_pVB->Lock(m_offset * sizeof(ParticleVertex), n * sizeof(ParticleVertex), (void**)&out, flags)))
+            break;
+        particles.writeVertices(out, first, n);
+        m_pVB->Unlock();
+
+        pDevice->DrawPrimitive(D3DPT_POINTLIST, m_offset, n);
+        m_drawCount++;
+        m_offset += n;
+        first += n;
+    }
+
+    pDevice->SetRenderState(D3DRS_ZWRITEENABLE, TRUE);
+    pDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+    pDevice->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+    pDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+    pDevice->SetRenderState(D3DRS_POINTSCALEENABLE, FALSE);
+    pDevice->SetRenderState(D3DRS_POINTSPRITEENABLE, FALSE);
+    pDevice->SetRenderState(D3DRS_LIGHTING, TRUE);
+}
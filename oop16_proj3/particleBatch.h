@@ -0,0 +1,48 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: particleBatch.h
+//
+// Desc: Draws a CParticleSystem as point sprites. All particles of a frame
+//       are streamed into one dynamic vertex buffer used as a ring : each
+//       draw appends behind the last one with D3DLOCK_NOOVERWRITE, so the
+//       GPU keeps reading what was drawn before, and only a full ring is
+//       started over with D3DLOCK_DISCARD, which gives fresh memory instead
+//       of a stall.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __particleBatchH__
+#define __particleBatchH__
+
+#include "d3dUtility.h"
+#include "particles.h"
+
+class CParticleBatch {
+public:
+    CParticleBatch(void);
+    ~CParticleBatch(void) {}
+
+    // a ring of 'vertices' points; more particles take several draws
+    bool create(IDirect3DDevice9* pDevice, int vertices, float pointSize);
+    void destroy(void);
+
+    // every live particle, additive and without depth writes
+    void draw(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld, const CParticleSystem& particles);
+
+    // device draw calls and ring restarts (discards) of the last draw()
+    int getDrawCount(void) const { return m_drawCount; }
+    int getDiscardCount(void) const { return m_discardCount; }
+
+private:
+    CParticleBatch(const CParticleBatch&);
+    CParticleBatch& operator=(const CParticleBatch&);
+
+    IDirect3DVertexBuffer9*     m_pVB;
+    int                         m_capacity;     // vertices in the ring
+    int                         m_offset;       // next free vertex
+    float                       m_pointSize;
+    int                         m_drawCount;
+    int                         m_discardCount;
+};
+
+#endif // __particleBatchH__
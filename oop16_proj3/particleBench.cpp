@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: particleBench.cpp
+//
+// Desc: Command line tool that times CParticleSystem without a window : the
+//       update of every frame and the vertex fill the renderer would do. It
+//       is a separate program, not part of the VirtualLego project :
+//
+//         g++ -O3 particleBench.cpp particles.cpp -o particleBench
+//
+//       (gcc leaves the update loop scalar at -O2)
+//
+//       particleBench [options]
+//
+//         -particles <n>  particles kept alive (default 100000)
+//         -frames <n>     frames to time (default 1000)
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "particles.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedMs(Clock::time_point begin)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+int main(int argc, char* argv[])
+{
+    int target = 100000;
+    int frames = 1000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-particles") == 0)
+            target = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-frames") == 0)
+            frames = atoi(argv[i + 1]);
+        else {
+            fprintf(stderr, "usage : particleBench [-particles <n>] [-frames <n>]\n");
+            return 1;
+        }
+    }
+    if (target <= 0 || frames <= 0) {
+        fprintf(stderr, "particles and frames must be positive\n");
+        return 1;
+    }
+
+    CParticleSystem particles;
+    particles.reserve(target);
+    std::vector<ParticleVertex> vertices(target);
+
+    // bursts at brick-like spots keep the count up, like a table full of breaks
+    const float timeDelta = 1.0f / 60.0f;
+    double emitMs = 0, updateMs = 0, writeMs = 0;
+    long long updated = 0;
+    unsigned spot = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        Clock::time_point begin = Clock::now();
+        while (particles.getCount() < target) {
+            float x = (float)(spot % 9) - 4.0f;
+            float z = (float)(spot / 9 % 6) - 3.0f;
+            spot++;
+            particles.emit(x, 0.2f, z, 48, PARTICLE_DEBRIS);
+            particles.emit(x, 0.2f, z, 96, PARTICLE_SPARKS);
+        }
+        emitMs += elapsedMs(begin);
+
+        begin = Clock::now();
+        particles.update(timeDelta);
+        updateMs += elapsedMs(begin);
+        updated += particles.getCount();
+
+        begin = Clock::now();
+        particles.writeVertices(&vertices[0], 0, particles.getCount());
+        writeMs += elapsedMs(begin);
+    }
+
+    printf("%d frames, %d particles\n", frames, target);
+    printf("emit    %8.4f ms per frame\n", emitMs / frames);
+    printf("update  %8.4f ms per frame\n", updateMs / frames);
+    printf("write   %8.4f ms per frame\n", writeMs / frames);
+    printf("%.1f million particle updates per second\n", updated / (updateMs * 1000.0));
+
+    // keeps the vertex fill from being optimized away
+    unsigned check = 0;
+    for (int i = 0; i < particles.getCount(); i++)
+        check += vertices[i].color;
+    printf("check %08x\n", check);
+    return 0;
+}
@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: particles.cpp
+//
+// Desc: Brick debris and sparks, simulated as a structure of arrays.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "particles.h"
+#include <cmath>
+#include <algorithm>
+
+// speeds are distance per timeDelta unit, like the balls; about 0.7 timeDelta
+// pass per second with the default clockScale
+const ParticleStyle PARTICLE_DEBRIS = { 1.5f, 3.0f, 0.9f, 0xffe0c020 };
+const ParticleStyle PARTICLE_SPARKS = { 5.0f, 4.0f, 0.35f, 0xffffe0a0 };
+
+CParticleSystem::CParticleSystem(void)
+{
+    m_count = 0;
+    m_seed = 2463534242u;
+    setMotion(12.0f, 0.25f, 0.35f);
+}
+
+void CParticleSystem::reserve(int capacity)
+{
+    m_x.resize(capacity);   m_y.resize(capacity);   m_z.resize(capacity);
+    m_vx.resize(capacity);  m_vy.resize(capacity);  m_vz.resize(capacity);
+    m_life.resize(capacity);
+    m_fade.resize(capacity);
+    m_color.resize(capacity);
+    if (m_count > capacity)
+        m_count = capacity;
+}
+
+void CParticleSystem::setMotion(float gravity, float drag, float restitution)
+{
+    m_gravity = gravity;
+    m_drag = drag;
+    m_restitution = restitution;
+}
+
+unsigned CParticleSystem::random(void)
+{
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return m_seed;
+}
+
+int CParticleSystem::emit(float x, float y, float z, int count, const ParticleStyle& style)
+{
+    const float unit = 1.0f / 16777216.0f;      // 24 random bits to [0, 1)
+    count = std::min(count, getCapacity() - m_count);
+    for (int k = 0; k < count; k++) {
+        int i = m_count++;
+        float angle = (random() >> 8) * unit * 2 * 3.14159265f;
+        float speed = (random() >> 8) * unit * style.speed;
+        float life = (0.5f + 0.5f * (random() >> 8) * unit) * style.life;
+        m_x[i] = x;
+        m_y[i] = y;
+        m_z[i] = z;
+        m_vx[i] = cosf(angle) * speed;
+        m_vz[i] = sinf(angle) * speed;
+        m_vy[i] = (0.3f + 0.7f * (random() >> 8) * unit) * style.upSpeed;
+        m_life[i] = life;
+        m_fade[i] = 1.0f / life;
+        m_color[i] = style.color & 0x00ffffff;
+    }
+    return count;
+}
+
+// branch free, so the compiler runs 4 particles per instruction. a particle below
+// the table is mirrored back up and its fall turned around. the arrays are
+// parameters so __restrict tells the compiler they never overlap
+static void integrate(float* __restrict px, float* __restrict py, float* __restrict pz,
+    float* __restrict pvx, float* __restrict pvy, float* __restrict pvz, float* __restrict life,
+    int count, float timeDelta, float keep, float fall, float restitution)
+{
+    for (int i = 0; i < count; i++) {
+        float vx = pvx[i] * keep;
+        float vz = pvz[i] * keep;
+        float vy = (pvy[i] - fall) * keep;
+        float y = py[i] + vy * timeDelta;
+        float below = (float)(y < 0.0f);
+        px[i] += vx * timeDelta;
+        pz[i] += vz * timeDelta;
+        py[i] = std::max(y, -y * restitution);
+        pvx[i] = vx;
+        pvz[i] = vz;
+        pvy[i] = vy - below * (1.0f + restitution) * vy;
+        life[i] -= timeDelta;
+    }
+}
+
+void CParticleSystem::update(float timeDelta)
+{
+    if (m_count == 0)
+        return;
+    integrate(&m_x[0], &m_y[0], &m_z[0], &m_vx[0], &m_vy[0], &m_vz[0], &m_life[0], m_count,
+        timeDelta, powf(m_drag, timeDelta), m_gravity * timeDelta, m_restitution);
+
+    // recycle : the last live particle fills each dead slot. from the back, so
+    // the particle moved in has been looked at already
+    for (int i = m_count - 1; i >= 0; i--) {
+        if (m_life[i] > 0.0f)
+            continue;
+        int last = --m_count;
+        m_x[i] = m_x[last];     m_y[i] = m_y[last];     m_z[i] = m_z[last];
+        m_vx[i] = m_vx[last];   m_vy[i] = m_vy[last];   m_vz[i] = m_vz[last];
+        m_life[i] = m_life[last];
+        m_fade[i] = m_fade[last];
+        m_color[i] = m_color[last];
+    }
+}
+
+void CParticleSystem::writeVertices(ParticleVertex* out, int first, int count) const
+{
+    for (int k = 0; k < count; k++) {
+        int i = first + k;
+        float alpha = std::min(m_life[i] * m_fade[i], 1.0f) * 255.0f;
+        out[k].x = m_x[i];
+        out[k].y = m_y[i];
+        out[k].z = m_z[i];
+        out[k].color = ((unsigned)alpha << 24) | m_color[i];
+    }
+}
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: particles.h
+//
+// Desc: Debris and sparks of broken bricks. Particles are kept as a
+//       structure of arrays (one array per field) packed at the front, so
+//       update() is a few straight loops over plain floats that the compiler
+//       turns into SIMD code, like the lanes of CWorldPack. Dead particles
+//       are recycled by moving the last live one into their slot.
+//
+//       Nothing here touches Direct3D : writeVertices() fills point-sprite
+//       vertices for whichever renderer streams them (particleBatch.h), and
+//       particleBench.cpp times the simulation without a window.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __particlesH__
+#define __particlesH__
+
+#include <vector>
+
+// how one burst looks
+struct ParticleStyle
+{
+    float       speed;          // sideways speed, up to
+    float       upSpeed;        // upward speed, up to
+    float       life;           // seconds of timeDelta, up to
+    unsigned    color;          // ARGB; alpha fades out with the life left
+};
+
+// a point sprite vertex : D3DFVF_XYZ | D3DFVF_DIFFUSE
+struct ParticleVertex
+{
+    float       x, y, z;
+    unsigned    color;
+};
+
+extern const ParticleStyle PARTICLE_DEBRIS;     // brick colored chunks
+extern const ParticleStyle PARTICLE_SPARKS;     // fast, short and bright
+
+class CParticleSystem {
+public:
+    CParticleSystem(void);
+
+    // room for 'capacity' particles. the only allocation; emit() never allocates
+    void reserve(int capacity);
+    int  getCapacity(void) const { return (int)m_x.size(); }
+    int  getCount(void) const { return m_count; }
+    void clear(void) { m_count = 0; }
+
+    // 'count' particles from (x, y, z) in random directions. returns how many
+    // fit; the rest are dropped
+    int emit(float x, float y, float z, int count, const ParticleStyle& style);
+
+    // gravity, drag and a bounce off the table plane (y = 0), then the dead
+    // particles go
+    void update(float timeDelta);
+
+    // vertices of particles first .. first + count - 1 into 'out'
+    void writeVertices(ParticleVertex* out, int first, int count) const;
+
+    // the motion : gravity pulls y down, drag is the velocity kept per
+    // timeDelta unit, a bounce keeps 'restitution' of the speed
+    void setMotion(float gravity, float drag, float restitution);
+
+private:
+    unsigned random(void);
+
+    std::vector<float>      m_x, m_y, m_z;
+    std::vector<float>      m_vx, m_vy, m_vz;
+    std::vector<float>      m_life;         // time left
+    std::vector<float>      m_fade;         // 1 / starting life
+    std::vector<unsigned>   m_color;        // RGB, alpha comes from the life left
+    int                     m_count;
+
+    float                   m_gravity;
+    float                   m_drag;
+    float                   m_restitution;
+    unsigned                m_seed;         // xorshift state
+};
+
+#endif // __particlesH__
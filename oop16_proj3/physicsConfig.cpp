@@ -0,0 +1,181 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: physicsConfig.cpp
+//
+// Desc: Physics tuning values and their text file.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "physicsConfig.h"
+#include "gameSession.h"
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+enum FieldType { FIELD_FLOAT, FIELD_DOUBLE, FIELD_INT };
+
+// file name and valid range of each field
+struct ConfigField
+{
+    const char* name;
+    FieldType   type;
+    size_t      offset;
+    double      minValue;
+    double      maxValue;
+};
+
+static const ConfigField s_fields[] = {
+    { "decreaseRate",     FIELD_DOUBLE, offsetof(PhysicsConfig, decreaseRate),          0.0,  1.0 },
+    { "minVelocity",      FIELD_FLOAT,  offsetof(PhysicsConfig, minVelocity),           0.0,  100.0 },
+    { "slowBoost",        FIELD_FLOAT,  offsetof(PhysicsConfig, slowBoost),             0.0,  10.0 },
+    { "maxSpeed",         FIELD_FLOAT,  offsetof(PhysicsConfig, maxSpeed),              0.01, 1000.0 },
+    { "timeScale",        FIELD_FLOAT,  offsetof(PhysicsConfig, timeScale),             0.0,  1000.0 },
+    { "shotSpeed",        FIELD_DOUBLE, offsetof(PhysicsConfig, shotSpeed),             0.0,  1000.0 },
+    { "clockScale",       FIELD_DOUBLE, offsetof(PhysicsConfig, clockScale),            0.0,  1.0 },
+    { "analyticMotion",   FIELD_INT,    offsetof(PhysicsConfig, analyticMotion),        0.0,  1.0 },
+    { "solverIterations", FIELD_INT,    offsetof(PhysicsConfig, solverIterations),      0.0,  64.0 },
+    { "spin",             FIELD_INT,    offsetof(PhysicsConfig, spin),                  0.0,  1.0 },
+    { "slideFriction",    FIELD_FLOAT,  offsetof(PhysicsConfig, slideFriction),         0.0,  1000.0 },
+    { "spinFriction",     FIELD_FLOAT,  offsetof(PhysicsConfig, spinFriction),          0.0,  1000.0 },
+    { "contactFriction",  FIELD_FLOAT,  offsetof(PhysicsConfig, contactFriction),       0.0,  1.0 },
+    { "multiBall",        FIELD_INT,    offsetof(PhysicsConfig, multiBall),             0.0,  32000.0 },
+    { "multiBallLimit",   FIELD_INT,    offsetof(PhysicsConfig, multiBallLimit),        0.0,  32000.0 },
+};
+
+static const int FIELD_COUNT = sizeof(s_fields) / sizeof(s_fields[0]);
+
+void defaultPhysicsConfig(PhysicsConfig& config)
+{
+    config.decreaseRate = DECREASE_RATE;
+    config.minVelocity = MIN_VELOCITY;
+    config.slowBoost = 1.1f;
+    config.maxSpeed = 5.0f;
+    config.timeScale = 3.3f;
+    config.shotSpeed = 3;
+    config.clockScale = 0.0007;
+    config.analyticMotion = 0;
+    config.solverIterations = 0;
+    config.spin = 0;
+    config.slideFriction = 10.0f;
+    config.spinFriction = 15.0f;
+    config.contactFriction = 0.2f;
+    config.multiBall = 0;
+    config.multiBallLimit = 10000;
+}
+
+bool loadPhysicsConfig(const char* path, PhysicsConfig& config)
+{
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL)
+        return false;
+
+    PhysicsConfig loaded;
+    defaultPhysicsConfig(loaded);
+
+    char line[256];
+    int lineNo = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp) != NULL) {
+        lineNo++;
+
+        char word[32] = "";
+        double value;
+        if (sscanf(line, "%31s", word) != 1 || word[0] == '#')
+            continue;
+
+        int i = 0;
+        while (i < FIELD_COUNT && strcmp(word, s_fields[i].name) != 0)
+            i++;
+
+        if (i == FIELD_COUNT || sscanf(line, "%*s %lf", &value) != 1 ||
+            !(value >= s_fields[i].minValue && value <= s_fields[i].maxValue)) {
+            printf("%s(%d) : bad config line\n", path, lineNo);
+            ok = false;
+            break;
+        }
+
+        char* field = (char*)&loaded + s_fields[i].offset;
+        if (s_fields[i].type == FIELD_DOUBLE)
+            *(double*)field = value;
+        else if (s_fields[i].type == FIELD_FLOAT)
+            *(float*)field = (float)value;
+        else
+            *(int*)field = (int)value;
+    }
+
+    fclose(fp);
+    if (ok)
+        config = loaded;
+    return ok;
+}
+
+bool savePhysicsConfig(const char* path, const PhysicsConfig& config)
+{
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL)
+        return false;
+
+    fprintf(fp, "# billiard physics\n");
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        const char* field = (const char*)&config + s_fields[i].offset;
+        if (s_fields[i].type == FIELD_DOUBLE)
+            fprintf(fp, "%s %.17g\n", s_fields[i].name, *(const double*)field);
+        else if (s_fields[i].type == FIELD_FLOAT)
+            fprintf(fp, "%s %.9g\n", s_fields[i].name, *(const float*)field);
+        else
+            fprintf(fp, "%s %d\n", s_fields[i].name, *(const int*)field);
+    }
+
+    bool ok = ferror(fp) == 0;
+    fclose(fp);
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+// CConfigWatcher
+// -----------------------------------------------------------------------------
+
+CConfigWatcher::CConfigWatcher(void)
+{
+    m_path[0] = '\0';
+    m_mtime = 0;
+    m_size = -1;
+    m_countdown = 0;
+}
+
+bool CConfigWatcher::open(const char* path, PhysicsConfig& config)
+{
+    strncpy(m_path, path, sizeof(m_path) - 1);
+    m_path[sizeof(m_path) - 1] = '\0';
+    fileChanged();
+    return loadPhysicsConfig(m_path, config);
+}
+
+bool CConfigWatcher::poll(PhysicsConfig& config, int interval)
+{
+    if (m_path[0] == '\0' || --m_countdown > 0)
+        return false;
+    m_countdown = interval;
+
+    // an editor may still be writing the file : a bad file is reported and
+    // tried again on its next change, the running values stay
+    if (!fileChanged())
+        return false;
+    return loadPhysicsConfig(m_path, config);
+}
+
+// modification time and size, since the time alone only has a resolution of
+// one second on some file systems
+bool CConfigWatcher::fileChanged(void)
+{
+    struct stat st;
+    if (stat(m_path, &st) != 0)
+        return false;
+    if (st.st_mtime == m_mtime && (long)st.st_size == m_size)
+        return false;
+    m_mtime = st.st_mtime;
+    m_size = (long)st.st_size;
+    return true;
+}
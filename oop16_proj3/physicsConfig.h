@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: physicsConfig.h
+//
+// Desc: Tuning values of the game physics, read from a text file so they
+//       can be changed while the game runs.
+//
+//       # comment
+//       <name> <value>
+//
+//       Names are the fields of PhysicsConfig below; missing names keep
+//       their default. The simulation keeps its own copy of the struct and
+//       reads the fields directly, so a change is only seen after the
+//       owner hands in a new copy between two steps.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __physicsConfigH__
+#define __physicsConfigH__
+
+#include <ctime>
+
+struct PhysicsConfig
+{
+    double  decreaseRate;   // velocity kept per step - friction / drag
+    float   minVelocity;    // below this a velocity component is boosted, and a bounce is sped up
+    float   slowBoost;      // factor of that boost
+    float   maxSpeed;       // speed cap
+    float   timeScale;      // distance per velocity and timeDelta
+    double  shotSpeed;      // launch speed per unit of red / white ball distance
+    double  clockScale;     // timeDelta per millisecond of wall clock time
+    int     analyticMotion; // 1 : balls move by the closed-form model (motionModel.h), 0 : frame by frame
+    int     solverIterations; // 0 : contacts resolved one by one, n : solved together in n sweeps (contactSolver.h)
+    int     spin;           // 1 : balls spin, slide and roll (spinModel.h)
+    float   slideFriction;  // speed change by cloth friction per timeDelta while a ball slides
+    float   spinFriction;   // side spin the cloth takes away per timeDelta
+    float   contactFriction; // friction coefficient of ball and cushion contacts
+    int     multiBall;      // extra balls a power-up brick releases (0 : no power-ups)
+    int     multiBallLimit; // most extra balls on the table at once
+};
+
+// the values the game was tuned with
+void defaultPhysicsConfig(PhysicsConfig& config);
+
+// starts from the defaults. on a bad line or value 'config' is left as it was
+bool loadPhysicsConfig(const char* path, PhysicsConfig& config);
+bool savePhysicsConfig(const char* path, const PhysicsConfig& config);
+
+// -----------------------------------------------------------------------------
+// CConfigWatcher : reloads a config file when it changes on disk
+// -----------------------------------------------------------------------------
+
+class CConfigWatcher {
+public:
+    CConfigWatcher(void);
+
+    // loads the file once. returns false if it cannot be read
+    bool open(const char* path, PhysicsConfig& config);
+
+    // cheap enough to call every frame : the file time is only looked at
+    // every 'interval' calls. returns true when 'config' was reloaded
+    bool poll(PhysicsConfig& config, int interval = 30);
+
+private:
+    bool fileChanged(void);
+
+    char        m_path[260];
+    time_t      m_mtime;
+    long        m_size;
+    int         m_countdown;
+};
+
+#endif // __physicsConfigH__
@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: renderQueue.cpp
+//
+// Desc: Per-frame list of mesh draws sorted to avoid redundant state changes.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "renderQueue.h"
+#include <algorithm>
+#include <cstring>
+
+CRenderQueue::CRenderQueue(void)
+{
+    m_drawCount = 0;
+    m_culledCount = 0;
+    m_materialChanges = 0;
+}
+
+void CRenderQueue::clear(void)
+{
+    m_items.clear();
+    m_meshes.clear();
+    m_bounds.clear();
+}
+
+// objects keep their own copy of a material, so equal materials are found by
+// value. a scene only has a handful of colors, so a linear search is enough
+int CRenderQueue::findMaterial(const D3DMATERIAL9& mtrl)
+{
+    for (size_t i = 0; i < m_materials.size(); i++) {
+        if (memcmp(&m_materials[i], &mtrl, sizeof(mtrl)) == 0)
+            return (int)i;
+    }
+    m_materials.push_back(mtrl);
+    return (int)m_materials.size() - 1;
+}
+
+void CRenderQueue::add(ID3DXMesh* mesh, const D3DMATERIAL9& mtrl, const D3DXMATRIX& mLocal,
+    const d3d::BoundingSphere& bounds)
+{
+    if (mesh == NULL)
+        return;
+
+    unsigned meshIndex = 0;
+    while (meshIndex < m_meshes.size() && m_meshes[meshIndex] != mesh)
+        meshIndex++;
+    if (meshIndex == m_meshes.size())
+        m_meshes.push_back(mesh);
+
+    Item item;
+    item.key = ((unsigned)findMaterial(mtrl) << 16) | (meshIndex & 0xffff);
+    item.mesh = mesh;
+    item.local = &mLocal;
+    item.index = (int)m_items.size();
+    m_items.push_back(item);
+    m_bounds.push_back(bounds);
+}
+
+void CRenderQueue::flush(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld, const CFrustum* frustum)
+{
+    m_drawCount = 0;
+    m_culledCount = 0;
+    m_materialChanges = 0;
+    if (NULL == pDevice || m_items.empty())
+        return;
+
+    // items are still in add() order here, so index == position
+    int count = (int)m_items.size();
+    m_world.resize(count);
+    for (int i = 0; i < count; i++)
+        D3DXMatrixMultiply(&m_world[i], m_items[i].local, &mWorld);
+
+    // world bounds into one array per coordinate, one batch test, then the
+    // culled items leave before the sort
+    if (frustum != NULL) {
+        m_x.resize(count);  m_y.resize(count);  m_z.resize(count);  m_r.resize(count);
+        m_visible.resize(count);
+        d3d::BoundingSphere bounds;
+        for (int i = 0; i < count; i++) {
+            transformSphere(bounds, m_bounds[i], m_world[i]);
+            m_x[i] = bounds._center.x;
+            m_y[i] = bounds._center.y;
+            m_z[i] = bounds._center.z;
+            m_r[i] = bounds._radius;
+        }
+        m_culledCount = count - frustum->cull(&m_x[0], &m_y[0], &m_z[0], &m_r[0], count, &m_visible[0]);
+        if (m_culledCount > 0) {
+            const unsigned char* visible = &m_visible[0];
+            m_items.erase(std::remove_if(m_items.begin(), m_items.end(),
+                [visible](const Item& item) { return visible[item.index] == 0; }), m_items.end());
+        }
+    }
+
+    // stable, so draws with the same state keep the order they were added in
+    std::stable_sort(m_items.begin(), m_items.end(),
+        [](const Item& a, const Item& b) { return a.key < b.key; });
+
+    // the first draw always sets its material : anything drawn outside the
+    // queue may have changed it since the last frame
+    int material = -1;
+    for (size_t i = 0; i < m_items.size(); i++) {
+        const Item& item = m_items[i];
+        int itemMaterial = (int)(item.key >> 16);
+        if (itemMaterial != material) {
+            pDevice->SetMaterial(&m_materials[itemMaterial]);
+            material = itemMaterial;
+            m_materialChanges++;
+        }
+        pDevice->SetTransform(D3DTS_WORLD, &m_world[item.index]);
+        item.mesh->DrawSubset(0);
+    }
+    m_drawCount = (int)m_items.size();
+}
@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: renderQueue.h
+//
+// Desc: Per-frame list of mesh draws. Objects add themselves instead of
+//       drawing directly; flush() sorts the draws by material and mesh,
+//       multiplies every local matrix by the world matrix in one pass and
+//       only calls SetMaterial when the material actually changes.
+//
+//       Every draw carries a bounding sphere; given a frustum, flush() tests
+//       them all in one batch and drops the draws that are off screen
+//       before sorting.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __renderQueueH__
+#define __renderQueueH__
+
+#include "d3dUtility.h"
+#include "frustum.h"
+#include <vector>
+
+class CRenderQueue {
+public:
+    CRenderQueue(void);
+
+    // drop the draws of the last frame. the material table is kept
+    void clear(void);
+
+    // queue subset 0 of 'mesh'. the material and bounds (around the mesh, in
+    // its own space) are copied, the matrix is not : 'mLocal' must stay valid
+    // until flush()
+    void add(ID3DXMesh* mesh, const D3DMATERIAL9& mtrl, const D3DXMATRIX& mLocal,
+        const d3d::BoundingSphere& bounds);
+
+    // draw everything queued since clear() with mLocal * mWorld as world
+    // transform, only what is inside 'frustum' when one is given
+    void flush(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld, const CFrustum* frustum = NULL);
+
+    // device calls made by the last flush(), and the draws it culled
+    int getDrawCount(void) const { return m_drawCount; }
+    int getCulledCount(void) const { return m_culledCount; }
+    int getMaterialChanges(void) const { return m_materialChanges; }
+
+private:
+    struct Item
+    {
+        unsigned            key;        // material index (high bits), then mesh order
+        ID3DXMesh*          mesh;
+        const D3DXMATRIX*   local;
+        int                 index;      // order of add(), into m_world and the bounds
+    };
+
+    int findMaterial(const D3DMATERIAL9& mtrl);
+
+    std::vector<Item>           m_items;
+    std::vector<D3DMATERIAL9>   m_materials;    // distinct materials seen so far
+    std::vector<ID3DXMesh*>     m_meshes;       // distinct meshes of this frame
+    std::vector<D3DXMATRIX>     m_world;        // premultiplied transforms, in add() order
+    std::vector<d3d::BoundingSphere> m_bounds;  // as given to add(), in add() order
+    std::vector<float>          m_x, m_y, m_z, m_r;     // world bounds for CFrustum::cull
+    std::vector<unsigned char>  m_visible;
+    int                         m_drawCount;
+    int                         m_culledCount;
+    int                         m_materialChanges;
+};
+
+#endif // __renderQueueH__
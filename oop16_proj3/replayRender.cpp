@@ -0,0 +1,250 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: replayRender.cpp
+//
+// Desc: Command line tool that renders a telemetry recording (-telemetry)
+//       with CSoftRenderer, without a GPU or a window. It is a separate
+//       program, not part of the VirtualLego project :
+//
+//         g++ -O2 -pthread replayRender.cpp softRenderer.cpp workerPool.cpp
+//             telemetry.cpp gameSession.cpp level.cpp boundary.cpp
+//             physicsConfig.cpp motionModel.cpp fixedPoint.cpp contactSolver.cpp
+//             spinModel.cpp brickGrid.cpp -o replayRender
+//
+//       replayRender <recording> <output> [options]
+//
+//         output  frame%05d.ppm   one image per frame : one %d, or %0<n>d for
+//                                 n digits; %% is a percent sign
+//                 -               raw RGB24 frames on stdout, e.g.
+//                                 | ffmpeg -f rawvideo -pix_fmt rgb24
+//                                   -s 1024x1024 -r 60 -i - replay.mp4
+//                 thumb.ppm       only the last frame
+//
+//         -level <file>   table the recording was made on (default : stock)
+//         -size <n>       image width and height (default 1024)
+//         -threads <n>    render threads (default : one per core)
+//         -every <k>      render every k-th step (default 1)
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "softRenderer.h"
+#include "telemetry.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <chrono>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+enum OutputKind { OUTPUT_SEQUENCE, OUTPUT_PIPE, OUTPUT_THUMBNAIL };
+
+// an image sequence name split around its frame number. the name is never
+// handed to printf as a format, so a stray % can't read past the arguments
+struct FramePattern
+{
+    char    head[512];
+    char    tail[512];
+    int     digits;     // zero padded width, 0 : as many as needed
+};
+
+// false unless 'pattern' has exactly one %d or %0<n>d and nothing else after
+// a %, except %%
+static bool parsePattern(const char* pattern, FramePattern* out)
+{
+    char* dst = out->head;
+    size_t room = sizeof(out->head);
+    size_t n = 0;
+    int numbers = 0;
+    out->digits = 0;
+    for (const char* p = pattern; *p != 0; p++) {
+        char c = *p;
+        if (c == '%' && p[1] == '%') {
+            p++;
+        }
+        else if (c == '%') {
+            if (numbers++ > 0)
+                return false;
+            p++;
+            if (*p == '0') {
+                for (p++; isdigit((unsigned char)*p) && out->digits < 100; p++)
+                    out->digits = out->digits * 10 + (*p - '0');
+            }
+            if (*p != 'd' || out->digits >= 100)
+                return false;
+            dst[n] = 0;
+            dst = out->tail;
+            room = sizeof(out->tail);
+            n = 0;
+            continue;
+        }
+        if (n + 1 >= room)
+            return false;
+        dst[n++] = c;
+    }
+    dst[n] = 0;
+    return numbers == 1;
+}
+
+// balls are stored by BallId. the extra balls are red like in the window app,
+// the rival paddle white like the player's
+static void drawBalls(CSoftRenderer& renderer, const LevelData& level, const std::vector<unsigned char>& alive,
+    const TelemetryBall* balls, int ballCount, bool rival)
+{
+    const float radius = (float)M_RADIUS;
+    for (size_t i = 0; i < alive.size(); i++) {
+        if (alive[i])
+            renderer.addSphere(level.brickX[i], radius, level.brickZ[i], radius, SOFT_BRICK_MTRL);
+    }
+    if (ballCount > BALL_RED)
+        renderer.addSphere(balls[BALL_RED].x, radius, balls[BALL_RED].z, radius, SOFT_RED_MTRL);
+    if (ballCount > BALL_WHITE)
+        renderer.addSphere(balls[BALL_WHITE].x, radius, balls[BALL_WHITE].z, radius, SOFT_WHITE_MTRL);
+    if (rival && ballCount > BALL_RIVAL)
+        renderer.addSphere(balls[BALL_RIVAL].x, radius, balls[BALL_RIVAL].z, radius, SOFT_WHITE_MTRL);
+    for (int i = BALL_EXTRA; i < ballCount; i++)
+        renderer.addSphere(balls[i].x, radius, balls[i].z, radius, SOFT_RED_MTRL);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage : replayRender <recording> <output> [-level <file>] [-size <n>] [-threads <n>] [-every <k>]\n");
+        return 1;
+    }
+    const char* recording = argv[1];
+    const char* output = argv[2];
+    const char* levelPath = NULL;
+    int size = 1024;
+    int threads = 0;
+    int every = 1;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-level") == 0)
+            levelPath = argv[i + 1];
+        else if (strcmp(argv[i], "-size") == 0)
+            size = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-threads") == 0)
+            threads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-every") == 0)
+            every = atoi(argv[i + 1]);
+    }
+    if (size <= 0 || every <= 0) {
+        fprintf(stderr, "bad -size or -every\n");
+        return 1;
+    }
+
+    OutputKind kind = OUTPUT_THUMBNAIL;
+    FramePattern pattern;
+    if (strcmp(output, "-") == 0) {
+        kind = OUTPUT_PIPE;
+    }
+    else if (strchr(output, '%') != NULL) {
+        kind = OUTPUT_SEQUENCE;
+        if (!parsePattern(output, &pattern)) {
+            fprintf(stderr, "%s : a sequence name needs exactly one %%d or %%0<n>d (%%%% for a percent sign)\n", output);
+            return 1;
+        }
+    }
+#ifdef _WIN32
+    if (kind == OUTPUT_PIPE)
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    CTelemetryReader reader;
+    if (!reader.open(recording)) {
+        fprintf(stderr, "%s : not a telemetry recording\n", recording);
+        return 1;
+    }
+
+    // the table comes from the level file, the bricks from the recording
+    LevelData level;
+    if (levelPath != NULL) {
+        if (!loadLevel(levelPath, level)) {
+            fprintf(stderr, "%s : bad level file\n", levelPath);
+            return 1;
+        }
+    }
+    else {
+        makeStockLevel(level);
+    }
+    const float* bricks = reader.getBrickPositions();
+    level.brickX.resize(reader.getBrickCount());
+    level.brickZ.resize(reader.getBrickCount());
+    for (int i = 0; i < reader.getBrickCount(); i++) {
+        level.brickX[i] = bricks[i * 2];
+        level.brickZ[i] = bricks[i * 2 + 1];
+    }
+    CGameSession session;
+    session.load(&level);
+
+    CSoftRenderer renderer(size, size, threads);
+    std::vector<unsigned char> alive(level.brickX.size(), 1);
+
+    const TelemetryStepHeader* header;
+    const TelemetryBall* balls;
+    const ContactEvent* contacts;
+    int steps = 0;
+    int frames = 0;
+    double renderMs = 0;
+    char path[1024];
+
+    bool haveStep = reader.next(&header, &balls, &contacts);
+    while (haveStep) {
+        // bricks touched in this step are gone after it, unless the red ball
+        // also reached a deadly wall : then the table starts over
+        bool restart = false;
+        for (int i = 0; i < header->contactCount; i++) {
+            const ContactEvent& c = contacts[i];
+            if (c.kind == CONTACT_WALL && c.a == BALL_RED && session.isDeadlyWall(c.b))
+                restart = true;
+        }
+        if (!restart) {
+            for (int i = 0; i < header->contactCount; i++) {
+                const ContactEvent& c = contacts[i];
+                if (c.kind == CONTACT_BRICK && c.b < (int)alive.size())
+                    alive[c.b] = 0;
+            }
+        }
+
+        // the thumbnail needs the last step, so look one step ahead
+        int ballCount = header->ballCount;
+        std::vector<TelemetryBall> current(balls, balls + ballCount);
+        haveStep = reader.next(&header, &balls, &contacts);
+
+        bool draw = kind == OUTPUT_THUMBNAIL ? !haveStep : steps % every == 0;
+        if (draw) {
+            std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+            renderer.beginFrame();
+            addTableScene(renderer, session);
+            drawBalls(renderer, level, alive, ballCount > 0 ? &current[0] : NULL, ballCount, reader.hasRival());
+            renderer.render();
+            renderMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+            bool ok;
+            if (kind == OUTPUT_PIPE) {
+                ok = renderer.writeRaw(stdout);
+            }
+            else if (kind == OUTPUT_SEQUENCE) {
+                snprintf(path, sizeof(path), "%s%0*d%s", pattern.head, pattern.digits, frames, pattern.tail);
+                ok = renderer.writePPM(path);
+            }
+            else {
+                ok = renderer.writePPM(output);
+            }
+            if (!ok) {
+                fprintf(stderr, "writing frame %d failed\n", frames);
+                return 1;
+            }
+            frames++;
+        }
+
+        if (restart)
+            alive.assign(alive.size(), 1);
+        steps++;
+    }
+
+    fprintf(stderr, "%d steps, %d frames, %.2f ms per frame\n", steps, frames, frames > 0 ? renderMs / frames : 0.0);
+    return 0;
+}
@@ -0,0 +1,255 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: rollback.cpp
+//
+// Desc: Rollback netcode for CVersusGame.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "rollback.h"
+#include <cstring>
+#include <cstddef>
+#include <chrono>
+
+// what goes over the wire. both peers run the same build, so the struct is
+// sent as it is; only the used part of 'inputs' is sent
+struct RollbackPacket
+{
+    int         firstTick;          // tick of inputs[0]
+    int         inputCount;
+    int         ackTick;            // the sender has our inputs up to this tick
+    int         checksumTick;       // the sender's newest confirmed state, -1 : none
+    unsigned    checksum;
+    VersusInput inputs[CRollbackSession::RING_SIZE];
+};
+
+static const int PACKET_HEADER = (int)offsetof(RollbackPacket, inputs);
+
+static const VersusInput NO_INPUT = { 0, 0 };
+
+// -----------------------------------------------------------------------------
+// CLoopbackLink
+// -----------------------------------------------------------------------------
+
+CLoopbackLink::CLoopbackLink(int delayTicks, int jitterTicks, float loss, unsigned seed)
+{
+    m_delay = delayTicks > 0 ? delayTicks : 0;
+    m_jitter = jitterTicks > 0 ? jitterTicks : 0;
+    m_loss = loss;
+    m_random = seed != 0 ? seed : 1;
+    m_now = 0;
+    m_sent = 0;
+    m_lost = 0;
+    for (int i = 0; i < 2; i++) {
+        m_ends[i].link = this;
+        m_ends[i].peer = &m_ends[1 - i];
+    }
+}
+
+// xorshift32
+unsigned CLoopbackLink::nextRandom(void)
+{
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    return m_random;
+}
+
+void CLoopbackLink::End::send(const void* data, int size)
+{
+    link->m_sent++;
+    if ((link->nextRandom() & 0xffff) < (unsigned)(link->m_loss * 65536.0f)) {
+        link->m_lost++;
+        return;
+    }
+    Packet packet;
+    packet.due = link->m_now + link->m_delay + (int)(link->nextRandom() % (unsigned)(link->m_jitter + 1));
+    packet.data.assign((const unsigned char*)data, (const unsigned char*)data + size);
+    peer->inbox.push_back(packet);
+}
+
+int CLoopbackLink::End::receive(void* data, int capacity)
+{
+    // the earliest packet that is due; with jitter later ones may overtake it
+    int best = -1;
+    for (int i = 0; i < (int)inbox.size(); i++) {
+        if (inbox[i].due <= link->m_now && (best < 0 || inbox[i].due < inbox[best].due))
+            best = i;
+    }
+    if (best < 0)
+        return 0;
+
+    int size = (int)inbox[best].data.size();
+    if (size > capacity)
+        size = capacity;
+    if (size > 0)
+        memcpy(data, &inbox[best].data[0], size);
+    inbox.erase(inbox.begin() + best);
+    return size;
+}
+
+// -----------------------------------------------------------------------------
+// CRollbackSession
+// -----------------------------------------------------------------------------
+
+CRollbackSession::CRollbackSession(CVersusGame& game, int localPlayer, CTransport& transport, int inputDelay)
+    : m_game(game), m_transport(transport)
+{
+    m_local = localPlayer != 0 ? 1 : 0;
+    m_inputDelay = inputDelay < 0 ? 0 : inputDelay > MAX_INPUT_DELAY ? MAX_INPUT_DELAY : inputDelay;
+
+    m_game.reset();
+    m_tick = 0;
+    m_remoteLast = -1;
+    m_remoteAcked = -1;
+    m_rollbackTo = 0;
+    for (int i = 0; i < RING_SIZE; i++) {
+        m_localInputs[i] = NO_INPUT;
+        m_remoteInputs[i] = NO_INPUT;
+        m_predicted[i] = NO_INPUT;
+        m_checksums[i] = 0;
+    }
+
+    // the ticks before the first delayed input are played without input,
+    // and are sent like any other input
+    m_localLast = m_inputDelay - 1;
+
+    m_confirmedTick = -1;
+    m_remoteChecksumTick = -1;
+    m_remoteChecksum = 0;
+
+    m_stats.rollbacks = 0;
+    m_stats.maxDepth = 0;
+    m_stats.resimulatedTicks = 0;
+    m_stats.resimulateMs = 0;
+    m_stats.stalls = 0;
+    m_stats.desyncTick = -1;
+}
+
+bool CRollbackSession::advance(const VersusInput& local)
+{
+    receivePackets();
+    if (m_rollbackTo < m_tick)
+        rollback(m_rollbackTo);
+
+    bool stalled = m_tick > m_remoteLast + MAX_PREDICTION;
+    if (stalled) {
+        m_stats.stalls++;
+    }
+    else {
+        m_localLast++;
+        m_localInputs[slot(m_localLast)] = local;
+        simulate();
+    }
+
+    checkConfirmed();
+    sendInputs();
+    return !stalled;
+}
+
+VersusInput CRollbackSession::remoteInput(int tick) const
+{
+    if (tick <= m_remoteLast)
+        return m_remoteInputs[slot(tick)];
+
+    // keep moving the way the player last moved, but never guess a button press
+    VersusInput guess = m_remoteLast >= 0 ? m_remoteInputs[slot(m_remoteLast)] : NO_INPUT;
+    guess.buttons = 0;
+    return guess;
+}
+
+void CRollbackSession::receivePackets(void)
+{
+    m_rollbackTo = m_tick;
+
+    RollbackPacket packet;
+    int size;
+    while ((size = m_transport.receive(&packet, sizeof(packet))) > 0) {
+        if (size < PACKET_HEADER || packet.inputCount < 0 || packet.inputCount > RING_SIZE
+            || size != PACKET_HEADER + packet.inputCount * (int)sizeof(VersusInput))
+            continue;
+
+        if (packet.ackTick > m_remoteAcked)
+            m_remoteAcked = packet.ackTick;
+
+        for (int i = 0; i < packet.inputCount; i++) {
+            int tick = packet.firstTick + i;
+            // only the next missing input, so the remote inputs have no gaps
+            if (tick != m_remoteLast + 1 || tick - m_tick >= RING_SIZE / 2)
+                continue;
+            m_remoteInputs[slot(tick)] = packet.inputs[i];
+            m_remoteLast = tick;
+            if (tick < m_rollbackTo && packet.inputs[i] != m_predicted[slot(tick)])
+                m_rollbackTo = tick;
+        }
+
+        // one remote checksum at a time, kept until our own state catches up
+        if (packet.checksumTick >= 0 && m_remoteChecksumTick < 0) {
+            m_remoteChecksumTick = packet.checksumTick;
+            m_remoteChecksum = packet.checksum;
+        }
+    }
+}
+
+// go back to the start of 'tick' and simulate up to the current tick again
+void CRollbackSession::rollback(int tick)
+{
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    int end = m_tick;
+    m_game.load(m_states[slot(tick)]);
+    m_tick = tick;
+    while (m_tick < end)
+        simulate();
+
+    int depth = end - tick;
+    m_stats.rollbacks++;
+    m_stats.resimulatedTicks += depth;
+    if (depth > m_stats.maxDepth)
+        m_stats.maxDepth = depth;
+    m_stats.resimulateMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void CRollbackSession::simulate(void)
+{
+    int s = slot(m_tick);
+    m_game.save(m_states[s]);
+    m_checksums[s] = versusChecksum(m_states[s]);
+
+    VersusInput inputs[2];
+    inputs[m_local] = m_localInputs[s];
+    inputs[1 - m_local] = m_predicted[s] = remoteInput(m_tick);
+    m_game.step(inputs);
+    m_tick++;
+}
+
+void CRollbackSession::checkConfirmed(void)
+{
+    // the newest saved state that only depends on real inputs
+    m_confirmedTick = m_remoteLast + 1 < m_tick - 1 ? m_remoteLast + 1 : m_tick - 1;
+
+    if (m_remoteChecksumTick < 0 || m_remoteChecksumTick > m_confirmedTick)
+        return;
+    if (m_tick - 1 - m_remoteChecksumTick < RING_SIZE
+        && m_checksums[slot(m_remoteChecksumTick)] != m_remoteChecksum && m_stats.desyncTick < 0)
+        m_stats.desyncTick = m_remoteChecksumTick;
+    m_remoteChecksumTick = -1;
+}
+
+void CRollbackSession::sendInputs(void)
+{
+    RollbackPacket packet;
+    int count = m_localLast - m_remoteAcked;
+    if (count > RING_SIZE)
+        count = RING_SIZE;
+
+    packet.firstTick = m_remoteAcked + 1;
+    packet.inputCount = count;
+    packet.ackTick = m_remoteLast;
+    packet.checksumTick = m_confirmedTick;
+    packet.checksum = getConfirmedChecksum();
+    for (int i = 0; i < count; i++)
+        packet.inputs[i] = m_localInputs[slot(packet.firstTick + i)];
+
+    m_transport.send(&packet, PACKET_HEADER + count * (int)sizeof(VersusInput));
+}
@@ -0,0 +1,173 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: rollback.h
+//
+// Desc: Rollback netcode for CVersusGame. Each peer runs the whole game and
+//       never waits for the other player's input : a missing remote input is
+//       predicted (the last one that arrived, without buttons) and the tick is
+//       simulated at once. Every tick's starting state is kept in a ring; when
+//       the real input turns out different from the prediction, the game is
+//       put back to that tick and the ticks since are simulated again with
+//       the corrected inputs, all within the current frame.
+//
+//       Local input is scheduled 'inputDelay' ticks ahead, which hides that
+//       much latency without any rollback. A peer that gets more than
+//       MAX_PREDICTION ticks ahead of the last confirmed remote input stalls
+//       instead of predicting further.
+//
+//       Packets are unreliable : each one repeats every local input the peer
+//       has not acknowledged yet, so a lost or late packet is covered by the
+//       next one. Packets also carry the checksum of the newest state both
+//       peers agree on, which detects a desync (e.g. different physics.cfg).
+//
+//       Peers must run the same build : the simulation is plain float math
+//       and is only the same bit for bit with the same code and settings.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __rollbackH__
+#define __rollbackH__
+
+#include "versusGame.h"
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Transports
+// -----------------------------------------------------------------------------
+
+// unreliable datagrams : packets may be lost, late or out of order
+class CTransport {
+public:
+    virtual ~CTransport(void) {}
+
+    virtual void send(const void* data, int size) = 0;
+    // copies the next waiting packet into data and returns its size, 0 : nothing waiting
+    virtual int receive(void* data, int capacity) = 0;
+};
+
+// two transports joined in memory, for testing : every packet is held back
+// 'delayTicks' plus a random 0..jitterTicks ticks of the link and dropped with
+// probability 'loss'. the random numbers come from 'seed', so a run repeats
+class CLoopbackLink {
+public:
+    CLoopbackLink(int delayTicks = 0, int jitterTicks = 0, float loss = 0.0f, unsigned seed = 1);
+
+    CTransport& getEnd(int side) { return m_ends[side]; }
+
+    // the link's clock : call once per game tick
+    void tick(void) { m_now++; }
+
+    int getSentCount(void) const { return m_sent; }
+    int getLostCount(void) const { return m_lost; }
+
+private:
+    CLoopbackLink(const CLoopbackLink&);
+    CLoopbackLink& operator=(const CLoopbackLink&);
+
+    struct Packet
+    {
+        int                         due;
+        std::vector<unsigned char>  data;
+    };
+
+    class End : public CTransport {
+    public:
+        virtual void send(const void* data, int size);
+        virtual int receive(void* data, int capacity);
+
+        CLoopbackLink*      link;
+        std::vector<Packet> inbox;      // packets on their way to this end
+        End*                peer;
+    };
+
+    unsigned nextRandom(void);
+
+    End         m_ends[2];
+    int         m_delay, m_jitter;
+    float       m_loss;
+    unsigned    m_random;
+    int         m_now;
+    int         m_sent, m_lost;
+};
+
+// -----------------------------------------------------------------------------
+// Rollback session
+// -----------------------------------------------------------------------------
+
+struct RollbackStats
+{
+    int     rollbacks;          // mispredictions that sent the game back
+    int     maxDepth;           // most ticks simulated again in one rollback
+    int     resimulatedTicks;
+    double  resimulateMs;       // time spent loading states and simulating again
+    int     stalls;             // advance() calls that waited for the remote peer
+    int     desyncTick;         // first tick whose checksums differed, -1 : none
+};
+
+class CRollbackSession {
+public:
+    enum {
+        RING_SIZE       = 64,   // saved ticks, a power of two
+        MAX_PREDICTION  = 12,   // ticks a peer may run ahead of the remote input
+        MAX_INPUT_DELAY = 8
+    };
+
+    // game is driven by this session from now on and starts from reset().
+    // localPlayer : 0 or 1, the other peer must use the other one
+    CRollbackSession(CVersusGame& game, int localPlayer, CTransport& transport, int inputDelay = 2);
+
+    // one tick with the local player's input : reads packets, rolls back if
+    // needed, simulates the tick and sends the local inputs. returns false
+    // when the peer is too far behind; then nothing was simulated and the
+    // same input should be given again next frame
+    bool advance(const VersusInput& local);
+
+    // the next tick to be simulated
+    int getTick(void) const { return m_tick; }
+    // newest saved tick whose state only depends on real inputs of both
+    // players (-1 : none yet), and its checksum as sent to the remote peer
+    int getConfirmedTick(void) const { return m_confirmedTick; }
+    unsigned getConfirmedChecksum(void) const { return m_confirmedTick >= 0 ? m_checksums[slot(m_confirmedTick)] : 0; }
+
+    bool isDesynced(void) const { return m_stats.desyncTick >= 0; }
+    const RollbackStats& getStats(void) const { return m_stats; }
+
+private:
+    CRollbackSession(const CRollbackSession&);
+    CRollbackSession& operator=(const CRollbackSession&);
+
+    // slot of a tick in the rings
+    static int slot(int tick) { return tick & (RING_SIZE - 1); }
+
+    void receivePackets(void);
+    void rollback(int tick);
+    void simulate(void);
+    void checkConfirmed(void);
+    void sendInputs(void);
+    VersusInput remoteInput(int tick) const;
+
+    CVersusGame&    m_game;
+    CTransport&     m_transport;
+    int             m_local;
+    int             m_inputDelay;
+
+    int             m_tick;
+    int             m_localLast;        // newest tick with a local input
+    int             m_remoteLast;       // every remote input up to this tick arrived
+    int             m_remoteAcked;      // the remote peer has our inputs up to this tick
+    int             m_rollbackTo;       // earliest mispredicted tick, or m_tick
+
+    VersusInput     m_localInputs[RING_SIZE];
+    VersusInput     m_remoteInputs[RING_SIZE];
+    VersusInput     m_predicted[RING_SIZE];     // remote input each simulated tick used
+    VersusState     m_states[RING_SIZE];        // state at the start of each tick
+    unsigned        m_checksums[RING_SIZE];     // of m_states
+
+    int             m_confirmedTick;            // newest state both peers agree on
+    int             m_remoteChecksumTick;       // and the remote peer's newest, -1 : none yet
+    unsigned        m_remoteChecksum;
+
+    RollbackStats   m_stats;
+};
+
+#endif // __rollbackH__
@@ -0,0 +1,52 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: sessionScheduler.cpp
+//
+// Desc: Steps many CGameSession objects per tick on a CWorkerPool.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "sessionScheduler.h"
+
+// sessions handed out per grab. one stock session steps in well under a
+// microsecond, so chunks keep the atomic counter off the hot path
+const int SESSION_CHUNK = 64;
+
+CSessionScheduler::CSessionScheduler(int threadCount)
+    : m_pool(threadCount)
+{
+    m_timeDelta = 0;
+}
+
+CSessionScheduler::~CSessionScheduler(void)
+{
+}
+
+int CSessionScheduler::addSession(void)
+{
+    m_sessions.push_back(CGameSession());
+    return (int)m_sessions.size() - 1;
+}
+
+void CSessionScheduler::clear(void)
+{
+    m_sessions.clear();
+}
+
+void CSessionScheduler::tick(float timeDelta)
+{
+    if (m_sessions.empty())
+        return;
+
+    int workers = m_pool.getThreadCount();
+    int perWorker = ((int)m_sessions.size() + workers - 1) / workers;
+    m_timeDelta = timeDelta;
+    m_pool.run((int)m_sessions.size(), perWorker < SESSION_CHUNK ? perWorker : SESSION_CHUNK, stepSessions, this);
+}
+
+void CSessionScheduler::stepSessions(int begin, int end, void* user)
+{
+    CSessionScheduler* scheduler = (CSessionScheduler*)user;
+    for (int i = begin; i < end; i++)
+        scheduler->m_sessions[i].step(scheduler->m_timeDelta);
+}
@@ -0,0 +1,47 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: sessionScheduler.h
+//
+// Desc: Ticks many headless CGameSession objects per process on a pool of
+//       worker threads (CWorkerPool). Sessions are independent, so a tick
+//       just hands out contiguous chunks of the session array to whichever
+//       thread is free.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __sessionSchedulerH__
+#define __sessionSchedulerH__
+
+#include "gameSession.h"
+#include "workerPool.h"
+#include <vector>
+
+class CSessionScheduler {
+public:
+    // threadCount <= 0 picks one thread per hardware core
+    explicit CSessionScheduler(int threadCount = 0);
+    ~CSessionScheduler(void);
+
+    // returns the index of the new session. not safe to call during tick()
+    int addSession(void);
+    void clear(void);
+
+    CGameSession& getSession(int i) { return m_sessions[i]; }
+    int getSessionCount(void) const { return (int)m_sessions.size(); }
+
+    // step every session once. the calling thread works too and returns
+    // when all sessions have been advanced
+    void tick(float timeDelta);
+
+private:
+    CSessionScheduler(const CSessionScheduler&);
+    CSessionScheduler& operator=(const CSessionScheduler&);
+
+    static void stepSessions(int begin, int end, void* user);
+
+    std::vector<CGameSession>   m_sessions;
+    CWorkerPool                 m_pool;
+    float                       m_timeDelta;
+};
+
+#endif // __sessionSchedulerH__
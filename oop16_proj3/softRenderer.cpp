@@ -0,0 +1,516 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: softRenderer.cpp
+//
+// Desc: Tile-based CPU rasterizer with analytic sphere impostors.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "softRenderer.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+const SoftMaterial SOFT_BRICK_MTRL = { 1.0f, 1.0f, 0.0f, 5.0f };    // d3d::YELLOW
+const SoftMaterial SOFT_RED_MTRL   = { 1.0f, 0.0f, 0.0f, 5.0f };    // d3d::RED
+const SoftMaterial SOFT_WHITE_MTRL = { 1.0f, 1.0f, 1.0f, 5.0f };    // d3d::WHITE
+
+static const SoftMaterial TABLE_MTRL = { 0.0f, 1.0f, 0.0f, 5.0f };              // d3d::GREEN
+static const SoftMaterial WALL_MTRL  = { 215.0f / 255.0f, 0.0f, 0.0f, 5.0f };  // d3d::DARKRED
+static const SoftMaterial LIGHT_MTRL = { 1.0f, 1.0f, 1.0f, 2.0f };              // d3d::WHITE_MTRL
+
+static float dot3(const float a[3], const float b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void normalize3(float v[3])
+{
+    float len = sqrt(dot3(v, v));
+    if (len > 0.0f) {
+        v[0] /= len;
+        v[1] /= len;
+        v[2] /= len;
+    }
+}
+
+static void cross3(const float a[3], const float b[3], float out[3])
+{
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static unsigned char toByte(float c)
+{
+    return (unsigned char)(c >= 1.0f ? 255 : c <= 0.0f ? 0 : (int)(c * 255.0f + 0.5f));
+}
+
+// -----------------------------------------------------------------------------
+// CSoftRenderer
+// -----------------------------------------------------------------------------
+
+CSoftRenderer::CSoftRenderer(int width, int height, int threadCount)
+    : m_pool(threadCount)
+{
+    m_width = width > 0 ? width : 1;
+    m_height = height > 0 ? height : 1;
+    m_tilesX = (m_width + TILE_SIZE - 1) / TILE_SIZE;
+    m_tilesY = (m_height + TILE_SIZE - 1) / TILE_SIZE;
+    m_bins.resize(m_tilesX * m_tilesY);
+    m_pixels.assign(m_width * m_height * 3, 0);
+    m_depth.assign(m_width * m_height, 0.0f);
+
+    // light and camera of Setup(). the camera places the light in view space
+    SoftLight light = { 0.0f, 3.0f, 0.0f, 0.9f, 1.0f, 0.9f, 0.0f, 0.9f, 0.0f, 100.0f };
+    m_light = light;
+    const float eye[3] = { 0.0f, 15.0f, 0.0f };
+    const float target[3] = { 0.0f, 0.0f, 0.0f };
+    const float up[3] = { 0.0f, 0.0f, -1.0f };
+    setCamera(eye, target, up, (float)(PI / 4), 1.0f, 100.0f);
+    setClearColor(0xaf, 0xaf, 0xaf);
+}
+
+CSoftRenderer::~CSoftRenderer(void)
+{
+}
+
+void CSoftRenderer::setCamera(const float eye[3], const float target[3], const float up[3], float fovY, float zNear, float zFar)
+{
+    // D3DXMatrixLookAtLH
+    for (int i = 0; i < 3; i++) {
+        m_eye[i] = eye[i];
+        m_axisZ[i] = target[i] - eye[i];
+    }
+    normalize3(m_axisZ);
+    cross3(up, m_axisZ, m_axisX);
+    normalize3(m_axisX);
+    cross3(m_axisZ, m_axisX, m_axisY);
+
+    // D3DXMatrixPerspectiveFovLH
+    m_yScale = 1.0f / tan(fovY / 2);
+    m_xScale = m_yScale / ((float)m_width / (float)m_height);
+    m_near = zNear;
+    m_far = zFar;
+
+    setLight(m_light);
+}
+
+void CSoftRenderer::setLight(const SoftLight& light)
+{
+    m_light = light;
+    float p[3] = { light.x, light.y, light.z };
+    toView(p, m_lightView);
+}
+
+void CSoftRenderer::setClearColor(unsigned char r, unsigned char g, unsigned char b)
+{
+    m_clear[0] = r;
+    m_clear[1] = g;
+    m_clear[2] = b;
+}
+
+void CSoftRenderer::toView(const float p[3], float out[3]) const
+{
+    float d[3] = { p[0] - m_eye[0], p[1] - m_eye[1], p[2] - m_eye[2] };
+    out[0] = dot3(d, m_axisX);
+    out[1] = dot3(d, m_axisY);
+    out[2] = dot3(d, m_axisZ);
+}
+
+// fixed-function lighting of a point p (view space) with unit normal n
+void CSoftRenderer::shade(const float p[3], const float n[3], const SoftMaterial& mtrl, float color[3]) const
+{
+    float l[3] = { m_lightView[0] - p[0], m_lightView[1] - p[1], m_lightView[2] - p[2] };
+    float distance = sqrt(dot3(l, l));
+    if (distance > m_light.range) {
+        color[0] = color[1] = color[2] = 0.0f;
+        return;
+    }
+    float atten = 1.0f / (m_light.att0 + m_light.att1 * distance + m_light.att2 * distance * distance);
+    if (distance > 0.0f) {
+        l[0] /= distance;
+        l[1] /= distance;
+        l[2] /= distance;
+    }
+
+    float intensity = m_light.ambient;
+    float ndl = dot3(n, l);
+    float specular = 0.0f;
+    if (ndl > 0.0f) {
+        intensity += m_light.diffuse * ndl;
+
+        // half vector with a local viewer (eye at the view space origin)
+        float v[3] = { -p[0], -p[1], -p[2] };
+        normalize3(v);
+        float h[3] = { l[0] + v[0], l[1] + v[1], l[2] + v[2] };
+        normalize3(h);
+        float ndh = dot3(n, h);
+        if (ndh > 0.0f)
+            specular = m_light.specular * pow(ndh, mtrl.power);
+    }
+
+    float k = (intensity + specular) * atten;
+    color[0] = std::min(mtrl.r * k, 1.0f);
+    color[1] = std::min(mtrl.g * k, 1.0f);
+    color[2] = std::min(mtrl.b * k, 1.0f);
+}
+
+void CSoftRenderer::beginFrame(void)
+{
+    m_triangles.clear();
+    m_spheres.clear();
+    for (size_t i = 0; i < m_bins.size(); i++)
+        m_bins[i].clear();
+}
+
+void CSoftRenderer::bin(int index, int minX, int minY, int maxX, int maxY)
+{
+    int tx0 = std::max(minX, 0) / TILE_SIZE;
+    int ty0 = std::max(minY, 0) / TILE_SIZE;
+    int tx1 = std::min(maxX, m_width - 1) / TILE_SIZE;
+    int ty1 = std::min(maxY, m_height - 1) / TILE_SIZE;
+    for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++)
+            m_bins[ty * m_tilesX + tx].push_back(index);
+    }
+}
+
+// box like D3DXCreateBox, placed like CWall::setPosition : yaw about y, then moved.
+// each face is lit at its four corners and back faces are dropped
+void CSoftRenderer::addBox(float x, float y, float z, float width, float height, float depth, float yaw, const SoftMaterial& mtrl)
+{
+    static const float faces[6][3] = {
+        { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 }
+    };
+    float half[3] = { width / 2, height / 2, depth / 2 };
+    float c = cos(yaw);
+    float s = sin(yaw);
+
+    for (int f = 0; f < 6; f++) {
+        const float* n = faces[f];
+        int axis = n[0] != 0 ? 0 : n[1] != 0 ? 1 : 2;
+        int u = (axis + 1) % 3;
+        int v = (axis + 2) % 3;
+
+        // D3DXMatrixRotationY on the normal
+        float worldN[3] = { n[0] * c + n[2] * s, n[1], -n[0] * s + n[2] * c };
+        float viewN[3] = { dot3(worldN, m_axisX), dot3(worldN, m_axisY), dot3(worldN, m_axisZ) };
+
+        Vertex corners[4];
+        static const float signs[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+        for (int k = 0; k < 4; k++) {
+            float local[3];
+            local[axis] = n[axis] * half[axis];
+            local[u] = signs[k][0] * half[u];
+            local[v] = signs[k][1] * half[v];
+            float world[3] = {
+                x + local[0] * c + local[2] * s,
+                y + local[1],
+                z - local[0] * s + local[2] * c };
+
+            float p[3];
+            toView(world, p);
+            float color[3];
+            shade(p, viewN, mtrl, color);
+            Vertex vtx = { p[0], p[1], p[2], color[0], color[1], color[2] };
+            corners[k] = vtx;
+        }
+
+        // the eye is at the view space origin
+        float p0[3] = { corners[0].x, corners[0].y, corners[0].z };
+        if (dot3(viewN, p0) >= 0.0f)
+            continue;
+
+        addTriangle(corners[0], corners[1], corners[2]);
+        addTriangle(corners[0], corners[2], corners[3]);
+    }
+}
+
+// clip against the near plane, which leaves up to two triangles
+void CSoftRenderer::addTriangle(const Vertex& a, const Vertex& b, const Vertex& c)
+{
+    const Vertex* in[3] = { &a, &b, &c };
+    Vertex out[4];
+    int count = 0;
+
+    for (int i = 0; i < 3; i++) {
+        const Vertex& p = *in[i];
+        const Vertex& q = *in[(i + 1) % 3];
+        bool pIn = p.z >= m_near;
+        bool qIn = q.z >= m_near;
+        if (pIn)
+            out[count++] = p;
+        if (pIn != qIn) {
+            float t = (m_near - p.z) / (q.z - p.z);
+            Vertex m = {
+                p.x + (q.x - p.x) * t, p.y + (q.y - p.y) * t, m_near,
+                p.r + (q.r - p.r) * t, p.g + (q.g - p.g) * t, p.b + (q.b - p.b) * t };
+            out[count++] = m;
+        }
+    }
+
+    if (count >= 3)
+        addClippedTriangle(out);
+    if (count == 4) {
+        Vertex second[3] = { out[0], out[2], out[3] };
+        addClippedTriangle(second);
+    }
+}
+
+void CSoftRenderer::addClippedTriangle(const Vertex* v)
+{
+    Triangle tri;
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+    for (int i = 0; i < 3; i++) {
+        float iz = 1.0f / v[i].z;
+        tri.x[i] = (v[i].x * iz * m_xScale + 1.0f) * 0.5f * m_width;
+        tri.y[i] = (1.0f - v[i].y * iz * m_yScale) * 0.5f * m_height;
+        tri.z[i] = iz;
+        tri.r[i] = v[i].r * iz;
+        tri.g[i] = v[i].g * iz;
+        tri.b[i] = v[i].b * iz;
+        minX = std::min(minX, tri.x[i]);
+        minY = std::min(minY, tri.y[i]);
+        maxX = std::max(maxX, tri.x[i]);
+        maxY = std::max(maxY, tri.y[i]);
+    }
+
+    if (maxX < 0.0f || maxY < 0.0f || minX >= m_width || minY >= m_height)
+        return;
+    tri.minX = std::max((int)floor(minX), 0);
+    tri.minY = std::max((int)floor(minY), 0);
+    tri.maxX = std::min((int)ceil(maxX), m_width - 1);
+    tri.maxY = std::min((int)ceil(maxY), m_height - 1);
+
+    m_triangles.push_back(tri);
+    bin((int)m_triangles.size() - 1, tri.minX, tri.minY, tri.maxX, tri.maxY);
+}
+
+void CSoftRenderer::addSphere(float x, float y, float z, float radius, const SoftMaterial& mtrl)
+{
+    float world[3] = { x, y, z };
+    Sphere s;
+    float c[3];
+    toView(world, c);
+    s.cx = c[0];
+    s.cy = c[1];
+    s.cz = c[2];
+    s.radius = radius;
+    s.mtrl = mtrl;
+
+    // spheres crossing the near plane are left out
+    if (s.cz - radius < m_near)
+        return;
+
+    // exact screen extent : the planes through the eye tangent to the sphere
+    float r2 = radius * radius;
+    float den = s.cz * s.cz - r2;
+    float ex = radius * sqrt(s.cx * s.cx + den);
+    float ey = radius * sqrt(s.cy * s.cy + den);
+    float x0 = (s.cx * s.cz - ex) / den, x1 = (s.cx * s.cz + ex) / den;
+    float y0 = (s.cy * s.cz - ey) / den, y1 = (s.cy * s.cz + ey) / den;
+
+    float minX = (x0 * m_xScale + 1.0f) * 0.5f * m_width;
+    float maxX = (x1 * m_xScale + 1.0f) * 0.5f * m_width;
+    float minY = (1.0f - y1 * m_yScale) * 0.5f * m_height;
+    float maxY = (1.0f - y0 * m_yScale) * 0.5f * m_height;
+    if (maxX < 0.0f || maxY < 0.0f || minX >= m_width || minY >= m_height)
+        return;
+
+    s.minX = std::max((int)floor(minX), 0);
+    s.minY = std::max((int)floor(minY), 0);
+    s.maxX = std::min((int)ceil(maxX), m_width - 1);
+    s.maxY = std::min((int)ceil(maxY), m_height - 1);
+
+    m_spheres.push_back(s);
+    bin(~((int)m_spheres.size() - 1), s.minX, s.minY, s.maxX, s.maxY);
+}
+
+void CSoftRenderer::render(void)
+{
+    m_pool.run((int)m_bins.size(), 1, renderTiles, this);
+}
+
+void CSoftRenderer::renderTiles(int begin, int end, void* user)
+{
+    CSoftRenderer* renderer = (CSoftRenderer*)user;
+    for (int tile = begin; tile < end; tile++)
+        renderer->renderTile(tile);
+}
+
+void CSoftRenderer::renderTile(int tile)
+{
+    int x0 = (tile % m_tilesX) * TILE_SIZE;
+    int y0 = (tile / m_tilesX) * TILE_SIZE;
+    int x1 = std::min(x0 + TILE_SIZE, m_width);
+    int y1 = std::min(y0 + TILE_SIZE, m_height);
+
+    for (int y = y0; y < y1; y++) {
+        unsigned char* row = &m_pixels[(y * m_width + x0) * 3];
+        for (int x = 0; x < x1 - x0; x++) {
+            row[x * 3 + 0] = m_clear[0];
+            row[x * 3 + 1] = m_clear[1];
+            row[x * 3 + 2] = m_clear[2];
+        }
+        memset(&m_depth[y * m_width + x0], 0, (x1 - x0) * sizeof(float));
+    }
+
+    const std::vector<int>& prims = m_bins[tile];
+    for (size_t i = 0; i < prims.size(); i++) {
+        if (prims[i] >= 0)
+            drawTriangle(m_triangles[prims[i]], x0, y0, x1, y1);
+        else
+            drawSphere(m_spheres[~prims[i]], x0, y0, x1, y1);
+    }
+}
+
+// edge functions over the pixel centers of the triangle's rectangle inside
+// the tile. depth and the colors are interpolated as 1 / z and color / z
+void CSoftRenderer::drawTriangle(const Triangle& tri, int x0, int y0, int x1, int y1)
+{
+    int minX = std::max(tri.minX, x0), maxX = std::min(tri.maxX, x1 - 1);
+    int minY = std::max(tri.minY, y0), maxY = std::min(tri.maxY, y1 - 1);
+    if (minX > maxX || minY > maxY)
+        return;
+
+    float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.y[1] - tri.y[0]) * (tri.x[2] - tri.x[0]);
+    if (area == 0.0f)
+        return;
+    float inv = 1.0f / area;
+
+    // w_i(x, y) = a_i * x + b_i * y + c_i, already divided by the area
+    float a[3], b[3], c[3];
+    for (int i = 0; i < 3; i++) {
+        int j = (i + 1) % 3, k = (i + 2) % 3;
+        a[i] = (tri.y[j] - tri.y[k]) * inv;
+        b[i] = (tri.x[k] - tri.x[j]) * inv;
+        c[i] = (tri.x[j] * tri.y[k] - tri.x[k] * tri.y[j]) * inv;
+    }
+
+    for (int y = minY; y <= maxY; y++) {
+        float py = y + 0.5f;
+        float px = minX + 0.5f;
+        float w0 = a[0] * px + b[0] * py + c[0];
+        float w1 = a[1] * px + b[1] * py + c[1];
+        float w2 = a[2] * px + b[2] * py + c[2];
+
+        float* depth = &m_depth[y * m_width];
+        unsigned char* row = &m_pixels[y * m_width * 3];
+        for (int x = minX; x <= maxX; x++, w0 += a[0], w1 += a[1], w2 += a[2]) {
+            if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                continue;
+            float iz = w0 * tri.z[0] + w1 * tri.z[1] + w2 * tri.z[2];
+            if (iz <= depth[x])
+                continue;
+            depth[x] = iz;
+            float z = 1.0f / iz;
+            row[x * 3 + 0] = toByte((w0 * tri.r[0] + w1 * tri.r[1] + w2 * tri.r[2]) * z);
+            row[x * 3 + 1] = toByte((w0 * tri.g[0] + w1 * tri.g[1] + w2 * tri.g[2]) * z);
+            row[x * 3 + 2] = toByte((w0 * tri.b[0] + w1 * tri.b[1] + w2 * tri.b[2]) * z);
+        }
+    }
+}
+
+// one ray per pixel against the exact sphere
+void CSoftRenderer::drawSphere(const Sphere& s, int x0, int y0, int x1, int y1)
+{
+    int minX = std::max(s.minX, x0), maxX = std::min(s.maxX, x1 - 1);
+    int minY = std::max(s.minY, y0), maxY = std::min(s.maxY, y1 - 1);
+    if (minX > maxX || minY > maxY)
+        return;
+
+    float c[3] = { s.cx, s.cy, s.cz };
+    float cc = dot3(c, c) - s.radius * s.radius;
+    float invRadius = 1.0f / s.radius;
+    float stepX = 2.0f / (m_width * m_xScale);
+    float stepY = 2.0f / (m_height * m_yScale);
+
+    for (int y = minY; y <= maxY; y++) {
+        float* depth = &m_depth[y * m_width];
+        unsigned char* row = &m_pixels[y * m_width * 3];
+        float dy = 1.0f / m_yScale - (y + 0.5f) * stepY;
+
+        for (int x = minX; x <= maxX; x++) {
+            float d[3] = { (x + 0.5f) * stepX - 1.0f / m_xScale, dy, 1.0f };
+            float b = dot3(d, c);
+            float a = dot3(d, d);
+            float disc = b * b - a * cc;
+            if (disc < 0.0f)
+                continue;
+            float t = (b - sqrt(disc)) / a;
+            float iz = 1.0f / t;
+            if (iz <= depth[x])
+                continue;
+            depth[x] = iz;
+
+            float p[3] = { d[0] * t, d[1] * t, t };
+            float n[3] = { (p[0] - c[0]) * invRadius, (p[1] - c[1]) * invRadius, (p[2] - c[2]) * invRadius };
+            float color[3];
+            shade(p, n, s.mtrl, color);
+            row[x * 3 + 0] = toByte(color[0]);
+            row[x * 3 + 1] = toByte(color[1]);
+            row[x * 3 + 2] = toByte(color[2]);
+        }
+    }
+}
+
+bool CSoftRenderer::writePPM(const char* path) const
+{
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL)
+        return false;
+    fprintf(fp, "P6\n%d %d\n255\n", m_width, m_height);
+    bool ok = writeRaw(fp);
+    if (fclose(fp) != 0)
+        ok = false;
+    return ok;
+}
+
+bool CSoftRenderer::writeRaw(FILE* fp) const
+{
+    return fwrite(&m_pixels[0], 1, m_pixels.size(), fp) == m_pixels.size();
+}
+
+// -----------------------------------------------------------------------------
+// Scene of the window app
+// -----------------------------------------------------------------------------
+
+void addTableScene(CSoftRenderer& renderer, const CGameSession& session)
+{
+    // plane, as in buildScene()
+    if (session.hasCustomBoundary()) {
+        float minX, minZ, maxX, maxZ;
+        session.getBoundary().getBounds(&minX, &minZ, &maxX, &maxZ);
+        renderer.addBox((minX + maxX) / 2, -0.0006f / 5, (minZ + maxZ) / 2, maxX - minX, 0.03f, maxZ - minZ, 0.0f, TABLE_MTRL);
+    }
+    else {
+        renderer.addBox(0.0f, -0.0006f / 5, 0.0f, 6, 0.03f, 9, 0.0f, TABLE_MTRL);
+    }
+
+    // visible walls : custom segments or the stock walls, deadly ones stay invisible
+    if (session.hasCustomBoundary()) {
+        const CBoundaryBVH& boundary = session.getBoundary();
+        for (int i = 0; i < boundary.getSegmentCount(); i++) {
+            const Segment& seg = boundary.getSegment(i);
+            if (seg.flags & SEGMENT_DEADLY)
+                continue;
+            float dx = seg.x1 - seg.x0;
+            float dz = seg.z1 - seg.z0;
+            renderer.addBox((seg.x0 + seg.x1) / 2, 0.12f, (seg.z0 + seg.z1) / 2,
+                sqrt(dx * dx + dz * dz), 0.3f, 0.12f, atan2(-dz, dx), WALL_MTRL);
+        }
+    }
+    else {
+        for (int i = 0; i < WALL_COUNT; i++) {
+            if (session.isDeadlyWall(i))
+                continue;
+            const WallState& wall = session.getWall(i);
+            renderer.addBox(wall.x, 0.12f, wall.z, wall.width, 0.3f, wall.depth, 0.0f, WALL_MTRL);
+        }
+    }
+
+    // the light marker of CLight::draw
+    const SoftLight& light = renderer.getLight();
+    renderer.addSphere(light.x, light.y, light.z, 0.1f, LIGHT_MTRL);
+}
@@ -0,0 +1,149 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: softRenderer.h
+//
+// Desc: CPU renderer for machines without a GPU (replay videos, thumbnails).
+//       It draws the same scene as the window app - boxes for the table and
+//       walls, spheres for the balls - lit by one point light with the
+//       Direct3D fixed-function formula (ambient + diffuse + specular, each
+//       scaled by 1 / (att0 + att1 * d + att2 * d^2)).
+//
+//       Boxes are split into triangles and lit per vertex like the device
+//       path. Spheres are not meshes: every pixel of a sphere's screen
+//       rectangle casts a ray against the exact sphere, which gives the
+//       depth and normal for per-pixel lighting.
+//
+//       The frame is cut into 64 x 64 tiles. Primitives are binned by their
+//       screen rectangle, then a CWorkerPool takes tiles one by one and
+//       clears, rasterizes and shades each tile on its own, so no two
+//       threads ever write the same pixel.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __softRendererH__
+#define __softRendererH__
+
+#include "gameSession.h"
+#include "workerPool.h"
+#include <vector>
+#include <cstdio>
+
+// ambient, diffuse and specular all use the color, like CSphere / CWall
+struct SoftMaterial
+{
+    float r, g, b;
+    float power;        // specular exponent
+};
+
+// white point light
+struct SoftLight
+{
+    float x, y, z;
+    float ambient, diffuse, specular;
+    float att0, att1, att2;
+    float range;
+};
+
+class CSoftRenderer {
+public:
+    enum { TILE_SIZE = 64 };
+
+    // threadCount <= 0 picks one thread per hardware core
+    CSoftRenderer(int width, int height, int threadCount = 0);
+    ~CSoftRenderer(void);
+
+    int getWidth(void)  const { return m_width; }
+    int getHeight(void) const { return m_height; }
+
+    // left-handed look-at camera and perspective projection, as in Setup().
+    // the defaults are the app's camera and light
+    void setCamera(const float eye[3], const float target[3], const float up[3], float fovY, float zNear, float zFar);
+    void setLight(const SoftLight& light);
+    const SoftLight& getLight(void) const { return m_light; }
+    void setClearColor(unsigned char r, unsigned char g, unsigned char b);
+
+    // collect the primitives of one frame, then draw them
+    void beginFrame(void);
+    void addBox(float x, float y, float z, float width, float height, float depth, float yaw, const SoftMaterial& mtrl);
+    void addSphere(float x, float y, float z, float radius, const SoftMaterial& mtrl);
+    void render(void);
+
+    // width * height RGB triples, top row first
+    const unsigned char* getPixels(void) const { return &m_pixels[0]; }
+
+    // one binary PPM image, or one raw RGB24 frame (e.g. piped into a video encoder)
+    bool writePPM(const char* path) const;
+    bool writeRaw(FILE* fp) const;
+
+private:
+    CSoftRenderer(const CSoftRenderer&);
+    CSoftRenderer& operator=(const CSoftRenderer&);
+
+    // screen-space triangle with per-vertex lit colors. z holds 1 / view depth,
+    // which is linear in screen space; the colors are stored divided by depth
+    struct Triangle
+    {
+        float x[3], y[3], z[3];
+        float r[3], g[3], b[3];
+        int   minX, minY, maxX, maxY;
+    };
+
+    // sphere in view space
+    struct Sphere
+    {
+        float cx, cy, cz, radius;
+        SoftMaterial mtrl;
+        int   minX, minY, maxX, maxY;
+    };
+
+    struct Vertex
+    {
+        float x, y, z;      // view space
+        float r, g, b;
+    };
+
+    void toView(const float p[3], float out[3]) const;
+    void shade(const float p[3], const float n[3], const SoftMaterial& mtrl, float color[3]) const;
+    void addTriangle(const Vertex& a, const Vertex& b, const Vertex& c);
+    void addClippedTriangle(const Vertex* v);
+    void bin(int index, int minX, int minY, int maxX, int maxY);
+
+    void renderTile(int tile);
+    void drawTriangle(const Triangle& tri, int x0, int y0, int x1, int y1);
+    void drawSphere(const Sphere& sphere, int x0, int y0, int x1, int y1);
+
+    static void renderTiles(int begin, int end, void* user);
+
+    int                     m_width, m_height;
+    int                     m_tilesX, m_tilesY;
+
+    // camera : view basis, and pixel to view-ray scale
+    float                   m_eye[3];
+    float                   m_axisX[3], m_axisY[3], m_axisZ[3];
+    float                   m_xScale, m_yScale;
+    float                   m_near, m_far;
+
+    SoftLight               m_light;
+    float                   m_lightView[3];
+    unsigned char           m_clear[3];
+
+    std::vector<Triangle>           m_triangles;
+    std::vector<Sphere>             m_spheres;
+    std::vector<std::vector<int> >  m_bins;     // per tile : triangle i, or sphere ~i
+
+    std::vector<unsigned char>      m_pixels;
+    std::vector<float>              m_depth;    // 1 / view depth, 0 : nothing drawn
+
+    CWorkerPool                     m_pool;
+};
+
+// the table of 'session' as the window app draws it : plane, visible walls or
+// cushions, and the light marker. balls are left to the caller
+void addTableScene(CSoftRenderer& renderer, const CGameSession& session);
+
+// colors of the window app
+extern const SoftMaterial SOFT_BRICK_MTRL;
+extern const SoftMaterial SOFT_RED_MTRL;
+extern const SoftMaterial SOFT_WHITE_MTRL;
+
+#endif // __softRendererH__
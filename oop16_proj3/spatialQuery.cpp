@@ -0,0 +1,333 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: spatialQuery.cpp
+//
+// Desc: Ball queries over a CBrickGrid and their batches.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "spatialQuery.h"
+#include <cmath>
+
+// queries handed to a worker at a time
+#define QUERY_CHUNK 256
+
+// orders hits by distance, then item, so equal distances come out the same
+// way whatever order the cells were visited in
+static bool hitBefore(float distance, int item, const SpatialHit& hit)
+{
+    return distance < hit.distance || (distance == hit.distance && item < hit.item);
+}
+
+// keeps hits[0 .. *kept) sorted, dropping the last one once maxHits are kept
+static void insertHit(SpatialHit* hits, int maxHits, int* kept, int item, float distance)
+{
+    int n = *kept;
+    if (n == maxHits) {
+        if (maxHits == 0 || !hitBefore(distance, item, hits[n - 1]))
+            return;
+        n--;
+    }
+    int i = n;
+    while (i > 0 && hitBefore(distance, item, hits[i - 1])) {
+        hits[i] = hits[i - 1];
+        i--;
+    }
+    hits[i].item = item;
+    hits[i].distance = distance;
+    *kept = n + 1;
+}
+
+CSpatialIndex::CSpatialIndex(int threadCount)
+    : m_pool(threadCount)
+{
+    m_radius = 0;
+    m_ballBase = 0;
+    m_queries = NULL;
+    m_hits = NULL;
+    m_hitsPerQuery = 0;
+    m_counts = NULL;
+}
+
+CSpatialIndex::~CSpatialIndex(void)
+{
+}
+
+void CSpatialIndex::clear(void)
+{
+    m_grid.clear();
+    m_ballBase = 0;
+}
+
+void CSpatialIndex::build(const float* x, const float* z, const unsigned char* alive, int count, float radius)
+{
+    m_grid.build(x, z, alive, count, radius);
+    m_radius = radius;
+    m_ballBase = count;
+}
+
+void CSpatialIndex::build(const CGameSession& session)
+{
+    int bricks = session.getBrickCount();
+    int count = bricks + BALL_RIVAL + 1;
+    std::vector<float> x(count), z(count);
+    std::vector<unsigned char> alive(count, 1);
+    for (int i = 0; i < bricks; i++) {
+        x[i] = session.getBrick(i).x;
+        z[i] = session.getBrick(i).z;
+        alive[i] = session.isBrickAlive(i) ? 1 : 0;
+    }
+    const BallState* balls[] = { &session.getRedBall(), &session.getWhiteBall(), &session.getRivalBall() };
+    for (int b = BALL_RED; b <= BALL_RIVAL; b++) {
+        x[bricks + b] = balls[b]->x;
+        z[bricks + b] = balls[b]->z;
+    }
+    alive[bricks + BALL_RIVAL] = session.hasRival() ? 1 : 0;
+
+    build(&x[0], &z[0], &alive[0], count, (float)M_RADIUS);
+    m_ballBase = bricks;
+}
+
+// whether (c, r) is the first cell storing 'item' in a block of cells that
+// starts at (c0, r0)
+bool CSpatialIndex::firstCell(int item, int c, int r, int c0, int r0) const
+{
+    int ic0, ir0, ic1, ir1;
+    m_grid.brickCells(item, &ic0, &ir0, &ic1, &ir1);
+    return c == (ic0 > c0 ? ic0 : c0) && r == (ir0 > r0 ? ir0 : r0);
+}
+
+int CSpatialIndex::query(const SpatialQuery& q, SpatialHit* hits, int maxHits) const
+{
+    if (m_grid.getColumns() == 0)
+        return 0;
+    switch (q.kind) {
+    case QUERY_RADIUS:  return queryRadius(q, hits, maxHits);
+    case QUERY_NEAREST: return queryNearest(q, hits, maxHits);
+    case QUERY_BOX:     return queryBox(q, hits, maxHits);
+    case QUERY_SEGMENT: return querySegment(q, hits, maxHits);
+    }
+    return 0;
+}
+
+// a ball circle that touches the query circle is stored in one of the cells
+// the query circle covers. of those cells the ball counts in the first one
+int CSpatialIndex::queryRadius(const SpatialQuery& q, SpatialHit* hits, int maxHits) const
+{
+    float reach = q.radius + m_radius;
+    int c0 = m_grid.columnOf(q.x0 - q.radius), c1 = m_grid.columnOf(q.x0 + q.radius);
+    int r0 = m_grid.rowOf(q.z0 - q.radius), r1 = m_grid.rowOf(q.z0 + q.radius);
+    int found = 0, kept = 0;
+    for (int r = r0; r <= r1; r++) {
+        for (int c = c0; c <= c1; c++) {
+            const int* items;
+            int count = m_grid.cellItems(c, r, &items);
+            for (int k = 0; k < count; k++) {
+                int item = items[k];
+                float dx = m_grid.getX(item) - q.x0;
+                float dz = m_grid.getZ(item) - q.z0;
+                float d2 = dx * dx + dz * dz;
+                if (d2 > reach * reach)
+                    continue;
+                if ((c > c0 || r > r0) && !firstCell(item, c, r, c0, r0))
+                    continue;
+                insertHit(hits, maxHits, &kept, item, sqrtf(d2));
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+int CSpatialIndex::queryNearest(const SpatialQuery& q, SpatialHit* hits, int maxHits) const
+{
+    int limit = q.k < maxHits ? q.k : maxHits;
+    if (limit <= 0)
+        return 0;
+
+    // rings of cells around the query point, until nothing outside the cells
+    // seen so far can be nearer than the k-th hit. a ball counts in the cell
+    // of its center only
+    int cols = m_grid.getColumns(), rows = m_grid.getRows();
+    float cell = m_grid.getCellSize();
+    float minX = m_grid.getMinX(), minZ = m_grid.getMinZ();
+    int cx = m_grid.columnOf(q.x0), cz = m_grid.rowOf(q.z0);
+    int kept = 0;
+    for (int d = 0; ; d++) {
+        int r0 = cz - d, r1 = cz + d;
+        for (int r = r0 < 0 ? 0 : r0; r <= r1 && r < rows; r++) {
+            int step = r == r0 || r == r1 ? 1 : 2 * d;
+            for (int c = cx - d; c <= cx + d; c += step) {
+                if (c < 0 || c >= cols)
+                    continue;
+                const int* items;
+                int count = m_grid.cellItems(c, r, &items);
+                for (int k = 0; k < count; k++) {
+                    int item = items[k];
+                    float x = m_grid.getX(item), z = m_grid.getZ(item);
+                    float distance = sqrtf((x - q.x0) * (x - q.x0) + (z - q.z0) * (z - q.z0));
+                    if (q.radius > 0 && distance > q.radius)
+                        continue;
+                    if (kept == limit && !hitBefore(distance, item, hits[limit - 1]))
+                        continue;
+                    if (m_grid.columnOf(x) == c && m_grid.rowOf(z) == r)
+                        insertHit(hits, limit, &kept, item, distance);
+                }
+            }
+        }
+
+        // distance from the query point to the nearest side of the block of
+        // cells seen; sides past the grid have nothing beyond them
+        bool left = cx - d > 0, right = cx + d < cols - 1;
+        bool down = cz - d > 0, up = cz + d < rows - 1;
+        if (!left && !right && !down && !up)
+            break;
+        float margin = 1e30f;
+        if (left)
+            margin = fminf(margin, q.x0 - (minX + (cx - d) * cell));
+        if (right)
+            margin = fminf(margin, minX + (cx + d + 1) * cell - q.x0);
+        if (down)
+            margin = fminf(margin, q.z0 - (minZ + (cz - d) * cell));
+        if (up)
+            margin = fminf(margin, minZ + (cz + d + 1) * cell - q.z0);
+        if (kept == limit && hits[limit - 1].distance <= margin)
+            break;
+        if (q.radius > 0 && margin > q.radius)
+            break;
+    }
+    return kept;
+}
+
+int CSpatialIndex::queryBox(const SpatialQuery& q, SpatialHit* hits, int maxHits) const
+{
+    float minX = fminf(q.x0, q.x1), maxX = fmaxf(q.x0, q.x1);
+    float minZ = fminf(q.z0, q.z1), maxZ = fmaxf(q.z0, q.z1);
+    int c0 = m_grid.columnOf(minX), c1 = m_grid.columnOf(maxX);
+    int r0 = m_grid.rowOf(minZ), r1 = m_grid.rowOf(maxZ);
+    int found = 0;
+    for (int r = r0; r <= r1; r++) {
+        for (int c = c0; c <= c1; c++) {
+            const int* items;
+            int count = m_grid.cellItems(c, r, &items);
+            for (int k = 0; k < count; k++) {
+                int item = items[k];
+                float x = m_grid.getX(item), z = m_grid.getZ(item);
+                float dx = x < minX ? minX - x : x > maxX ? x - maxX : 0;
+                float dz = z < minZ ? minZ - z : z > maxZ ? z - maxZ : 0;
+                if (dx * dx + dz * dz > m_radius * m_radius)
+                    continue;
+                if ((c > c0 || r > r0) && !firstCell(item, c, r, c0, r0))
+                    continue;
+                if (found < maxHits) {
+                    hits[found].item = item;
+                    hits[found].distance = 0;
+                }
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+bool CSpatialIndex::segmentColumns(const SpatialQuery& q, int row, int* c0, int* c1) const
+{
+    // the part of the segment within q.radius of this row, slightly widened
+    // for rounding at the row edges
+    float cell = m_grid.getCellSize();
+    float rowZ = m_grid.getMinZ() + row * cell;
+    float bandLo = rowZ - q.radius - 1e-4f * cell;
+    float bandHi = rowZ + cell + q.radius + 1e-4f * cell;
+    float dx = q.x1 - q.x0, dz = q.z1 - q.z0;
+    float t0 = 0, t1 = 1;
+    if (dz != 0) {
+        float ta = (bandLo - q.z0) / dz, tb = (bandHi - q.z0) / dz;
+        t0 = fmaxf(t0, fminf(ta, tb));
+        t1 = fminf(t1, fmaxf(ta, tb));
+        if (t0 > t1)
+            return false;
+    }
+    else if (q.z0 < bandLo || q.z0 > bandHi) {
+        return false;
+    }
+    float xa = q.x0 + dx * t0, xb = q.x0 + dx * t1;
+    *c0 = m_grid.columnOf(fminf(xa, xb) - q.radius);
+    *c1 = m_grid.columnOf(fmaxf(xa, xb) + q.radius);
+    return true;
+}
+
+int CSpatialIndex::querySegment(const SpatialQuery& q, SpatialHit* hits, int maxHits) const
+{
+    float reach = q.radius + m_radius;
+    float dx = q.x1 - q.x0, dz = q.z1 - q.z0;
+    float a = dx * dx + dz * dz;
+    int r0 = m_grid.rowOf(fminf(q.z0, q.z1) - q.radius), r1 = m_grid.rowOf(fmaxf(q.z0, q.z1) + q.radius);
+    int found = 0, kept = 0;
+    for (int r = r0; r <= r1; r++) {
+        int c0, c1;
+        if (!segmentColumns(q, r, &c0, &c1))
+            continue;
+        for (int c = c0; c <= c1; c++) {
+            const int* items;
+            int count = m_grid.cellItems(c, r, &items);
+            for (int k = 0; k < count; k++) {
+                // earliest t in [0, 1] with |p0 + t * d - center| <= reach
+                int item = items[k];
+                float mx = q.x0 - m_grid.getX(item), mz = q.z0 - m_grid.getZ(item);
+                float cc = mx * mx + mz * mz - reach * reach;
+                float t;
+                if (cc <= 0) {
+                    t = 0;
+                }
+                else {
+                    float b = mx * dx + mz * dz;
+                    if (a == 0 || b >= 0)
+                        continue;
+                    float disc = b * b - a * cc;
+                    if (disc < 0)
+                        continue;
+                    t = (-b - sqrtf(disc)) / a;
+                    if (t > 1)
+                        continue;
+                }
+
+                // counted in the first visited cell that stores it : no
+                // earlier row may reach its cells, and in this row c is the
+                // first of them
+                if (c > c0 || r > r0) {
+                    int ic0, ir0, ic1, ir1;
+                    m_grid.brickCells(item, &ic0, &ir0, &ic1, &ir1);
+                    if (c != (ic0 > c0 ? ic0 : c0))
+                        continue;
+                    bool seen = false;
+                    for (int rr = ir0 > r0 ? ir0 : r0; rr < r && !seen; rr++) {
+                        int a0, a1;
+                        seen = segmentColumns(q, rr, &a0, &a1) && a0 <= ic1 && a1 >= ic0;
+                    }
+                    if (seen)
+                        continue;
+                }
+                insertHit(hits, maxHits, &kept, item, t);
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+void CSpatialIndex::queryBatch(const SpatialQuery* queries, int count, SpatialHit* hits, int hitsPerQuery, int* counts)
+{
+    m_queries = queries;
+    m_hits = hits;
+    m_hitsPerQuery = hitsPerQuery;
+    m_counts = counts;
+    m_pool.run(count, QUERY_CHUNK, runQueries, this);
+}
+
+void CSpatialIndex::runQueries(int begin, int end, void* user)
+{
+    const CSpatialIndex* index = (const CSpatialIndex*)user;
+    for (int i = begin; i < end; i++)
+        index->m_counts[i] = index->query(index->m_queries[i], index->m_hits + (size_t)i * index->m_hitsPerQuery,
+            index->m_hitsPerQuery);
+}
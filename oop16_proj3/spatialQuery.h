@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: spatialQuery.h
+//
+// Desc: Spatial queries over the balls of a table, for bots, the aim preview
+//       and level checks : which balls are near a point, the k nearest ones,
+//       which lie in a box, and what a line (or a moving ball) runs into.
+//
+//       The balls are kept in a CBrickGrid with the ball radius as reach, so
+//       each ball is in every cell its circle touches and a query only visits
+//       the cells its own shape covers. A ball found in several of them is
+//       counted in the first one only. Queries come in batches that a
+//       CWorkerPool answers in chunks; hits go into buffers the caller owns,
+//       nothing is allocated per query.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __spatialQueryH__
+#define __spatialQueryH__
+
+#include "gameSession.h"
+#include "brickGrid.h"
+#include "workerPool.h"
+
+enum SpatialQueryKind
+{
+    QUERY_RADIUS = 0,   // balls overlapping the circle (x0, z0, radius), nearest first
+    QUERY_NEAREST,      // the k ball centers nearest to (x0, z0), within radius when radius > 0
+    QUERY_BOX,          // balls overlapping the box (x0, z0) - (x1, z1)
+    QUERY_SEGMENT       // balls touched by a circle of radius (0 : a line) moving from (x0, z0)
+                        // to (x1, z1), in the order they are touched
+};
+
+struct SpatialQuery
+{
+    int     kind;       // SpatialQueryKind
+    int     k;          // QUERY_NEAREST : how many
+    float   x0, z0;
+    float   x1, z1;
+    float   radius;
+};
+
+struct SpatialHit
+{
+    int     item;       // index of the ball, see build()
+    float   distance;   // center distance; 0 for a box; for a segment the fraction
+                        // of it (0..1) travelled before the touch
+};
+
+class CSpatialIndex {
+public:
+    // threadCount <= 0 picks one thread per hardware core
+    explicit CSpatialIndex(int threadCount = 0);
+    ~CSpatialIndex(void);
+
+    // balls of 'radius' centered at (x, z); the index of a ball is its item.
+    // alive may be NULL (every ball present)
+    void build(const float* x, const float* z, const unsigned char* alive, int count, float radius);
+    // the bricks still on the table (item = brick index) and the moving balls
+    // (item = getBallItem(BallId))
+    void build(const CGameSession& session);
+    void clear(void);
+
+    int getBallItem(int ball) const { return m_ballBase + ball; }
+    bool isBrickItem(int item) const { return item < m_ballBase; }
+
+    // one query on the calling thread. writes at most maxHits hits, the first
+    // ones in the query's order, and returns how many there are in all
+    // (QUERY_NEAREST : how many were written)
+    int query(const SpatialQuery& q, SpatialHit* hits, int maxHits) const;
+
+    // counts[i] = query(queries[i], hits + i * hitsPerQuery, hitsPerQuery), on
+    // the thread pool. the calling thread works too and returns when all are done
+    void queryBatch(const SpatialQuery* queries, int count, SpatialHit* hits, int hitsPerQuery, int* counts);
+
+private:
+    CSpatialIndex(const CSpatialIndex&);
+    CSpatialIndex& operator=(const CSpatialIndex&);
+
+    int queryRadius(const SpatialQuery& q, SpatialHit* hits, int maxHits) const;
+    int queryNearest(const SpatialQuery& q, SpatialHit* hits, int maxHits) const;
+    int queryBox(const SpatialQuery& q, SpatialHit* hits, int maxHits) const;
+    int querySegment(const SpatialQuery& q, SpatialHit* hits, int maxHits) const;
+
+    bool firstCell(int item, int c, int r, int c0, int r0) const;
+    // the columns of row 'row' a segment query has to visit
+    bool segmentColumns(const SpatialQuery& q, int row, int* c0, int* c1) const;
+
+    static void runQueries(int begin, int end, void* user);
+
+    CBrickGrid          m_grid;
+    float               m_radius;
+    int                 m_ballBase;     // first moving ball item
+
+    CWorkerPool         m_pool;
+    const SpatialQuery* m_queries;
+    SpatialHit*         m_hits;
+    int                 m_hitsPerQuery;
+    int*                m_counts;
+};
+
+#endif // __spatialQueryH__
@@ -0,0 +1,48 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: spinModel.cpp
+//
+// Desc: Shot spin and contact friction of spinning balls.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "spinModel.h"
+#include "gameSession.h"
+
+void applyShotSpin(BallState& ball, const ShotSpin& spin)
+{
+    const float radius = (float)M_RADIUS;
+    float speed = sqrtf(ball.vx * ball.vx + ball.vz * ball.vz);
+    if (speed == 0.0f) {
+        ball.wx = ball.wy = ball.wz = 0;
+        return;
+    }
+    float dx = ball.vx / speed;
+    float dz = ball.vz / speed;
+    float roll = speed / radius;
+
+    // rolling spin is about the axis across the shot, (dz, 0, -dx); masse
+    // spin about the shot direction itself
+    ball.wx = roll * (spin.follow * dz + spin.masse * dx);
+    ball.wy = roll * spin.side;
+    ball.wz = roll * (-spin.follow * dx + spin.masse * dz);
+}
+
+void contactFriction(BallState& ball, float nx, float nz, float bodyVX, float bodyVZ, float normalImpulse, float friction)
+{
+    const float radius = (float)M_RADIUS;
+
+    // the contact point is radius * -n from the center; along the tangent
+    // (-nz, nx) it moves with the ball plus radius * wy
+    float tx = -nz;
+    float tz = nx;
+    float slip = (ball.vx - bodyVX) * tx + (ball.vz - bodyVZ) * tz + radius * ball.wy;
+
+    float limit = friction * (normalImpulse > 0.0f ? normalImpulse : 0.0f);
+    float impulse = -slip * (2.0f / 7.0f);
+    impulse = fmaxf(-limit, fminf(limit, impulse));
+
+    ball.vx += impulse * tx;
+    ball.vz += impulse * tz;
+    ball.wy += 2.5f / radius * impulse;
+}
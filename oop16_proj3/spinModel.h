@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: spinModel.h
+//
+// Desc: Ball spin for billiards play. A ball carries an angular velocity
+//       (wx, wy, wz) next to its velocity on the table plane.
+//
+//       Where the ball touches the cloth, its surface moves with the slip
+//       velocity u = v + w x (0, -radius, 0). While u is not zero the ball
+//       slides : cloth friction pushes against u, slowing or speeding the
+//       ball and turning its spin until u is gone and the ball rolls. A shot
+//       with follow or draw therefore speeds up or comes back after a hit,
+//       and a spin axis tilted along the shot (masse) makes it curve.
+//       Side spin (wy) does not touch the slip; it wears off on its own and
+//       is traded for sideways speed when the ball hits a cushion or a ball.
+//
+//       The balls are solid spheres (I = 2/5 m r^2), so a friction impulse J
+//       changes the slip by 7/2 J.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __spinModelH__
+#define __spinModelH__
+
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+struct BallState;
+
+// spin given to a ball by a shot, in units of the spin of a ball rolling at
+// the shot speed
+struct ShotSpin
+{
+    float   follow;     // > 0 : top spin (follow), < 0 : back spin (draw), 1 : rolls from the start
+    float   side;       // spin about the vertical axis (english), used up at cushions and balls
+    float   masse;      // spin about the shot direction : the path curves, to one side or the other by sign
+};
+
+// one frame of cloth friction on a spinning ball. 'slide' is the speed change
+// friction gives a sliding ball in this frame, 'spinDecay' the side spin it
+// takes away. branch free, so the lane loops of CWorldPack vectorize it
+inline void spinFriction(float& vx, float& vz, float& wx, float& wy, float& wz, float radius, float slide, float spinDecay)
+{
+    float ux = vx + radius * wz;
+    float uz = vz - radius * wx;
+    float slip = sqrtf(ux * ux + uz * uz);
+
+    // at most the whole slip : the ball then rolls. std::min / std::max
+    // rather than fminf() or a guarded division, which keep the loops scalar
+    float f = std::min(slide, slip * (2.0f / 7.0f));
+    float scale = f / std::max(slip, FLT_MIN);
+    float fx = -ux * scale;
+    float fz = -uz * scale;
+    vx += fx;
+    vz += fz;
+    wx -= 2.5f / radius * fz;
+    wz += 2.5f / radius * fx;
+
+    wy -= copysignf(std::min(spinDecay, fabsf(wy)), wy);
+}
+
+// spin of a ball just launched with its current velocity
+void applyShotSpin(BallState& ball, const ShotSpin& spin);
+
+// tangential friction where 'ball' touched something that does not spin (a
+// brick, paddle ball or wall) and got 'normalImpulse' along the normal
+// (nx, nz). Coulomb friction, at most 'friction' times the normal impulse
+void contactFriction(BallState& ball, float nx, float nz, float bodyVX, float bodyVZ, float normalImpulse, float friction);
+
+#endif // __spinModelH__
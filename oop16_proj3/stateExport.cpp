@@ -0,0 +1,495 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: stateExport.cpp
+//
+// Desc: Shared memory state export, game and reader side.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "stateExport.h"
+#include <cstdio>
+#include <cstring>
+#include <new>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// room for this many bricks unless the table has more, so a new table
+// hardly ever needs a new region
+const int EXPORT_MIN_BRICKS = 4096;
+
+// a reader gives up after this many torn reads in a row
+const int EXPORT_READ_TRIES = 100;
+
+static size_t alignUp(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+// -----------------------------------------------------------------------------
+// Platform regions
+// -----------------------------------------------------------------------------
+
+static void regionName(const char* name, char* out, size_t size)
+{
+#ifdef _WIN32
+    snprintf(out, size, "Local\\billiard-%s", name);
+#else
+    snprintf(out, size, "/billiard-%s", name);
+#endif
+}
+
+// a new zero-filled region of 'size' bytes, mapped read / write
+static void* createRegion(const char* name, size_t size, void** handle)
+{
+    char path[128];
+    regionName(name, path, sizeof(path));
+    *handle = NULL;
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)size, path);
+    if (mapping == NULL)
+        return NULL;
+    // a reader still holds an old region of this name : it cannot be resized
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        CloseHandle(mapping);
+        return NULL;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (data == NULL) {
+        CloseHandle(mapping);
+        return NULL;
+    }
+    *handle = mapping;
+    return data;
+#else
+    // a region left behind by a crashed game goes first. readers that still
+    // map it keep their copy
+    shm_unlink(path);
+    int fd = shm_open(path, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+        return NULL;
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        shm_unlink(path);
+        return NULL;
+    }
+    void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        shm_unlink(path);
+        return NULL;
+    }
+    return data;
+#endif
+}
+
+// an existing region, mapped read only
+static void* openRegion(const char* name, size_t* size, void** handle)
+{
+    char path[128];
+    regionName(name, path, sizeof(path));
+    *handle = NULL;
+#ifdef _WIN32
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, path);
+    if (mapping == NULL)
+        return NULL;
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL) {
+        CloseHandle(mapping);
+        return NULL;
+    }
+    MEMORY_BASIC_INFORMATION info;
+    VirtualQuery(data, &info, sizeof(info));
+    *size = info.RegionSize;
+    *handle = mapping;
+    return data;
+#else
+    int fd = shm_open(path, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ExportHeader)) {
+        close(fd);
+        return NULL;
+    }
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return NULL;
+    *size = (size_t)st.st_size;
+    return data;
+#endif
+}
+
+static void unmapRegion(const void* data, size_t size, void* handle)
+{
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+    CloseHandle((HANDLE)handle);
+#else
+    (void)handle;
+    munmap((void*)data, size);
+#endif
+}
+
+static void removeRegion(const char* name)
+{
+#ifndef _WIN32
+    char path[128];
+    regionName(name, path, sizeof(path));
+    shm_unlink(path);
+#endif
+}
+
+static const float* layoutOf(const ExportHeader* header)
+{
+    return (const float*)((const char*)header + alignUp(sizeof(ExportHeader), 64));
+}
+
+static const ExportSlot* slotOf(const ExportHeader* header, unsigned i)
+{
+    return (const ExportSlot*)((const char*)header + header->slotOffset + (size_t)i * header->slotSize);
+}
+
+static const unsigned char* aliveOf(const ExportSlot* slot)
+{
+    return (const unsigned char*)(slot + 1);
+}
+
+static const ContactEvent* contactsOf(const ExportHeader* header, const ExportSlot* slot)
+{
+    return (const ContactEvent*)((const char*)(slot + 1) + alignUp(header->maxBricks, 4));
+}
+
+static const ExportBall* extraOf(const ExportHeader* header, const ExportSlot* slot)
+{
+    return (const ExportBall*)(contactsOf(header, slot) + header->maxContacts);
+}
+
+static void exportBall(ExportBall& out, const BallState& ball)
+{
+    out.x = ball.x;     out.z = ball.z;
+    out.vx = ball.vx;   out.vz = ball.vz;
+    out.wx = ball.wx;   out.wy = ball.wy;   out.wz = ball.wz;
+}
+
+// -----------------------------------------------------------------------------
+// CStateExport
+// -----------------------------------------------------------------------------
+
+CStateExport::CStateExport(void)
+{
+    m_name[0] = '\0';
+    m_handle = NULL;
+    m_header = NULL;
+    m_size = 0;
+    m_stepId = 0;
+    m_layoutId = 0;
+}
+
+CStateExport::~CStateExport(void)
+{
+    close();
+}
+
+bool CStateExport::open(const char* name, const CGameSession& session, int maxBricks)
+{
+    close();
+    strncpy(m_name, name, sizeof(m_name) - 1);
+    m_name[sizeof(m_name) - 1] = '\0';
+    if (maxBricks < session.getBrickCount())
+        maxBricks = session.getBrickCount();
+    if (!create(maxBricks))
+        return false;
+    writeLayout(session);
+    return true;
+}
+
+void CStateExport::close(void)
+{
+    if (m_header == NULL)
+        return;
+    m_header->closed.store(1, std::memory_order_release);
+    unmapRegion(m_header, m_size, m_handle);
+    removeRegion(m_name);
+    m_header = NULL;
+    m_handle = NULL;
+}
+
+bool CStateExport::create(int maxBricks)
+{
+    if (maxBricks < EXPORT_MIN_BRICKS)
+        maxBricks = EXPORT_MIN_BRICKS;
+
+    size_t layoutOffset = alignUp(sizeof(ExportHeader), 64);
+    size_t slotOffset = alignUp(layoutOffset + (size_t)maxBricks * 2 * sizeof(float), 64);
+    size_t slotSize = alignUp(sizeof(ExportSlot) + alignUp(maxBricks, 4) + EXPORT_MAX_CONTACTS * sizeof(ContactEvent) +
+        EXPORT_MAX_EXTRA_BALLS * sizeof(ExportBall), 64);
+    size_t size = slotOffset + EXPORT_SLOTS * slotSize;
+
+    void* data = createRegion(m_name, size, &m_handle);
+    if (data == NULL) {
+        printf("state export %s : cannot create the shared memory\n", m_name);
+        return false;
+    }
+    m_size = size;
+
+    ExportHeader* header = new (data) ExportHeader();
+    header->version = EXPORT_VERSION;
+    header->totalSize = (unsigned)size;
+    header->slotCount = EXPORT_SLOTS;
+    header->slotSize = (unsigned)slotSize;
+    header->slotOffset = (unsigned)slotOffset;
+    header->maxBricks = (unsigned)maxBricks;
+    header->maxContacts = EXPORT_MAX_CONTACTS;
+    header->maxExtraBalls = EXPORT_MAX_EXTRA_BALLS;
+    header->closed.store(0, std::memory_order_relaxed);
+    header->latest.store(EXPORT_SLOTS, std::memory_order_relaxed);
+    header->layoutSequence.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < EXPORT_SLOTS; i++)
+        new ((char*)data + slotOffset + i * slotSize) ExportSlot();
+
+    // the magic last : a reader that sees it sees a complete header
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = EXPORT_MAGIC;
+    m_header = header;
+    return true;
+}
+
+void CStateExport::setLayout(const CGameSession& session)
+{
+    if (m_header == NULL)
+        return;
+    if ((unsigned)session.getBrickCount() > m_header->maxBricks) {
+        m_header->closed.store(1, std::memory_order_release);
+        unmapRegion(m_header, m_size, m_handle);
+        removeRegion(m_name);
+        m_header = NULL;
+        m_handle = NULL;
+        if (!create(session.getBrickCount()))
+            return;
+    }
+    writeLayout(session);
+}
+
+void CStateExport::writeLayout(const CGameSession& session)
+{
+    ExportHeader* header = m_header;
+    unsigned sequence = header->layoutSequence.load(std::memory_order_relaxed);
+    header->layoutSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    float* layout = (float*)layoutOf(header);
+    int count = session.getBrickCount();
+    for (int i = 0; i < count; i++) {
+        layout[i * 2] = session.getBrick(i).x;
+        layout[i * 2 + 1] = session.getBrick(i).z;
+    }
+    header->brickCount = (unsigned)count;
+    header->layoutId = ++m_layoutId;
+
+    header->layoutSequence.store(sequence + 2, std::memory_order_release);
+}
+
+void CStateExport::publish(const CGameSession& session, float timeDelta)
+{
+    if (m_header == NULL)
+        return;
+
+    // the slot after the newest one : the two others stay readable meanwhile
+    unsigned latest = m_header->latest.load(std::memory_order_relaxed);
+    unsigned index = latest >= EXPORT_SLOTS ? 0 : (latest + 1) % EXPORT_SLOTS;
+    ExportSlot* slot = (ExportSlot*)slotOf(m_header, index);
+
+    unsigned sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    ExportStep& step = slot->step;
+    step.stepId = m_stepId++;
+    step.layoutId = m_layoutId;
+    step.timeDelta = timeDelta;
+    step.flags = (session.isStarted() ? EXPORT_STARTED : 0) | (session.isRestart() ? EXPORT_RESTART : 0) |
+        (session.isComplete() ? EXPORT_COMPLETE : 0) | (session.hasRival() ? EXPORT_RIVAL : 0);
+    step.bricksLeft = session.getBricksLeft();
+
+    exportBall(step.balls[BALL_RED], session.getRedBall());
+    exportBall(step.balls[BALL_WHITE], session.getWhiteBall());
+    exportBall(step.balls[BALL_RIVAL], session.getRivalBall());
+
+    // in slot order, so extra ball i is still BALL_EXTRA + i in the contacts
+    int extra = session.getExtraBallCount();
+    step.extraTotal = (unsigned)extra;
+    if (extra > EXPORT_MAX_EXTRA_BALLS)
+        extra = EXPORT_MAX_EXTRA_BALLS;
+    ExportBall* extraBalls = (ExportBall*)extraOf(m_header, slot);
+    for (int i = 0; i < extra; i++)
+        exportBall(extraBalls[i], session.getExtraBalls()[i]);
+    step.extraCount = (unsigned)extra;
+
+    int bricks = session.getBrickCount();
+    unsigned char* alive = (unsigned char*)aliveOf(slot);
+    for (int i = 0; i < bricks; i++)
+        alive[i] = session.isBrickAlive(i) ? 1 : 0;
+    step.brickCount = (unsigned)bricks;
+
+    int contacts = session.getContactCount();
+    step.contactTotal = (unsigned)contacts;
+    if (contacts > EXPORT_MAX_CONTACTS)
+        contacts = EXPORT_MAX_CONTACTS;
+    if (contacts > 0)
+        memcpy((void*)contactsOf(m_header, slot), session.getContacts(), contacts * sizeof(ContactEvent));
+    step.contactCount = (unsigned)contacts;
+
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+    m_header->latest.store(index, std::memory_order_release);
+}
+
+// -----------------------------------------------------------------------------
+// CStateReader
+// -----------------------------------------------------------------------------
+
+CStateReader::CStateReader(void)
+{
+    m_handle = NULL;
+    m_header = NULL;
+    m_size = 0;
+    m_retries = 0;
+}
+
+CStateReader::~CStateReader(void)
+{
+    close();
+}
+
+bool CStateReader::open(const char* name)
+{
+    close();
+    void* data = openRegion(name, &m_size, &m_handle);
+    if (data == NULL)
+        return false;
+
+    const ExportHeader* header = (const ExportHeader*)data;
+    bool ok = header->magic == EXPORT_MAGIC;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    ok = ok && header->version == EXPORT_VERSION && header->totalSize <= m_size &&
+        header->slotCount == EXPORT_SLOTS && header->maxContacts <= EXPORT_MAX_CONTACTS &&
+        header->maxExtraBalls <= EXPORT_MAX_EXTRA_BALLS &&
+        header->slotOffset + (size_t)header->slotCount * header->slotSize <= header->totalSize;
+    if (!ok) {
+        unmapRegion(data, m_size, m_handle);
+        m_handle = NULL;
+        return false;
+    }
+    m_header = header;
+    return true;
+}
+
+void CStateReader::close(void)
+{
+    if (m_header == NULL)
+        return;
+    unmapRegion(m_header, m_size, m_handle);
+    m_header = NULL;
+    m_handle = NULL;
+}
+
+bool CStateReader::isClosed(void) const
+{
+    return m_header == NULL || m_header->closed.load(std::memory_order_acquire) != 0;
+}
+
+bool CStateReader::readLayout(std::vector<float>& bricks, unsigned* layoutId)
+{
+    if (m_header == NULL)
+        return false;
+    for (int attempt = 0; attempt < EXPORT_READ_TRIES; attempt++) {
+        unsigned sequence = m_header->layoutSequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            m_retries++;
+            continue;
+        }
+        // a torn count may be anything : never read past the layout
+        unsigned count = m_header->brickCount;
+        if (count > m_header->maxBricks)
+            count = m_header->maxBricks;
+        const float* layout = layoutOf(m_header);
+        bricks.assign(layout, layout + count * 2);
+        unsigned id = m_header->layoutId;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_header->layoutSequence.load(std::memory_order_relaxed) == sequence) {
+            if (layoutId != NULL)
+                *layoutId = id;
+            return true;
+        }
+        m_retries++;
+    }
+    return false;
+}
+
+const ExportSlot* CStateReader::begin(unsigned* sequence) const
+{
+    if (m_header == NULL)
+        return NULL;
+    unsigned index = m_header->latest.load(std::memory_order_acquire);
+    if (index >= m_header->slotCount)
+        return NULL;
+    const ExportSlot* slot = slotOf(m_header, index);
+    *sequence = slot->sequence.load(std::memory_order_acquire);
+    return slot;
+}
+
+bool CStateReader::validate(const ExportSlot* slot, unsigned sequence) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return (sequence & 1) == 0 && slot->sequence.load(std::memory_order_relaxed) == sequence;
+}
+
+const unsigned char* CStateReader::getAlive(const ExportSlot* slot) const
+{
+    return aliveOf(slot);
+}
+
+const ContactEvent* CStateReader::getContacts(const ExportSlot* slot) const
+{
+    return contactsOf(m_header, slot);
+}
+
+const ExportBall* CStateReader::getExtraBalls(const ExportSlot* slot) const
+{
+    return extraOf(m_header, slot);
+}
+
+bool CStateReader::read(ExportStep& step, std::vector<unsigned char>* alive, std::vector<ContactEvent>* contacts,
+    std::vector<ExportBall>* extra)
+{
+    for (int attempt = 0; attempt < EXPORT_READ_TRIES; attempt++) {
+        unsigned sequence;
+        const ExportSlot* slot = begin(&sequence);
+        if (slot == NULL)
+            return false;
+
+        memcpy(&step, &slot->step, sizeof(step));
+        unsigned bricks = step.brickCount < m_header->maxBricks ? step.brickCount : m_header->maxBricks;
+        unsigned count = step.contactCount < m_header->maxContacts ? step.contactCount : m_header->maxContacts;
+        if (alive != NULL)
+            alive->assign(aliveOf(slot), aliveOf(slot) + bricks);
+        if (contacts != NULL)
+            contacts->assign(contactsOf(m_header, slot), contactsOf(m_header, slot) + count);
+        unsigned balls = step.extraCount < m_header->maxExtraBalls ? step.extraCount : m_header->maxExtraBalls;
+        if (extra != NULL)
+            extra->assign(extraOf(m_header, slot), extraOf(m_header, slot) + balls);
+
+        if (validate(slot, sequence))
+            return true;
+        m_retries++;
+    }
+    return false;
+}
@@ -0,0 +1,190 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: stateExport.h
+//
+// Desc: Live game state for other processes (viewers, bots, analytics)
+//       through a named shared memory region : POSIX shm_open / mmap, or a
+//       named file mapping on Windows.
+//
+//       The game publishes every completed step into one of three slots and
+//       then marks it as the newest. Each slot, and the brick layout, is
+//       guarded by a sequence number (seqlock) : odd while the game is
+//       writing, bumped again when done. A reader reads the newest slot in
+//       place and afterwards checks that its sequence number did not move;
+//       if it did, it simply reads the new newest slot. Readers never write
+//       to the region, so any number of them cost the game nothing.
+//
+//       region :  ExportHeader | brick layout | slot 0 | slot 1 | slot 2
+//       slot   :  ExportSlot | alive bytes (padded to 4) | ContactEvent[] |
+//                 ExportBall[] of the extra balls
+//
+//       Contacts name balls by BallId. Extra ball i of a step (BALL_EXTRA + i)
+//       is in the extra ball array when i < extraCount; a multi-ball burst
+//       larger than maxExtraBalls only keeps its first balls, and contacts
+//       of the others name a ball the step does not hold.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __stateExportH__
+#define __stateExportH__
+
+#include "gameSession.h"
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "the seqlock needs lock free atomics to work across processes");
+
+const unsigned EXPORT_MAGIC = 0x58534c42;     // "BLSX"
+const unsigned EXPORT_VERSION = 2;
+const int EXPORT_SLOTS = 3;
+const int EXPORT_BALLS = 3;                   // BallId order
+const int EXPORT_MAX_CONTACTS = 64;           // contacts kept per step
+const int EXPORT_MAX_EXTRA_BALLS = 256;       // extra balls kept per step
+
+enum ExportFlags
+{
+    EXPORT_STARTED  = 1,    // red ball waits on the white ball
+    EXPORT_RESTART  = 2,
+    EXPORT_COMPLETE = 4,
+    EXPORT_RIVAL    = 8     // the rival paddle is on the table
+};
+
+struct ExportBall
+{
+    float x, z;
+    float vx, vz;
+    float wx, wy, wz;
+};
+
+struct ExportHeader
+{
+    unsigned                magic;
+    unsigned                version;
+    unsigned                totalSize;      // bytes of the whole region
+    unsigned                slotCount;
+    unsigned                slotSize;
+    unsigned                slotOffset;     // of slot 0
+    unsigned                maxBricks;
+    unsigned                maxContacts;
+    unsigned                maxExtraBalls;
+
+    std::atomic<unsigned>   closed;         // 1 : the game is gone, or moved to a larger region
+    std::atomic<unsigned>   latest;         // newest complete slot, EXPORT_SLOTS : none yet
+
+    // brickCount * (x, z) floats follow the header
+    std::atomic<unsigned>   layoutSequence;
+    unsigned                layoutId;       // changes with every new table
+    unsigned                brickCount;
+};
+
+// everything of a step but the alive bytes, contacts and extra balls
+struct ExportStep
+{
+    unsigned    stepId;
+    unsigned    layoutId;       // layout the alive bytes belong to
+    float       timeDelta;
+    unsigned    flags;          // ExportFlags
+    int         bricksLeft;
+    unsigned    brickCount;
+    unsigned    contactCount;   // stored, at most maxContacts
+    unsigned    contactTotal;   // found in the step
+    unsigned    extraCount;     // extra balls stored, at most maxExtraBalls
+    unsigned    extraTotal;     // extra balls on the table
+    ExportBall  balls[EXPORT_BALLS];
+};
+
+struct ExportSlot
+{
+    std::atomic<unsigned>   sequence;
+    ExportStep              step;
+};
+
+// -----------------------------------------------------------------------------
+// CStateExport : the game side
+// -----------------------------------------------------------------------------
+
+class CStateExport {
+public:
+    CStateExport(void);
+    ~CStateExport(void);
+
+    // creates the region 'name' (a plain word) and publishes the layout of
+    // 'session'. room for at least maxBricks bricks (0 : what the session has)
+    bool open(const char* name, const CGameSession& session, int maxBricks = 0);
+    // marks the region closed and removes its name
+    void close(void);
+    bool isOpen(void) const { return m_header != NULL; }
+
+    // a new table. a layout larger than the region moves to a new region of
+    // the same name; readers see the old one closed and open again
+    void setLayout(const CGameSession& session);
+
+    // the state after a step
+    void publish(const CGameSession& session, float timeDelta);
+
+    unsigned getStepId(void) const { return m_stepId; }
+
+private:
+    CStateExport(const CStateExport&);
+    CStateExport& operator=(const CStateExport&);
+
+    bool create(int maxBricks);
+    void writeLayout(const CGameSession& session);
+
+    char            m_name[64];
+    void*           m_handle;       // platform mapping handle
+    ExportHeader*   m_header;
+    size_t          m_size;
+    unsigned        m_stepId;
+    unsigned        m_layoutId;
+};
+
+// -----------------------------------------------------------------------------
+// CStateReader : the tool side
+// -----------------------------------------------------------------------------
+
+class CStateReader {
+public:
+    CStateReader(void);
+    ~CStateReader(void);
+
+    // maps the region read only. fails while the game has not created it
+    bool open(const char* name);
+    void close(void);
+    bool isOpen(void) const { return m_header != NULL; }
+
+    // the game quit or moved to a new region : close() and open() again
+    bool isClosed(void) const;
+
+    // brick positions, (x, z) pairs. false if no consistent copy was possible
+    bool readLayout(std::vector<float>& bricks, unsigned* layoutId);
+
+    // zero copy : the newest slot (NULL if nothing was published yet) and its
+    // sequence number. read what is needed straight from it, then validate()
+    // tells whether all of it belonged to one step
+    const ExportSlot* begin(unsigned* sequence) const;
+    bool validate(const ExportSlot* slot, unsigned sequence) const;
+    const unsigned char* getAlive(const ExportSlot* slot) const;
+    const ContactEvent* getContacts(const ExportSlot* slot) const;
+    const ExportBall* getExtraBalls(const ExportSlot* slot) const;
+
+    // copy of the newest step, retried until consistent. false if there is
+    // none yet or the game kept overwriting it
+    bool read(ExportStep& step, std::vector<unsigned char>* alive = NULL, std::vector<ContactEvent>* contacts = NULL,
+        std::vector<ExportBall>* extra = NULL);
+
+    // reads that had to start over because the game wrote the slot meanwhile
+    unsigned getRetries(void) const { return m_retries; }
+
+private:
+    CStateReader(const CStateReader&);
+    CStateReader& operator=(const CStateReader&);
+
+    void*               m_handle;
+    const ExportHeader* m_header;
+    size_t              m_size;
+    unsigned            m_retries;
+};
+
+#endif // __stateExportH__
@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: stateInspect.cpp
+//
+// Desc: Command line tool that reads the state a running game exports
+//       (-export <name>) and prints it. It is a separate program, not part
+//       of the VirtualLego project :
+//
+//         g++ -O2 stateInspect.cpp stateExport.cpp gameSession.cpp level.cpp
+//             boundary.cpp physicsConfig.cpp motionModel.cpp fixedPoint.cpp
+//             contactSolver.cpp spinModel.cpp brickGrid.cpp -o stateInspect
+//
+//       (add -lrt on glibc older than 2.17)
+//
+//       stateInspect <name> [options]
+//
+//         -watch          keep printing until the game quits
+//         -interval <ms>  time between prints with -watch (default 500)
+//         -contacts       also list the contacts of the step
+//         -extra          also list the extra balls of a multi-ball burst
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "stateExport.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+
+static const char* BALL_NAMES[EXPORT_BALLS] = { "red", "white", "rival" };
+static const char* CONTACT_NAMES[] = { "brick", "wall", "ball" };    // ContactKind order
+
+static void printBall(const char* name, const ExportBall& b)
+{
+    printf("  %-5s  pos %8.3f %8.3f  vel %8.3f %8.3f  spin %8.3f %8.3f %8.3f\n",
+        name, b.x, b.z, b.vx, b.vz, b.wx, b.wy, b.wz);
+}
+
+static void printStep(const ExportStep& step, const std::vector<unsigned char>& alive,
+    const std::vector<ContactEvent>& contacts, bool listContacts, const std::vector<ExportBall>& extra, bool listExtra)
+{
+    printf("step %u  layout %u  dt %.4f  bricks %d / %u  contacts %u%s%s%s%s\n",
+        step.stepId, step.layoutId, step.timeDelta, step.bricksLeft, step.brickCount, step.contactTotal,
+        step.flags & EXPORT_STARTED ? "  started" : "", step.flags & EXPORT_RESTART ? "  restart" : "",
+        step.flags & EXPORT_COMPLETE ? "  complete" : "", step.flags & EXPORT_RIVAL ? "  rival" : "");
+    for (int i = 0; i < EXPORT_BALLS; i++) {
+        if (i == BALL_RIVAL && !(step.flags & EXPORT_RIVAL))
+            continue;
+        printBall(BALL_NAMES[i], step.balls[i]);
+    }
+    if (step.extraTotal > 0)
+        printf("  %u extra balls, %u exported\n", step.extraTotal, step.extraCount);
+    if (listExtra) {
+        char name[16];
+        for (size_t i = 0; i < extra.size(); i++) {
+            snprintf(name, sizeof(name), "extra %d", (int)i);
+            printBall(name, extra[i]);
+        }
+    }
+
+    // the alive bytes must agree with the count the game keeps
+    int counted = 0;
+    for (size_t i = 0; i < alive.size(); i++)
+        counted += alive[i] != 0;
+    if (counted != step.bricksLeft)
+        printf("  alive bytes count %d bricks\n", counted);
+
+    if (listContacts) {
+        char ball[32];
+        for (size_t i = 0; i < contacts.size(); i++) {
+            const ContactEvent& c = contacts[i];
+            const char* kind = c.kind >= 0 && c.kind <= CONTACT_BALL ? CONTACT_NAMES[c.kind] : "?";
+            // an extra ball past the exported ones has no state in the step
+            if (c.a >= BALL_EXTRA)
+                snprintf(ball, sizeof(ball), "extra %d%s", c.a - BALL_EXTRA, c.a - BALL_EXTRA < (int)step.extraCount ? "" : " (not exported)");
+            else
+                snprintf(ball, sizeof(ball), "%s", c.a >= 0 ? BALL_NAMES[c.a] : "?");
+            printf("  %-5s  %s - %d  normal %6.3f %6.3f  depth %.4f  speed %.3f\n", kind,
+                ball, c.b, c.nx, c.nz, c.penetration, c.relativeSpeed);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage : stateInspect <name> [-watch] [-interval <ms>] [-contacts] [-extra]\n");
+        return 1;
+    }
+    const char* name = argv[1];
+    bool watch = false;
+    bool listContacts = false;
+    bool listExtra = false;
+    int interval = 500;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-watch") == 0)
+            watch = true;
+        else if (strcmp(argv[i], "-contacts") == 0)
+            listContacts = true;
+        else if (strcmp(argv[i], "-extra") == 0)
+            listExtra = true;
+        else if (strcmp(argv[i], "-interval") == 0 && i + 1 < argc)
+            interval = atoi(argv[++i]);
+    }
+    if (interval <= 0) {
+        fprintf(stderr, "bad -interval\n");
+        return 1;
+    }
+
+    CStateReader reader;
+    if (!reader.open(name)) {
+        fprintf(stderr, "%s : no game exports under this name\n", name);
+        return 1;
+    }
+
+    ExportStep step;
+    std::vector<unsigned char> alive;
+    std::vector<ContactEvent> contacts;
+    std::vector<ExportBall> extra;
+    std::vector<float> layout;
+    unsigned layoutId = 0;
+    unsigned lastStep = 0;
+    bool haveLast = false;
+    std::chrono::steady_clock::time_point lastTime = std::chrono::steady_clock::now();
+
+    for (;;) {
+        if (reader.isClosed()) {
+            // the game moved to a larger region, or quit
+            reader.close();
+            bool reopened = false;
+            for (int i = 0; watch && i < 20 && !reopened; i++) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                reopened = reader.open(name);
+            }
+            if (!reopened) {
+                printf("game closed the export\n");
+                return 0;
+            }
+            haveLast = false;
+        }
+
+        if (reader.read(step, &alive, &contacts, &extra)) {
+            if (step.layoutId != layoutId && reader.readLayout(layout, &layoutId))
+                printf("table %u : %u bricks\n", layoutId, (unsigned)layout.size() / 2);
+            printStep(step, alive, contacts, listContacts, extra, listExtra);
+
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (haveLast) {
+                double seconds = std::chrono::duration<double>(now - lastTime).count();
+                unsigned steps = step.stepId - lastStep;
+                printf("  %.1f steps/s  %u steps since the last print  %u retries\n",
+                    seconds > 0 ? steps / seconds : 0.0, steps, reader.getRetries());
+            }
+            lastStep = step.stepId;
+            lastTime = now;
+            haveLast = true;
+        }
+        else if (!watch) {
+            printf("nothing published yet\n");
+        }
+
+        if (!watch)
+            return 0;
+        fflush(stdout);
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+    }
+}
@@ -0,0 +1,385 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: telemetry.cpp
+//
+// Desc: Per-step world state recording for offline analysis.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "telemetry.h"
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <chrono>
+#include <new>
+#include <algorithm>
+
+// ring slots are a 4 byte length followed by the payload padded to 4 bytes.
+// a length of WRAP_MARKER tells the consumer the rest of the ring is unused
+const unsigned WRAP_MARKER = 0xffffffff;
+
+// the writer hands data to fwrite in blocks of at least this size
+const size_t WRITE_BATCH = 1 << 20;
+
+static size_t slotSize(size_t size)
+{
+    return sizeof(unsigned) + ((size + 3) & ~(size_t)3);
+}
+
+// -----------------------------------------------------------------------------
+// CRingBuffer
+// -----------------------------------------------------------------------------
+
+// the block from malloc is kept just before the aligned object
+void* CRingBuffer::operator new(size_t size)
+{
+    void* raw = malloc(size + 64 + sizeof(void*));
+    if (raw == NULL)
+        throw std::bad_alloc();
+    uintptr_t aligned = ((uintptr_t)raw + sizeof(void*) + 63) & ~(uintptr_t)63;
+    ((void**)aligned)[-1] = raw;
+    return (void*)aligned;
+}
+
+void CRingBuffer::operator delete(void* p)
+{
+    if (p != NULL)
+        free(((void**)p)[-1]);
+}
+
+CRingBuffer::CRingBuffer(size_t capacity)
+{
+    size_t cap = 64;
+    while (cap < capacity)
+        cap <<= 1;
+    m_buffer.resize(cap);
+    m_mask = cap - 1;
+    m_head = 0;
+    m_reserved = 0;
+    m_tail = 0;
+    m_frontSize = 0;
+}
+
+void* CRingBuffer::reserve(size_t size)
+{
+    size_t need = slotSize(size);
+    size_t cap = m_buffer.size();
+    size_t head = m_head.load(std::memory_order_relaxed);
+    size_t tail = m_tail.load(std::memory_order_acquire);
+
+    size_t offset = head & m_mask;
+    size_t pad = (need > cap - offset) ? cap - offset : 0;
+    if (need + pad > cap - (head - tail))
+        return NULL;
+
+    if (pad) {
+        unsigned marker = WRAP_MARKER;
+        memcpy(&m_buffer[offset], &marker, sizeof(marker));
+        head += pad;
+        offset = 0;
+    }
+
+    unsigned length = (unsigned)size;
+    memcpy(&m_buffer[offset], &length, sizeof(length));
+    m_reserved = head + need;
+    return &m_buffer[offset + sizeof(unsigned)];
+}
+
+void CRingBuffer::commit(void)
+{
+    m_head.store(m_reserved, std::memory_order_release);
+}
+
+const void* CRingBuffer::front(size_t* size)
+{
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    size_t head = m_head.load(std::memory_order_acquire);
+    if (tail == head)
+        return NULL;
+
+    size_t offset = tail & m_mask;
+    unsigned length;
+    memcpy(&length, &m_buffer[offset], sizeof(length));
+    if (length == WRAP_MARKER) {
+        tail += m_buffer.size() - offset;
+        m_tail.store(tail, std::memory_order_release);
+        offset = 0;
+        memcpy(&length, &m_buffer[offset], sizeof(length));
+    }
+
+    m_frontSize = length;
+    *size = length;
+    return &m_buffer[offset + sizeof(unsigned)];
+}
+
+void CRingBuffer::pop(void)
+{
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    m_tail.store(tail + slotSize(m_frontSize), std::memory_order_release);
+}
+
+// -----------------------------------------------------------------------------
+// CTelemetryWriter
+// -----------------------------------------------------------------------------
+
+CTelemetryWriter::CTelemetryWriter(void)
+{
+    m_file = NULL;
+    m_ring = NULL;
+    m_quit = false;
+    m_stepId = 0;
+    m_dropped = 0;
+}
+
+CTelemetryWriter::~CTelemetryWriter(void)
+{
+    close();
+}
+
+bool CTelemetryWriter::open(const char* path, const CGameSession& session, size_t ringBytes)
+{
+    close();
+
+    m_file = fopen(path, "wb");
+    if (m_file == NULL)
+        return false;
+
+    TelemetryFileHeader header;
+    header.magic = TELEMETRY_MAGIC;
+    header.version = TELEMETRY_VERSION;
+    header.flags = session.hasRival() ? TELEMETRY_RIVAL : 0;
+    header.brickCount = (unsigned)session.getBrickCount();
+    fwrite(&header, sizeof(header), 1, m_file);
+    for (int i = 0; i < session.getBrickCount(); i++) {
+        float pos[2] = { session.getBrick(i).x, session.getBrick(i).z };
+        fwrite(pos, sizeof(pos), 1, m_file);
+    }
+
+    m_ring = new CRingBuffer(ringBytes);
+    m_stepId = 0;
+    m_dropped = 0;
+    m_previous.clear();
+    m_out.clear();
+    m_out.reserve(WRITE_BATCH * 2);
+
+    m_quit = false;
+    m_thread = std::thread(&CTelemetryWriter::writerLoop, this);
+    return true;
+}
+
+void CTelemetryWriter::close(void)
+{
+    if (m_file == NULL)
+        return;
+
+    m_quit = true;
+    m_thread.join();
+
+    fclose(m_file);
+    m_file = NULL;
+    delete m_ring;
+    m_ring = NULL;
+}
+
+void CTelemetryWriter::record(const CGameSession& session, float timeDelta)
+{
+    if (m_ring == NULL)
+        return;
+
+    // stored by BallId (see TelemetryStepHeader)
+    int extraCount = std::min(session.getExtraBallCount(), 0xffff - (int)BALL_EXTRA);
+    int ballCount = extraCount > 0 ? BALL_EXTRA + extraCount : session.hasRival() ? BALL_RIVAL + 1 : BALL_WHITE + 1;
+    int contactCount = session.getContactCount();
+    size_t size = sizeof(TelemetryStepHeader)
+        + ballCount * sizeof(TelemetryBall)
+        + contactCount * sizeof(ContactEvent);
+
+    unsigned char* p = (unsigned char*)m_ring->reserve(size);
+    if (p == NULL) {
+        m_dropped++;
+        m_stepId++;
+        return;
+    }
+
+    TelemetryStepHeader* header = (TelemetryStepHeader*)p;
+    header->size = (unsigned)size;
+    header->stepId = m_stepId++;
+    header->timeDelta = timeDelta;
+    header->ballCount = (unsigned short)ballCount;
+    header->contactCount = (unsigned short)contactCount;
+
+    TelemetryBall* balls = (TelemetryBall*)(header + 1);
+    const BallState* extra = session.getExtraBalls();
+    for (int i = 0; i < ballCount; i++) {
+        const BallState& ball = i == BALL_RED ? session.getRedBall() : i == BALL_WHITE ? session.getWhiteBall()
+            : i == BALL_RIVAL ? session.getRivalBall() : extra[i - BALL_EXTRA];
+        balls[i].x = ball.x;
+        balls[i].z = ball.z;
+        balls[i].vx = ball.vx;
+        balls[i].vz = ball.vz;
+    }
+
+    ContactEvent* contacts = (ContactEvent*)(balls + ballCount);
+    for (int i = 0; i < contactCount; i++)
+        contacts[i] = session.getContact(i);
+
+    m_ring->commit();
+}
+
+void CTelemetryWriter::writerLoop(void)
+{
+    while (!m_quit) {
+        drain();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    drain();
+    flush();
+}
+
+void CTelemetryWriter::drain(void)
+{
+    size_t size;
+    const void* record;
+    while ((record = m_ring->front(&size)) != NULL) {
+        compress((const unsigned char*)record, size);
+        m_ring->pop();
+        if (m_out.size() >= WRITE_BATCH)
+            flush();
+    }
+}
+
+// each record is stored as a varint length followed by the record XORed with
+// the previous one, where zero runs (unchanged bytes) collapse to two bytes
+void CTelemetryWriter::compress(const unsigned char* record, size_t size)
+{
+    size_t n = size;
+    while (n >= 0x80) {
+        m_out.push_back((unsigned char)(n | 0x80));
+        n >>= 7;
+    }
+    m_out.push_back((unsigned char)n);
+
+    if (m_previous.size() < size)
+        m_previous.resize(size, 0);
+
+    size_t i = 0;
+    while (i < size) {
+        unsigned char b = record[i] ^ m_previous[i];
+        if (b != 0) {
+            m_out.push_back(b);
+            i++;
+            continue;
+        }
+        size_t run = 1;
+        while (i + run < size && run < 255 && record[i + run] == m_previous[i + run])
+            run++;
+        m_out.push_back(0);
+        m_out.push_back((unsigned char)run);
+        i += run;
+    }
+
+    memcpy(&m_previous[0], record, size);
+}
+
+void CTelemetryWriter::flush(void)
+{
+    if (!m_out.empty()) {
+        fwrite(&m_out[0], 1, m_out.size(), m_file);
+        m_out.clear();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// CTelemetryReader
+// -----------------------------------------------------------------------------
+
+CTelemetryReader::CTelemetryReader(void)
+{
+    m_file = NULL;
+    m_flags = 0;
+}
+
+CTelemetryReader::~CTelemetryReader(void)
+{
+    close();
+}
+
+bool CTelemetryReader::open(const char* path)
+{
+    close();
+
+    m_file = fopen(path, "rb");
+    if (m_file == NULL)
+        return false;
+
+    TelemetryFileHeader header;
+    if (fread(&header, sizeof(header), 1, m_file) != 1 ||
+        header.magic != TELEMETRY_MAGIC || header.version != TELEMETRY_VERSION) {
+        close();
+        return false;
+    }
+
+    m_flags = header.flags;
+    m_bricks.resize(header.brickCount * 2);
+    if (header.brickCount > 0 &&
+        fread(&m_bricks[0], sizeof(float) * 2, header.brickCount, m_file) != header.brickCount) {
+        close();
+        return false;
+    }
+
+    m_record.clear();
+    return true;
+}
+
+void CTelemetryReader::close(void)
+{
+    if (m_file != NULL) {
+        fclose(m_file);
+        m_file = NULL;
+    }
+    m_bricks.clear();
+}
+
+bool CTelemetryReader::next(const TelemetryStepHeader** header, const TelemetryBall** balls, const ContactEvent** contacts)
+{
+    if (m_file == NULL)
+        return false;
+
+    size_t size = 0;
+    int shift = 0;
+    int c;
+    do {
+        c = fgetc(m_file);
+        if (c == EOF)
+            return false;
+        size |= (size_t)(c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+
+    if (size < sizeof(TelemetryStepHeader))
+        return false;
+
+    if (m_record.size() < size)
+        m_record.resize(size, 0);
+
+    size_t i = 0;
+    while (i < size) {
+        c = fgetc(m_file);
+        if (c == EOF)
+            return false;
+        if (c != 0) {
+            m_record[i++] ^= (unsigned char)c;
+            continue;
+        }
+        c = fgetc(m_file);
+        if (c == EOF || c == 0)
+            return false;
+        i += c;
+    }
+
+    const TelemetryStepHeader* h = (const TelemetryStepHeader*)&m_record[0];
+    *header = h;
+    *balls = (const TelemetryBall*)(h + 1);
+    *contacts = (const ContactEvent*)(*balls + h->ballCount);
+    return true;
+}
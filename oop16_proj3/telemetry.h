@@ -0,0 +1,170 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: telemetry.h
+//
+// Desc: Per-step world state recording for offline analysis.
+//
+//       The simulation thread reserves space for a packed step record directly
+//       inside a lock-free single-producer / single-consumer ring buffer, fills
+//       it in place and commits it. A background writer thread drains the ring,
+//       delta-compresses each record against the previous one and writes the
+//       result to disk in large batches. When the ring is full the record is
+//       dropped and counted rather than stalling the simulation.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __telemetryH__
+#define __telemetryH__
+
+#include "gameSession.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstddef>
+
+// -----------------------------------------------------------------------------
+// Record layout (all little endian, packed to 4 bytes)
+// -----------------------------------------------------------------------------
+
+const unsigned TELEMETRY_MAGIC = 0x4d544c42;  // "BLTM"
+const unsigned TELEMETRY_VERSION = 3;
+
+// TelemetryFileHeader::flags
+const unsigned TELEMETRY_RIVAL = 1;     // the session has a rival paddle
+
+struct TelemetryFileHeader
+{
+    unsigned magic;
+    unsigned version;
+    unsigned flags;
+    unsigned brickCount;        // followed by brickCount * (x, z) floats
+};
+
+struct TelemetryStepHeader
+{
+    unsigned size;              // whole record in bytes, header included
+    unsigned stepId;
+    float    timeDelta;
+    unsigned short ballCount;   // followed by ballCount * TelemetryBall
+    unsigned short contactCount;// followed by contactCount * ContactEvent
+};
+
+// the balls of a step are stored by BallId, so the ids in its contacts index
+// them directly : red, white, the rival slot, then the extra balls. a step
+// without extra balls ends after white, or after the rival when the file has
+// TELEMETRY_RIVAL. without that flag the rival slot is only a placeholder
+
+struct TelemetryBall
+{
+    float x, z;
+    float vx, vz;
+};
+
+// -----------------------------------------------------------------------------
+// CRingBuffer : lock-free SPSC byte ring
+// -----------------------------------------------------------------------------
+
+class CRingBuffer {
+public:
+    // capacity is rounded up to a power of two
+    explicit CRingBuffer(size_t capacity);
+
+    // producer side. reserve() returns 'size' contiguous bytes inside the ring
+    // or NULL when the ring is full; commit() publishes them to the consumer
+    void* reserve(size_t size);
+    void  commit(void);
+
+    // consumer side. front() returns the oldest committed record or NULL when
+    // the ring is empty; pop() hands its space back to the producer
+    const void* front(size_t* size);
+    void  pop(void);
+
+    size_t getCapacity(void) const { return m_buffer.size(); }
+
+    // plain new only honors alignas(64) from C++17 on
+    static void* operator new(size_t size);
+    static void  operator delete(void* p);
+
+private:
+    std::vector<unsigned char>  m_buffer;
+    size_t                      m_mask;
+
+    // head is written only by the producer, tail only by the consumer. they
+    // sit on separate cache lines so the two threads don't fight over them
+    alignas(64) std::atomic<size_t> m_head;
+    size_t                          m_reserved;
+    alignas(64) std::atomic<size_t> m_tail;
+    size_t                          m_frontSize;
+};
+
+// -----------------------------------------------------------------------------
+// CTelemetryWriter
+// -----------------------------------------------------------------------------
+
+class CTelemetryWriter {
+public:
+    CTelemetryWriter(void);
+    ~CTelemetryWriter(void);
+
+    // opens the file, writes the brick layout and starts the writer thread
+    bool open(const char* path, const CGameSession& session, size_t ringBytes = 8 << 20);
+    // drains whatever is left in the ring and closes the file
+    void close(void);
+
+    bool isOpen(void) const { return m_file != NULL; }
+
+    // simulation thread: pack the session state after a step into the ring
+    void record(const CGameSession& session, float timeDelta);
+
+    unsigned getDropped(void) const { return m_dropped; }
+
+private:
+    CTelemetryWriter(const CTelemetryWriter&);
+    CTelemetryWriter& operator=(const CTelemetryWriter&);
+
+    void writerLoop(void);
+    void drain(void);
+    void compress(const unsigned char* record, size_t size);
+    void flush(void);
+
+    FILE*                       m_file;
+    CRingBuffer*                m_ring;
+    std::thread                 m_thread;
+    std::atomic<bool>           m_quit;
+
+    unsigned                    m_stepId;
+    unsigned                    m_dropped;
+
+    // writer thread only
+    std::vector<unsigned char>  m_previous;
+    std::vector<unsigned char>  m_out;
+};
+
+// -----------------------------------------------------------------------------
+// CTelemetryReader : decodes a file written by CTelemetryWriter
+// -----------------------------------------------------------------------------
+
+class CTelemetryReader {
+public:
+    CTelemetryReader(void);
+    ~CTelemetryReader(void);
+
+    bool open(const char* path);
+    void close(void);
+
+    bool hasRival(void) const { return (m_flags & TELEMETRY_RIVAL) != 0; }
+    int getBrickCount(void) const { return (int)m_bricks.size() / 2; }
+    const float* getBrickPositions(void) const { return m_bricks.empty() ? NULL : &m_bricks[0]; }
+
+    // decodes the next step. the pointers stay valid until the next call
+    bool next(const TelemetryStepHeader** header, const TelemetryBall** balls, const ContactEvent** contacts);
+
+private:
+    FILE*                       m_file;
+    unsigned                    m_flags;
+    std::vector<float>          m_bricks;
+    std::vector<unsigned char>  m_record;
+};
+
+#endif // __telemetryH__
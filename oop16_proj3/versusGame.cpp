@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: versusGame.cpp
+//
+// Desc: Two-player versus rules on top of CGameSession.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "versusGame.h"
+
+static Segment versusSegment(float x0, float z0, float x1, float z1, unsigned short flags)
+{
+    Segment s;
+    s.x0 = x0;  s.z0 = z0;
+    s.x1 = x1;  s.z1 = z1;
+    s.flags = flags;
+    return s;
+}
+
+void makeVersusLevel(LevelData& level)
+{
+    // the inner faces of the stock walls
+    const float halfWidth = 3.0f;
+    const float halfDepth = 4.44f;
+
+    level.boundary.clear();
+    level.boundary.push_back(versusSegment(-halfWidth, -halfDepth, halfWidth, -halfDepth, SEGMENT_DEADLY));
+    level.boundary.push_back(versusSegment(halfWidth, -halfDepth, halfWidth, halfDepth, 0));
+    level.boundary.push_back(versusSegment(halfWidth, halfDepth, -halfWidth, halfDepth, SEGMENT_DEADLY));
+    level.boundary.push_back(versusSegment(-halfWidth, halfDepth, -halfWidth, -halfDepth, 0));
+
+    // a gapped row across the middle
+    level.brickX.clear();
+    level.brickZ.clear();
+    const float row[6] = { -2.1f, -1.26f, -0.42f, 0.42f, 1.26f, 2.1f };
+    for (int i = 0; i < 6; i++) {
+        level.brickX.push_back(row[i]);
+        level.brickZ.push_back(0.0f);
+    }
+
+    level.startX = 0.0f;
+    level.startZ = 4.2f;
+}
+
+CVersusGame::CVersusGame(void)
+{
+    makeVersusLevel(m_level);
+    m_session.setRival(true);
+    m_session.load(&m_level);
+    m_score[0] = 0;
+    m_score[1] = 0;
+}
+
+void CVersusGame::reset(void)
+{
+    m_session.reset();
+    m_score[0] = 0;
+    m_score[1] = 0;
+}
+
+void CVersusGame::step(const VersusInput inputs[2])
+{
+    // the rival looks at the table from the other end, so its left is our right
+    m_session.moveWhiteBall(inputs[0].move);
+    m_session.moveRivalBall(-inputs[1].move);
+    if ((inputs[0].buttons & VERSUS_SHOOT) && m_session.isStarted())
+        m_session.shoot();
+
+    m_session.step(VERSUS_TICK_DELTA);
+
+    if (m_session.isRestart()) {
+        // the end wall the red ball reached : its normal points back into the table
+        for (int i = 0; i < m_session.getContactCount(); i++) {
+            const ContactEvent& c = m_session.getContact(i);
+            if (c.kind == CONTACT_WALL && c.a == BALL_RED && m_session.isDeadlyWall(c.b)) {
+                m_score[c.nz < 0.0f ? 1 : 0]++;
+                break;
+            }
+        }
+        m_session.reset();
+    }
+    else if (m_session.isComplete()) {
+        // the middle row is gone : put it back and serve again, nobody scores
+        m_session.reset();
+    }
+}
+
+void CVersusGame::save(VersusState& state) const
+{
+    m_session.saveSnapshot(state.session);
+    state.score[0] = m_score[0];
+    state.score[1] = m_score[1];
+}
+
+void CVersusGame::load(const VersusState& state)
+{
+    m_session.loadSnapshot(state.session);
+    m_score[0] = state.score[0];
+    m_score[1] = state.score[1];
+}
+
+unsigned versusChecksum(const VersusState& state)
+{
+    unsigned hash = snapshotChecksum(state.session);
+    for (int i = 0; i < 2; i++)
+        hash = (hash ^ (unsigned)state.score[i]) * 16777619u;
+    return hash;
+}
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: versusGame.h
+//
+// Desc: Two-player versus rules on top of CGameSession. Player 0 moves the
+//       white ball at the bottom end of the table, player 1 the rival ball
+//       at the top end. The red ball is served by player 0 and bounces
+//       between the two paddles; whoever lets it reach their own end wall
+//       gives the other player a point. A short row of bricks in the middle
+//       is in the way and is rebuilt when it is cleared.
+//
+//       The game only moves forward in fixed ticks driven by the inputs of
+//       both players, and its whole state fits in a VersusState, so a
+//       rollback session (rollback.h) can save, restore and replay it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __versusGameH__
+#define __versusGameH__
+
+#include "gameSession.h"
+
+// simulated time of one tick : the window app's step at 60 fps
+const float VERSUS_TICK_DELTA = 0.0112f;
+
+// input buttons
+const unsigned char VERSUS_SHOOT = 1;   // serve, only player 0 while the red ball waits
+
+// what one player did in one tick
+struct VersusInput
+{
+    signed char     move;       // paddle movement in mouse pixels, as seen from the player's own end
+    unsigned char   buttons;
+};
+
+inline bool operator==(const VersusInput& a, const VersusInput& b)
+{
+    return a.move == b.move && a.buttons == b.buttons;
+}
+inline bool operator!=(const VersusInput& a, const VersusInput& b) { return !(a == b); }
+
+struct VersusState
+{
+    SessionSnapshot session;
+    int             score[2];
+};
+
+// FNV-1a of the table and the score
+unsigned versusChecksum(const VersusState& state);
+
+// the versus table : the stock table size with deadly walls at both ends
+void makeVersusLevel(LevelData& level);
+
+class CVersusGame {
+public:
+    CVersusGame(void);
+
+    // both players' input for the next tick
+    void step(const VersusInput inputs[2]);
+
+    void save(VersusState& state) const;
+    void load(const VersusState& state);
+
+    // start over at 0 : 0
+    void reset(void);
+
+    // physics values of both peers must be the same for a rollback session to agree
+    void setConfig(const PhysicsConfig& config) { m_session.setConfig(config); }
+
+    const CGameSession& getSession(void) const { return m_session; }
+    int getScore(int player) const { return m_score[player]; }
+
+private:
+    CVersusGame(const CVersusGame&);                // the session points into m_level
+    CVersusGame& operator=(const CVersusGame&);
+
+    LevelData       m_level;
+    CGameSession    m_session;
+    int             m_score[2];
+};
+
+#endif // __versusGameH__
@@ -2,7 +2,7 @@
 //
 // File: virtualLego.cpp
 //
-// Original Author: â Chang-hyeon Park, 
+// Original Author: 박창현 Chang-hyeon Park, 
 // Modified by Bong-Soo Sohn and Dong-Jun Kim
 // 
 // Originally programmed for Virtual LEGO. 
@@ -11,54 +11,43 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "d3dUtility.h"
+#include "gameSession.h"
+#include "telemetry.h"
+#include "stateExport.h"
+#include "aimPreview.h"
+#include "renderQueue.h"
+#include "frustum.h"
+#include "ballBatch.h"
+#include "particleBatch.h"
+#include "framePacer.h"
+#include "levelGen.h"
+#include "levelLoader.h"
 #include <vector>
 #include <ctime>
 #include <cstdlib>
 #include <cstdio>
 #include <cassert>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
 
-// Direct3D ġ ü Ű  -  ۾ ߽ 
-// ׷ ü ϰ ȯϰų ȭ鿡   
+// Direct3D 장치 객체를 가리키는 포인터 - 렌더링 작업의 중심 역할
+// 그래픽 객체를 생성하고 변환하거나 화면에 렌더링할 때 사용
 IDirect3DDevice9* Device = NULL;
 
 // window size
 const int Width = 1024;
 const int Height = 1024;
-const float MIN_VELOCITY = 2;
-
-bool complete = false;   // 
-bool restart = false;    // 絵  
-
-// initialize the position (coordinate) of each ball
-const float spherePos[36][2] = {
-    
-    // ü Ʋ
-    {-1.47f,-4}, {-1.05f,-4}, {-0.63f,-4}, {-0.21f,-4}, {0.21f,-4}, {0.63f,-4}, {1.05f,-4}, {1.47f,-4},
-    {-1.89f, -3.58f}, {1.89f, -3.58f},
-    {-2.31f, -3.16f}, {-2.31f, -2.74f}, {-2.31f, -2.32f}, {-2.31f, -1.9f}, {-2.31f, -1.48f}, {-2.31f, -1.06f},
-    {2.31f, -3.16f}, {2.31f, -2.74f}, {2.31f, -2.32f}, {2.31f, -1.9f}, {2.31f, -1.48f}, {2.31f, -1.06f}, 
-    // 
-    {-1.05f,-2.74f}, {-1.05f,-2.32f}, {1.05f,-2.74f}, {1.05f,-2.32f},
-    // 
-    {0, -1.48f}, {0, -1.06f},
-    // 
-    {-1.47f, -0.64f}, {-1.05f,-0.22f}, {-0.63f,0.2f}, {-0.21f,0.2f}, {0.21f,0.2f}, {0.63f,0.2f}, {1.05f,-0.22f}, {1.47f, -0.64f}
-   
-};
+
 // initialize the color of each ball
 const D3DXCOLOR sphereColor = { d3d::YELLOW };
 
 // -----------------------------------------------------------------------------
 // Transform matrices
 // -----------------------------------------------------------------------------
-D3DXMATRIX g_mWorld;   // ü ȸ, ̵, ũ   ȯ 
-D3DXMATRIX g_mView;    // ī޶ ġ    -> 鿡 ü   
-D3DXMATRIX g_mProj;    //  ̳ 翵  ȭ鿡 ׸  
-
-#define M_RADIUS 0.21   // ball radius
-#define PI 3.14159265
-#define M_HEIGHT 0.01
-#define DECREASE_RATE 0.9982// ӵ  -  /  ȿ ùķ̼ 0.9982
+D3DXMATRIX g_mWorld;   // 객체의 회전, 이동, 크기 조정과 같은 변환 정의
+D3DXMATRIX g_mView;    // 카메라 위치 및 방향 설정 -> 장면에서 물체를 보는 시점 정의
+D3DXMATRIX g_mProj;    // 원근 투영이나 정사영 방식으로 화면에 그릴 때 사용
 
 // -----------------------------------------------------------------------------
 // CSphere class definition
@@ -68,18 +57,16 @@ class CSphere {
 private:
     float               center_x, center_y, center_z;
     float                   m_radius;
-    float               m_velocity_x;
-    float               m_velocity_z;
 
 public:
     CSphere(void)
     {
         D3DXMatrixIdentity(&m_mLocal);
         ZeroMemory(&m_mtrl, sizeof(m_mtrl));
+        center_x = center_y = center_z = 0;
+        m_dirty = false;
         m_radius = 0;
-        m_velocity_x = 0;
-        m_velocity_z = 0;
-        m_pSphereMesh = NULL;   // ü ׷ ǥ  Direct3D ޽ 
+        m_pSphereMesh = NULL;   // 구체의 그래픽 표현을 위한 Direct3D 메쉬 포인터
     }
     ~CSphere(void) {}
 
@@ -96,174 +83,78 @@ public:
         m_mtrl.Emissive = d3d::BLACK;
         m_mtrl.Power = 5.0f;
 
-        if (FAILED(D3DXCreateSphere(pDevice, getRadius(), 50, 50, &m_pSphereMesh, NULL)))
-            return false;
+        // every ball has the same radius, so they all draw one shared mesh
+        if (s_pSharedMesh == NULL) {
+            if (FAILED(D3DXCreateSphere(pDevice, getRadius(), 50, 50, &s_pSharedMesh, NULL)))
+                return false;
+        }
+        s_sharedRefs++;
+        m_pSphereMesh = s_pSharedMesh;
+        m_bounds._center = D3DXVECTOR3(0, 0, 0);
+        m_bounds._radius = getRadius();
         return true;
     }
 
     void destroy(void)
     {
         if (m_pSphereMesh != NULL) {
-            m_pSphereMesh->Release();
             m_pSphereMesh = NULL;
+            if (--s_sharedRefs == 0) {
+                s_pSharedMesh->Release();
+                s_pSharedMesh = NULL;
+            }
         }
-        m_velocity_x = 0;
-        m_velocity_z = 0;
     }
 
-    // ü  
-    void draw(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld)
+    // 그리기 대신 render queue에 추가
+    void enqueue(CRenderQueue& queue) const
     {
-        if (NULL == pDevice)
-            return;
-        pDevice->SetTransform(D3DTS_WORLD, &mWorld);  //  ǥ踦 
-        pDevice->MultiplyTransform(D3DTS_WORLD, &m_mLocal);  //  ǥ踦 ߰ 
-        pDevice->SetMaterial(&m_mtrl);  // ü   ȿ 
-        m_pSphereMesh->DrawSubset(0);   // ü ޽ ù °  ׸
+        queue.add(m_pSphereMesh, m_mtrl, getLocalTransform(), m_bounds);
     }
 
-    bool hasIntersected(CSphere& ball)
-    {
-        //   ߽ ǥ
-        D3DXVECTOR3 center_this = this->getCenter();
-        D3DXVECTOR3 center_ball = ball.getCenter();
-
-        //   
-        float radius_this = this->getRadius();
-        float radius_ball = ball.getRadius();
-
-        //  ߽  Ÿ
-        float distanceSquared =
-            (center_this.x - center_ball.x) * (center_this.x - center_ball.x) +
-            (center_this.y - center_ball.y) * (center_this.y - center_ball.y) +
-            (center_this.z - center_ball.z) * (center_this.z - center_ball.z);
-
-        // 浹  Ǵ
-        float radiusSum = radius_this + radius_ball;
-        return distanceSquared <= (radiusSum * radiusSum);
-    }
+    float getRadius(void)  const { return (float)(M_RADIUS); }
 
-    void hitBy(CSphere& ball)
+    // the matrix is only rebuilt here, when the center moved since the last call
+    const D3DXMATRIX& getLocalTransform(void) const
     {
-        if (this->hasIntersected(ball)) {
-            // 浹  ߽ ǥ 
-            D3DXVECTOR3 redCenter = ball.getCenter();    //  
-            D3DXVECTOR3 yellowCenter = this->getCenter(); //  
-            float yellowRadius = this->getRadius();
-
-            // ߽  Ÿ 
-            float dx = redCenter.x - yellowCenter.x;
-            float dz = redCenter.z - yellowCenter.z;
-
-            // ݻ   ( ͷ ȭ)
-            float magnitude = sqrt(dx * dx + dz * dz);
-            float nx = dx / magnitude; // x  ݻ 
-            float nz = dz / magnitude; // z  ݻ 
-
-            //    ӵ 
-            float redVelocityX = ball.getVelocity_X();
-            float redVelocityZ = ball.getVelocity_Z();
-
-            // ӵ  ݻ ͸  
-            float newVelocityX = -2 * nx * (nx * redVelocityX + nz * redVelocityZ) + redVelocityX;
-            float newVelocityZ = -2 * nz * (nx * redVelocityX + nz * redVelocityZ) + redVelocityZ;
-
-            ball.setPower(newVelocityX, newVelocityZ);
-        }
-        else {
-            return;
+        if (m_dirty) {
+            D3DXMatrixTranslation(&m_mLocal, center_x, center_y, center_z);
+            m_dirty = false;
         }
+        return m_mLocal;
     }
 
-    void ballUpdate(float timeDiff)
-    {
-        const float TIME_SCALE = 3.3;
-        D3DXVECTOR3 cord = this->getCenter();
-        double vx = abs(this->getVelocity_X());
-        double vz = abs(this->getVelocity_Z());
-
-        if (vx > 0.01 || vz > 0.01)
-        {
-            float tX = cord.x + TIME_SCALE * timeDiff * m_velocity_x;
-            float tZ = cord.z + TIME_SCALE * timeDiff * m_velocity_z;
-
-            this->setCenter(tX, cord.y, tZ);
-        }
-
-        else {
-            this->setPower(0, 0);
-        }
-        this->setPower(this->getVelocity_X() * DECREASE_RATE, this->getVelocity_Z() * DECREASE_RATE);
-        double rate = 1 - (1 - DECREASE_RATE) * timeDiff * 400;
-        if (rate < 0)
-            rate = 0;
-
-        float newVelocityX = getVelocity_X() * rate;
-        float newVelocityZ = getVelocity_Z() * rate;
-
-        float mul = 1.1f;
-
-        if (newVelocityX >= MIN_VELOCITY && newVelocityZ >= MIN_VELOCITY) {
-            this->setPower(newVelocityX, newVelocityZ);
-        }
-        else if (newVelocityX < MIN_VELOCITY && newVelocityZ >= MIN_VELOCITY) {
-            this->setPower(newVelocityX * mul, newVelocityZ);
-        }
-        else if (newVelocityX >= MIN_VELOCITY && newVelocityZ < MIN_VELOCITY) {
-            this->setPower(newVelocityX, newVelocityZ * mul);
-        }
-        else {
-            this->setPower(newVelocityX * mul, newVelocityZ * mul);
-        }
-
-        // ӵ ʹ  ʵ Ѱ谪 α
-        float maxSpeed = 5.0f;  // ִ ӵ (ʿ信  )
-        float currentSpeed = sqrt(newVelocityX * newVelocityX + newVelocityZ * newVelocityZ);
-        if (currentSpeed > maxSpeed) {
-            // ִ ӵ  ʵ 
-            float speedFactor = maxSpeed / currentSpeed;
-            newVelocityX *= speedFactor;
-            newVelocityZ *= speedFactor;
-            this->setPower(newVelocityX, newVelocityZ);
-        }
-    }
-
-    double getVelocity_X() { return this->m_velocity_x; }
-    double getVelocity_Z() { return this->m_velocity_z; }
-
-    float getRadius(void)  const { return (float)(M_RADIUS); }
-
-    const D3DXMATRIX& getLocalTransform(void) const { return m_mLocal; }
-
     D3DXVECTOR3 getCenter(void) const
     {
         D3DXVECTOR3 org(center_x, center_y, center_z);
         return org;
     }
 
-    void setPower(double vx, double vz)
-    {
-        this->m_velocity_x = vx;
-        this->m_velocity_z = vz;
-    }
-
+    // position only. the transform follows lazily in getLocalTransform()
     void setCenter(float x, float y, float z)
     {
-        D3DXMATRIX m;
+        if (x == center_x && y == center_y && z == center_z)
+            return;
         center_x = x;   center_y = y;   center_z = z;
-        D3DXMatrixTranslation(&m, x, y, z);
-        setLocalTransform(m);
+        m_dirty = true;
     }
 
-    void setLocalTransform(const D3DXMATRIX& mLocal) { m_mLocal = mLocal; }
+    void setLocalTransform(const D3DXMATRIX& mLocal) { m_mLocal = mLocal; m_dirty = false; }
 
 private:
-    D3DXMATRIX              m_mLocal;
+    mutable D3DXMATRIX      m_mLocal;
+    mutable bool            m_dirty;    // center changed since m_mLocal was built
     D3DMATERIAL9            m_mtrl;
+    d3d::BoundingSphere     m_bounds;   // around the mesh, for culling
     ID3DXMesh* m_pSphereMesh;
 
+    static ID3DXMesh*       s_pSharedMesh;
+    static int              s_sharedRefs;
 };
 
+ID3DXMesh* CSphere::s_pSharedMesh = NULL;
+int CSphere::s_sharedRefs = 0;
+
 
 // -----------------------------------------------------------------------------
 // CWall class definition
@@ -303,6 +194,8 @@ public:
 
         m_width = iwidth;
         m_depth = idepth;
+        m_bounds._center = D3DXVECTOR3(0, 0, 0);
+        m_bounds._radius = 0.5f * sqrtf(iwidth * iwidth + iheight * iheight + idepth * idepth);
 
         if (FAILED(D3DXCreateBox(pDevice, iwidth, iheight, idepth, &m_pBoundMesh, NULL)))
             return false;
@@ -315,133 +208,21 @@ public:
             m_pBoundMesh = NULL;
         }
     }
-    void draw(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld)
-    {
-        if (NULL == pDevice)
-            return;
-        pDevice->SetTransform(D3DTS_WORLD, &mWorld);
-        pDevice->MultiplyTransform(D3DTS_WORLD, &m_mLocal);
-        pDevice->SetMaterial(&m_mtrl);
-        m_pBoundMesh->DrawSubset(0);
-    }
-
-    bool hasIntersected(CSphere& ball)
+    void enqueue(CRenderQueue& queue) const
     {
-        //  ߽ ǥ
-        D3DXVECTOR3 ballCenter = ball.getCenter();
-        float ballRadius = ball.getRadius();
-
-        //  
-        float wallLeft = m_x - m_width / 2.0f;
-        float wallRight = m_x + m_width / 2.0f;
-        float wallTop = m_z - m_depth / 2.0f;
-        float wallBottom = m_z + m_depth / 2.0f;
-
-        //   Ѿ Ȯ
-        bool hitX = (ballCenter.x - ballRadius < wallRight) && (ballCenter.x + ballRadius > wallLeft);
-        bool hitZ = (ballCenter.z - ballRadius < wallBottom) && (ballCenter.z + ballRadius > wallTop);
-
-        // 浹  ȯ
-        return hitX && hitZ;
-    }
-
-    void hitBy(CSphere& ball) {
-        if (this->hasIntersected(ball)) {
-            //  ߽ ǥ  
-            D3DXVECTOR3 ballCenter = ball.getCenter();
-            float ballRadius = ball.getRadius();
-
-            //    
-            const float wallRight = -3.0f;
-            const float wallLeft = 3.0f;
-            const float wallTop = -4.44f;
-            const float wallBottom = 4.44f;
-
-            D3DXVECTOR3 wallNormal = { 0.0f, 0.0f, 0.0f };
-            float overlap = 0.0f; // ħ Ÿ
-            int wallType = 0;
-
-            //    ħ Ÿ 
-            if (ballCenter.x <= wallRight + ballRadius) {         //  
-                wallNormal = { 1.0f, 0.0f, 0.0f };
-                overlap = wallRight + ballRadius - ballCenter.x;  // X  ħ Ÿ
-                wallType = 1;
-            }
-            else if (ballCenter.x >= wallLeft - ballRadius) {     //  
-                wallNormal = { -1.0f, 0.0f, 0.0f };
-                overlap = ballCenter.x - (wallLeft - ballRadius); // X  ħ Ÿ
-                wallType = 1;
-            }
-            else if (ballCenter.z <= wallTop + ballRadius) {      //  
-                wallNormal = { 0.0f, 0.0f, -1.0f };
-                overlap = wallTop + ballRadius - ballCenter.z;    // Z  ħ Ÿ
-                wallType = 1;
-            }
-            else if (ballCenter.z >= wallBottom - ballRadius) {   // Ʒ 
-                wallNormal = { 0.0f, 0.0f, 1.0f };
-                overlap = ballCenter.z - (wallBottom - ballRadius); // Z  ħ Ÿ
-                wallType = 2; // Ʒ   ߰  ó 
-            }
-
-            //  ӵ 
-            float velocityX = ball.getVelocity_X();
-            float velocityZ = ball.getVelocity_Z();
-            D3DXVECTOR3 velocity = { velocityX, 0.0f, velocityZ }; // ӵ 3D ͷ 
-
-            //  ߴٸ ̵ 
-            if (overlap > 0.0f) {
-                //  Ÿ 
-                float penetrationCorrection = overlap / (abs(velocityX) + abs(velocityZ));
-                ball.setCenter(
-                    ballCenter.x - velocityX * penetrationCorrection,
-                    ballCenter.y,
-                    ballCenter.z - velocityZ * penetrationCorrection
-                );
-            }
-
-            //    ó
-            switch (wallType) {
-            case 0:
-                return;
-            case 1:
-            {
-                // ݻ   (R = V - 2 * (V  N) * N)
-                float dotProduct = velocity.x * wallNormal.x + velocity.z * wallNormal.z;
-                D3DXVECTOR3 reflection = {
-                    velocity.x - 2 * dotProduct * wallNormal.x,
-                    0.0f, // y  
-                    velocity.z - 2 * dotProduct * wallNormal.z };
-
-                if (sqrt(reflection.x * reflection.x + reflection.z * reflection.z) < MIN_VELOCITY) {
-                    reflection.x *= (MIN_VELOCITY / fabs(reflection.x));
-                    reflection.z *= (MIN_VELOCITY / fabs(reflection.z));
-                }
-
-                //  ӵ  
-                ball.setPower(reflection.x, reflection.z);
-                break;
-            }
-
-            case 2: // Ʒ 
-            {
-                restart = true;
-                break;
-            }
-            default:
-                printf("error");
-                break;
-            }
-        }
+        queue.add(m_pBoundMesh, m_mtrl, m_mLocal, m_bounds);
     }
 
-    void setPosition(float x, float y, float z)
+    void setPosition(float x, float y, float z, float yaw = 0.0f)
     {
         D3DXMATRIX m;
+        D3DXMATRIX r;
         this->m_x = x;
         this->m_z = z;
 
+        D3DXMatrixRotationY(&r, yaw);
         D3DXMatrixTranslation(&m, x, y, z);
-        setLocalTransform(m);
+        setLocalTransform(r * m);
     }
 
     float getHeight(void) const { return M_HEIGHT; }
@@ -451,6 +232,7 @@ private:
 
     D3DXMATRIX              m_mLocal;
     D3DMATERIAL9            m_mtrl;
+    d3d::BoundingSphere     m_bounds;   // around the box, for culling
     ID3DXMesh* m_pBoundMesh;
 };
 
@@ -541,34 +323,209 @@ private:
 };
 
 
+// -----------------------------------------------------------------------------
+// TableScene : render objects of one table
+// -----------------------------------------------------------------------------
+
+// placement of one visible wall or cushion box
+struct WallLayout
+{
+    float x, z;
+    float width, depth;
+    float yaw;
+};
+
+// the scene on screen and the one being built for the next level are two of
+// these. buildScene() creates the objects a few at a time
+struct TableScene
+{
+    CWall                   plane;
+    std::vector<WallLayout> layout;
+    std::vector<CWall>      walls;      // visible stock walls or cushions
+    std::vector<CSphere>    bricks;
+    int                     built;      // objects created so far, the plane first
+};
+
 // -----------------------------------------------------------------------------
 // Global variables
 // -----------------------------------------------------------------------------
-CWall   g_legoPlane;             // 籸 
-CWall   g_legowall[4];           // 籸 4 
-std::vector<CSphere> g_sphere;   // 籸ǿ ִ 
-int spherenum = 0;
+CGameSession g_session;          // 게임 상태 (물리 / 규칙)
+CTelemetryWriter g_telemetry;    // per-step recording, enabled with -telemetry <file>
+CStateExport g_export;           // live state in shared memory, enabled with -export <name>
+CAimPreview g_aim;               // predicted red ball path while aiming
+CRenderQueue g_renderQueue;      // plane, walls and balls of the current frame
+CFrustum g_frustum;              // what the camera sees, objects outside are not drawn
+CBallBatch g_extraBalls;         // multi-ball extra balls, a few draws for all of them
+CParticleSystem g_particles;     // debris and sparks of broken bricks
+CParticleBatch g_particleBatch;  // streams the particles to point sprites
+CFramePacer g_pacer;             // frame rate cap (-fps <n>) and input latency statistics
+// objects drawn and culled, summed over the frames since the title was updated
+struct CullStats
+{
+    long long   frames;
+    long long   visible;
+    long long   culled;
+};
+CullStats g_cullStats = { 0, 0, 0 };
+float g_whiteBallInput = 0;      // mouse movement not yet applied to the white ball
+ShotSpin g_shotSpin = { 0, 0, 0 }; // spin of the next shot, set with the arrow keys
+PhysicsConfig g_config;          // physics values, from -config <file> when given
+CConfigWatcher g_configWatcher;  // reloads that file when it is saved
+TableScene g_scene[2];           // 당구판, 벽, 공 : the table on screen and the next one
+int g_front = 0;                 // g_scene[g_front] is drawn
+CLevelLoader g_loader;           // builds the next table on a background thread
+LoadedWorld* g_world = NULL;     // level of g_session (NULL : stock table)
+LoadedWorld* g_pending = NULL;   // loaded world waiting for its render objects
+std::string g_levelPath;         // -level <file>, reloaded with 'L'
+unsigned g_levelSeed = 0;        // last -generate seed, the next one comes with 'G'
+std::string g_telemetryPath;     // -telemetry waits for the first table when one is loading
 CSphere   g_target_redball;        // red ball
 CSphere g_whiteball;             // white ball 
 CLight   g_light;
 
-bool start = false;
-
 double g_camera_pos[3] = { 0.0, 5.0, -8.0 };
 
 // -----------------------------------------------------------------------------
 // Functions
 // -----------------------------------------------------------------------------
 
-void destroyAllLegoBlock(void)
+// time the render thread spends per frame on the next table's objects
+const double SCENE_BUILD_MS = 2.0;
+
+// copy a ball position from the game session into its render object
+void syncBall(CSphere& sphere, const BallState& ball)
 {
-    for (int i = 0; i < spherenum; i++) {
-        g_sphere[i].destroy();
+    sphere.setCenter(ball.x, ball.y, ball.z);
+}
+
+// a burst of debris and sparks for each brick the last step broke
+void emitBrickParticles(void)
+{
+    for (int i = 0; i < g_session.getRemovedCount(); i++) {
+        const BallState& brick = g_session.getBrick(g_session.getRemovedBrick(i));
+        g_particles.emit(brick.x, brick.y, brick.z, 48, PARTICLE_DEBRIS);
+        g_particles.emit(brick.x, brick.y, brick.z, 96, PARTICLE_SPARKS);
     }
-    spherenum = 0;
-    g_sphere.clear();
-    g_target_redball.destroy();
-    g_whiteball.destroy();
+}
+
+void destroyScene(TableScene& scene)
+{
+    scene.plane.destroy();
+    for (size_t i = 0; i < scene.walls.size(); i++) {
+        scene.walls[i].destroy();
+    }
+    for (size_t i = 0; i < scene.bricks.size(); i++) {
+        scene.bricks[i].destroy();
+    }
+    scene.layout.clear();
+    scene.walls.clear();
+    scene.bricks.clear();
+    scene.built = 0;
+}
+
+// create the render objects of 'session' into 'scene', continuing where the
+// last call stopped. returns 1 when the scene is complete, 0 when the time
+// budget ran out (budgetMs < 0 : no limit) and -1 on failure
+int buildScene(TableScene& scene, const CGameSession& session, double budgetMs)
+{
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    if (scene.built == 0) {
+        // create plane and set the position
+        if (session.hasCustomBoundary()) {
+            float minX, minZ, maxX, maxZ;
+            session.getBoundary().getBounds(&minX, &minZ, &maxX, &maxZ);
+            if (false == scene.plane.create(Device, -1, -1, maxX - minX, 0.03f, maxZ - minZ, d3d::GREEN)) return -1;
+            scene.plane.setPosition((minX + maxX) / 2, -0.0006f / 5, (minZ + maxZ) / 2);
+        }
+        else {
+            if (false == scene.plane.create(Device, -1, -1, 6, 0.03f, 9, d3d::GREEN)) return -1;
+            scene.plane.setPosition(0.0f, -0.0006f / 5, 0.0f);
+        }
+
+        // walls : one thin box per custom segment, or the stock walls. deadly
+        // segments stay invisible like the stock bottom wall
+        scene.layout.clear();
+        if (session.hasCustomBoundary()) {
+            const CBoundaryBVH& boundary = session.getBoundary();
+            for (int i = 0; i < boundary.getSegmentCount(); i++) {
+                const Segment& seg = boundary.getSegment(i);
+                if (seg.flags & SEGMENT_DEADLY)
+                    continue;
+                float dx = seg.x1 - seg.x0;
+                float dz = seg.z1 - seg.z0;
+                WallLayout wall = { (seg.x0 + seg.x1) / 2, (seg.z0 + seg.z1) / 2, (float)sqrt(dx * dx + dz * dz), 0.12f, (float)atan2(-dz, dx) };
+                scene.layout.push_back(wall);
+            }
+        }
+        else {
+            for (int i = 0; i < WALL_COUNT; i++) {
+                if (session.isDeadlyWall(i))
+                    continue;
+                const WallState& state = session.getWall(i);
+                WallLayout wall = { state.x, state.z, state.width, state.depth, 0.0f };
+                scene.layout.push_back(wall);
+            }
+        }
+        scene.walls.reserve(scene.layout.size());
+        scene.bricks.reserve(session.getBrickCount());
+        scene.built = 1;
+    }
+
+    int wallCount = (int)scene.layout.size();
+    int total = 1 + wallCount + session.getBrickCount();
+    while (scene.built < total) {
+        int i = scene.built - 1;
+        if (i < wallCount) {
+            const WallLayout& wall = scene.layout[i];
+            scene.walls.push_back(CWall());
+            if (false == scene.walls.back().create(Device, -1, -1, wall.width, 0.3f, wall.depth, d3d::DARKRED)) return -1;
+            scene.walls.back().setPosition(wall.x, 0.12f, wall.z, wall.yaw);
+        }
+        else {
+            i -= wallCount;
+            scene.bricks.push_back(CSphere());
+            if (false == scene.bricks.back().create(Device, sphereColor)) return -1;
+            syncBall(scene.bricks.back(), session.getBrick(i));
+        }
+        scene.built++;
+
+        if (budgetMs >= 0) {
+            std::chrono::duration<double, std::milli> spent = std::chrono::steady_clock::now() - begin;
+            if (spent.count() >= budgetMs)
+                break;
+        }
+    }
+    return scene.built == total ? 1 : 0;
+}
+
+// vertex of the aim line
+struct AimVertex
+{
+    float x, y, z;
+    D3DCOLOR color;
+};
+
+// draw the predicted red ball path as an unlit line strip just above the table
+void drawAimPreview(IDirect3DDevice9* pDevice, const D3DXMATRIX& mWorld)
+{
+    AimVertex vertices[CAimPreview::MAX_BOUNCES + 2];
+    int count = g_aim.getPointCount();
+    if (count < 2)
+        return;
+
+    for (int i = 0; i < count; i++) {
+        vertices[i].x = g_aim.getPointX(i);
+        vertices[i].y = (float)M_RADIUS;
+        vertices[i].z = g_aim.getPointZ(i);
+        vertices[i].color = D3DCOLOR_XRGB(255, 255, 0);
+    }
+
+    pDevice->SetTransform(D3DTS_WORLD, &mWorld);
+    pDevice->SetRenderState(D3DRS_LIGHTING, FALSE);
+    pDevice->SetFVF(D3DFVF_XYZ | D3DFVF_DIFFUSE);
+    pDevice->DrawPrimitiveUP(D3DPT_LINESTRIP, count - 1, vertices, sizeof(AimVertex));
+    pDevice->SetRenderState(D3DRS_LIGHTING, TRUE);
 }
 
 // initialization
@@ -578,38 +535,22 @@ bool Setup()
     D3DXMatrixIdentity(&g_mView);
     D3DXMatrixIdentity(&g_mProj);
 
-    // create plane and set the position
-    if (false == g_legoPlane.create(Device, -1, -1, 6, 0.03f, 9, d3d::GREEN)) return false;
-    g_legoPlane.setPosition(0.0f, -0.0006f / 5, 0.0f);
-
-    // create walls and set the position. note that there are four walls
-    if (false == g_legowall[0].create(Device, -1, -1, 6.24f, 0.3f, 0.12f, d3d::DARKRED)) return false;
-    g_legowall[0].setPosition(0.0f, 0.12f, -4.5f);  // 
-    if (false == g_legowall[1].create(Device, -1, -1, 0.12f, 0.3f, 9, d3d::DARKRED)) return false;
-    g_legowall[1].setPosition(-3.06f, 0.12f, 0.0f);  // 
-    if (false == g_legowall[2].create(Device, -1, -1, 0.12f, 0.3f, 9, d3d::DARKRED)) return false;
-    g_legowall[2].setPosition(3.06f, 0.12f, 0.0f); // 
-    if (false == g_legowall[3].create(Device, -1, -1, 6.24f, 0.3f, 0.12f, d3d::DARKRED)) return false;
-    g_legowall[3].setPosition(0.0f, 0.12f, 4.5f);   // Ʒ
-
-    // create balls and set the position
-    for (int i = 0;i < 36;i++) {
-        g_sphere.push_back(CSphere());
-        if (false == g_sphere[i].create(Device, sphereColor)) {
-            return false;
-        }
-        else {
-            g_sphere[i].setCenter(spherePos[i][0], (float)M_RADIUS, spherePos[i][1]);
-            g_sphere[i].setPower(0, 0);
-            spherenum++;
-        }
-    }
+    g_session.reset();
+    g_aim.invalidate();
+
+    // create plane, walls and balls of the current table at once
+    if (buildScene(g_scene[g_front], g_session, -1) != 1)
+        return false;
 
     // create white and red ball for set direction
     if (false == g_whiteball.create(Device, d3d::WHITE)) return false;
-    g_whiteball.setCenter(.0f, (float)M_RADIUS, 4.2f);
+    syncBall(g_whiteball, g_session.getWhiteBall());
     if (false == g_target_redball.create(Device, d3d::RED)) return false;
-    g_target_redball.setCenter(g_whiteball.getCenter().x, (float)M_RADIUS, 3.78f);
+    syncBall(g_target_redball, g_session.getRedBall());
+    if (false == g_extraBalls.create(Device, (float)M_RADIUS, d3d::RED)) return false;
+    g_particles.reserve(100000);
+    g_particles.clear();
+    if (false == g_particleBatch.create(Device, 32768, 0.08f)) return false;
 
     // light setting 
     D3DLIGHT9 lit;
@@ -627,9 +568,9 @@ bool Setup()
         return false;
 
     // Position and aim the camera.
-    D3DXVECTOR3 pos(0.0f, 15.0f, 0.0f);   // ī޶ Y=10 ġ ̰, XZ 鿡 ߾ӿ ġ
-    D3DXVECTOR3 target(0.0f, 0.0f, 0.0f); // ī޶ (0, 0, 0)  ٺ (籸 ߾)
-    D3DXVECTOR3 up(0.0f, 0.0f, -1.0f);    // ī޶ ""  -Z  Ͽ, 籸 ٺ 
+    D3DXVECTOR3 pos(0.0f, 15.0f, 0.0f);   // 카메라는 Y=10의 위치에 놓이고, XZ 평면에서 중앙에 배치됨
+    D3DXVECTOR3 target(0.0f, 0.0f, 0.0f); // 카메라는 (0, 0, 0)을 향해 내려다봄 (당구판의 중앙)
+    D3DXVECTOR3 up(0.0f, 0.0f, -1.0f);    // 카메라의 "위쪽" 방향을 -Z축 방향으로 설정하여, 당구판을 내려다보도록 함
 
 
     D3DXMatrixLookAtLH(&g_mView, &pos, &target, &up);
@@ -640,6 +581,10 @@ bool Setup()
         (float)Width / (float)Height, 1.0f, 100.0f);
     Device->SetTransform(D3DTS_PROJECTION, &g_mProj);
 
+    // the camera does not move after this, only g_mWorld does : the objects
+    // are tested in world space against fixed planes
+    g_frustum.extract(g_mView * g_mProj);
+
     // Set render states.
     Device->SetRenderState(D3DRS_LIGHTING, TRUE);
     Device->SetRenderState(D3DRS_SPECULARENABLE, TRUE);
@@ -647,103 +592,213 @@ bool Setup()
 
     g_light.setLight(Device, g_mWorld);
 
-    start = true;
-
     return true;
 }
 
 void Cleanup(void)
 {
-    g_legoPlane.destroy();
-    for (int i = 0; i < 4; i++) {
-        g_legowall[i].destroy();
-    }
-    destroyAllLegoBlock();
+    destroyScene(g_scene[0]);
+    destroyScene(g_scene[1]);
+    g_target_redball.destroy();
+    g_whiteball.destroy();
+    g_extraBalls.destroy();
+    g_particleBatch.destroy();
     g_light.destroy();
 }
 
+// start building the next table in the background. a press while a table is
+// still loading is ignored; the window title says so until it is swapped in
+void requestLevel(const char* path, bool generate, unsigned seed)
+{
+    if (g_pending == NULL)
+        g_loader.start(path, generate, seed);
+}
+
+// frame boundary : pick up a world from the loader, build its render objects
+// in slices and swap it in once they are all there
+void updateLevelLoad(void)
+{
+    if (g_pending == NULL) {
+        bool failed;
+        g_pending = g_loader.take(&failed);
+        if (failed)
+            ::MessageBox(0, "Level file - FAILED", 0, 0);
+        if (g_pending == NULL)
+            return;
+    }
+
+    TableScene& back = g_scene[1 - g_front];
+    int built = buildScene(back, g_pending->session, SCENE_BUILD_MS);
+    if (built < 0) {
+        ::MessageBox(0, "Level objects - FAILED", 0, 0);
+        destroyScene(back);
+        delete g_pending;
+        g_pending = NULL;
+        return;
+    }
+    if (built == 0)
+        return;
+
+    // the session already sits in the level's start layout. the old level
+    // is only freed after g_session stopped pointing at it
+    g_session = std::move(g_pending->session);
+    g_session.setConfig(g_config);
+    delete g_world;
+    g_world = g_pending;
+    g_pending = NULL;
+
+    destroyScene(g_scene[g_front]);
+    g_front = 1 - g_front;
+    g_whiteBallInput = 0;
+    g_aim.invalidate();
+    syncBall(g_target_redball, g_session.getRedBall());
+    syncBall(g_whiteball, g_session.getWhiteBall());
+
+    // a recording belongs to one brick layout
+    if (!g_telemetryPath.empty()) {
+        if (!g_telemetry.open(g_telemetryPath.c_str(), g_session))
+            ::MessageBox(0, "Telemetry file - FAILED", 0, 0);
+        g_telemetryPath.clear();
+    }
+    else if (g_telemetry.isOpen()) {
+        printf("new table : telemetry stopped\n");
+        g_telemetry.close();
+    }
+    g_export.setLayout(g_session);
+}
+
+// frame pacing, called by d3d::EnterMsgLoop before it reads the messages of a
+// frame, so input arriving during the wait still makes it into that frame
+void WaitForFrame(void)
+{
+    g_pacer.waitForFrame();
+}
+
+// one arrow key press moves the hit point on the ball by this much spin
+const float SPIN_STEP = 0.25f;
+
+// arrow keys aim the cue at a point off the ball's center : up / down give
+// follow or draw, left / right side spin, and with shift held masse
+void adjustShotSpin(WPARAM key)
+{
+    bool shift = (::GetKeyState(VK_SHIFT) & 0x8000) != 0;
+    float* value = key == VK_UP || key == VK_DOWN ? &g_shotSpin.follow : shift ? &g_shotSpin.masse : &g_shotSpin.side;
+    float delta = key == VK_UP || key == VK_RIGHT ? SPIN_STEP : -SPIN_STEP;
+    *value = std::min(1.0f, std::max(-1.0f, *value + delta));
+}
+
+// the app has no console : the statistics go to the window title, once a second
+void showStats(void)
+{
+    static DWORD lastShown = 0;
+    DWORD now = timeGetTime();
+    if (now - lastShown < 1000 || g_cullStats.frames == 0)
+        return;
+    lastShown = now;
+
+    char title[256];
+    int length = snprintf(title, sizeof(title), "Virtual Billiard - %.1f objects drawn, %.1f culled per frame",
+        (double)g_cullStats.visible / g_cullStats.frames, (double)g_cullStats.culled / g_cullStats.frames);
+    g_cullStats.frames = g_cullStats.visible = g_cullStats.culled = 0;
+    if (g_pacer.getSampleCount() > 0 && length > 0 && length < (int)sizeof(title)) {
+        snprintf(title + length, sizeof(title) - length, " - input latency mean %.1f ms, p95 %.1f ms, max %.1f ms",
+            g_pacer.getMeanMs(), g_pacer.getPercentileMs(95), g_pacer.getMaxMs());
+    }
+    length = (int)strlen(title);
+    if (g_config.spin && length < (int)sizeof(title)) {
+        snprintf(title + length, sizeof(title) - length, " - spin follow %.2f side %.2f masse %.2f",
+            g_shotSpin.follow, g_shotSpin.side, g_shotSpin.masse);
+    }
+    length = (int)strlen(title);
+    if ((g_pending != NULL || g_loader.isBusy()) && length < (int)sizeof(title))
+        snprintf(title + length, sizeof(title) - length, " - loading level");
+    D3DDEVICE_CREATION_PARAMETERS params;
+    if (SUCCEEDED(Device->GetCreationParameters(&params)))
+        ::SetWindowText(params.hFocusWindow, title);
+}
 
 // timeDelta represents the time between the current image frame and the last image frame.
 // the distance of moving balls should be "velocity * timeDelta"
 bool Display(float timeDelta)
 {
     int i = 0;
-    int j = 0;
-    int k = 0;
 
-    if (restart) {
+    if (g_session.isRestart()) {
         printf("restart\n");
         Cleanup();
         if (!Setup())
         {
-            printf("setup \n");
+            printf("setup 실패\n");
             ::MessageBox(0, "Setup() - FAILED", 0, 0);
             return 0;
         }
-        printf("setupϷ\n");
-        restart = false;
-        printf("restart = false\n");
+        printf("setup완료\n");
         return true;
     }
-    else if (complete) {
+    else if (g_session.isComplete()) {
         printf("success");
         return false;
     }
     if (Device)
     {
-        Device->Clear(0, 0, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, 0x00afafaf, 1.0f, 0);
-        Device->BeginScene();
-
-        // update the position of each ball. during update, check whether each ball hit by walls.
-
-        D3DXVECTOR3 redcoord = g_target_redball.getCenter();
-        D3DXVECTOR3 whitecoord = g_whiteball.getCenter();
+        updateLevelLoad();
 
-        g_target_redball.ballUpdate(timeDelta);
-        g_whiteball.ballUpdate(timeDelta);
-
-        if (start) {
-            g_target_redball.setCenter(whitecoord.x, redcoord.y, redcoord.z);
+        // a saved config file takes effect between two steps, on the running table
+        if (g_configWatcher.poll(g_config)) {
+            g_session.setConfig(g_config);
+            g_aim.invalidate();
+            printf("physics config reloaded\n");
         }
 
-        for (k = 0; k < 4; k++) {
-            if (g_legowall[k].hasIntersected(g_target_redball)) {
-                g_legowall[k].hitBy(g_target_redball);
-            }
+        // apply the mouse input gathered since the last frame as late as possible
+        if (g_whiteBallInput != 0) {
+            g_session.moveWhiteBall(g_whiteBallInput);
+            g_whiteBallInput = 0;
         }
-        if (!restart) {
-            // check whether any two balls hit together and update the direction of redball
-            for (i = 0;i < spherenum; i++) {
-                if (g_sphere[i].hasIntersected(g_target_redball)) {
-                    g_sphere[i].hitBy(g_target_redball);
-                    g_sphere[i].destroy();
-                    g_sphere.erase(g_sphere.begin() + i);
-                    spherenum--;
-                }
-            }
+        g_pacer.consumeInput();
 
-            if (g_whiteball.hasIntersected(g_target_redball)) {
-                g_whiteball.hitBy(g_target_redball);
-            }
-        }
-        if (spherenum == 0) {
-            complete = true;
-        }
+        Device->Clear(0, 0, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, 0x00afafaf, 1.0f, 0);
+        Device->BeginScene();
+
+        // update the position of each ball, bounce off walls and bricks
+        g_session.step(timeDelta);
+        g_telemetry.record(g_session, timeDelta);
+        g_export.publish(g_session, timeDelta);
+        emitBrickParticles();
+        g_particles.update(timeDelta);
+
+        syncBall(g_target_redball, g_session.getRedBall());
+        syncBall(g_whiteball, g_session.getWhiteBall());
 
         // draw plane, walls, and spheres
-        g_legoPlane.draw(Device, g_mWorld);
-        for (i = 0;i < 3;i++) {
-            g_legowall[i].draw(Device, g_mWorld);
+        const TableScene& scene = g_scene[g_front];
+        g_renderQueue.clear();
+        scene.plane.enqueue(g_renderQueue);
+        for (i = 0;i < (int)scene.walls.size();i++) {
+            scene.walls[i].enqueue(g_renderQueue);
+        }
+        for (i = 0;i < (int)scene.bricks.size();i++) {
+            if (g_session.isBrickAlive(i))
+                scene.bricks[i].enqueue(g_renderQueue);
         }
-        for (i = 0;i < spherenum;i++) {
-            g_sphere[i].draw(Device, g_mWorld);
+        g_target_redball.enqueue(g_renderQueue);
+        g_whiteball.enqueue(g_renderQueue);
+        g_renderQueue.flush(Device, g_mWorld, &g_frustum);
+        g_extraBalls.draw(Device, g_mWorld, g_session.getExtraBalls(), g_session.getExtraBallCount(), &g_frustum);
+        g_cullStats.frames++;
+        g_cullStats.visible += g_renderQueue.getDrawCount() + g_extraBalls.getVisibleCount();
+        g_cullStats.culled += g_renderQueue.getCulledCount() + g_extraBalls.getCulledCount();
+        g_particleBatch.draw(Device, g_mWorld, g_particles);
+        if (g_session.isStarted()) {
+            g_aim.update(g_session);
+            drawAimPreview(Device, g_mWorld);
         }
-        g_target_redball.draw(Device, g_mWorld);
-        g_whiteball.draw(Device, g_mWorld);
         g_light.draw(Device);
 
         Device->EndScene();
         Device->Present(0, 0, 0, 0);
+        g_pacer.framePresented();
+        showStats();
         Device->SetTexture(0, NULL);
     }
     return true;
@@ -767,32 +822,30 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
     {
         switch (wParam) {
         case VK_ESCAPE:
-            ::DestroyWindow(hwnd);    // ESC Ű   
+            ::DestroyWindow(hwnd);    // ESC 키가 눌리면 윈도우 종료
             break;
         case VK_RETURN:
             if (NULL != Device) {
                 wire = !wire;
                 Device->SetRenderState(D3DRS_FILLMODE,
-                    (wire ? D3DFILL_WIREFRAME : D3DFILL_SOLID));    // Enter Ű ̾  ȯ
+                    (wire ? D3DFILL_WIREFRAME : D3DFILL_SOLID));    // Enter 키로 와이어프레임 모드 전환
             }
             break;
-        case VK_SPACE:    // space Ű  redball ߻
-            start = false;
-
-            D3DXVECTOR3 targetpos = g_target_redball.getCenter();
-            D3DXVECTOR3 whitepos = g_whiteball.getCenter();
-
-            double theta = acos(sqrt(pow(targetpos.x - whitepos.x, 2)) / sqrt(pow(targetpos.x - whitepos.x, 2) +
-                pow(targetpos.z - whitepos.z, 2)));      // ⺻ 1 и
-            if (targetpos.z - whitepos.z <= 0 && targetpos.x - whitepos.x >= 0) { theta = -theta; }   //4 и
-            if (targetpos.z - whitepos.z >= 0 && targetpos.x - whitepos.x <= 0) { theta = PI - theta; } //2 и
-            if (targetpos.z - whitepos.z <= 0 && targetpos.x - whitepos.x <= 0) { theta = PI + theta; } // 3 и
-
-            double distance = sqrt(pow(targetpos.x - whitepos.x, 2) + pow(targetpos.z - whitepos.z, 2));
-
-            double speedMultiplier = 3;
-            g_target_redball.setPower(distance * cos(theta) * speedMultiplier, -distance * sin(theta) * speedMultiplier);
-
+        case VK_SPACE:    // space 키 누르면 redball 발사
+            g_session.setShotSpin(g_shotSpin);
+            g_session.shoot();
+            break;
+        case VK_UP:
+        case VK_DOWN:
+        case VK_LEFT:
+        case VK_RIGHT:
+            adjustShotSpin(wParam);
+            break;
+        case 'L':    // load the -level file again, in the background
+            requestLevel(g_levelPath.c_str(), false, 0);
+            break;
+        case 'G':    // generate the next layout on the same table, in the background
+            requestLevel(g_levelPath.c_str(), true, ++g_levelSeed);
             break;
 
         }
@@ -839,17 +892,9 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
             if (LOWORD(wParam) & MK_RBUTTON) {
                 dx = (new_x - old_x);// * 0.01f;
 
-                D3DXVECTOR3 whitecoord = g_whiteball.getCenter();
-
-                if ((whitecoord.x + dx * (-0.01f)) < -3.0f + M_RADIUS) {
-                    g_whiteball.setCenter(-3.0f + M_RADIUS, whitecoord.y, whitecoord.z);
-                }
-                else if ((whitecoord.x + dx * (-0.01f)) <= 3.0f - M_RADIUS) {
-                    g_whiteball.setCenter(whitecoord.x + dx * (-0.01f), whitecoord.y, whitecoord.z);
-                }
-                else {
-                    g_whiteball.setCenter(3.0f - M_RADIUS, whitecoord.y, whitecoord.z);
-                }
+                // applied by the next Display(), right before the physics step
+                g_whiteBallInput += dx;
+                g_pacer.markInput();
             }
             old_x = new_x;
 
@@ -861,6 +906,25 @@ LRESULT CALLBACK d3d::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
     return ::DefWindowProc(hwnd, msg, wParam, lParam);
 }
 
+// finds "name <value>" in the command line and copies the value
+bool getOption(const char* cmdLine, const char* name, char* value, size_t size)
+{
+    const char* p = strstr(cmdLine, name);
+    if (p == NULL || size == 0)
+        return false;
+    p += strlen(name);
+    while (*p == ' ')
+        p++;
+
+    size_t n = 0;
+    while (p[n] != '\0' && p[n] != ' ' && n + 1 < size) {
+        value[n] = p[n];
+        n++;
+    }
+    value[n] = '\0';
+    return n > 0;
+}
+
 int WINAPI WinMain(HINSTANCE hinstance,
     HINSTANCE prevInstance,
     PSTR cmdLine,
@@ -868,9 +932,9 @@ int WINAPI WinMain(HINSTANCE hinstance,
 {
     srand(static_cast<unsigned int>(time(NULL)));
 
-    // ܼ â Ҵ
+    // 콘솔 창 할당
     //AllocConsole();
-    //freopen("CONOUT$", "w", stdout);  // printf  ַܼ  
+    //freopen("CONOUT$", "w", stdout);  // printf 출력이 콘솔로 가도록 설정
 
     if (!d3d::InitD3D(hinstance,
         Width, Height, true, D3DDEVTYPE_HAL, &Device))
@@ -879,15 +943,61 @@ int WINAPI WinMain(HINSTANCE hinstance,
         return 0;
     }
 
+    // -config <file> : physics values, reloaded whenever the file changes
+    char option[MAX_PATH];
+    defaultPhysicsConfig(g_config);
+    if (getOption(cmdLine, "-config", option, sizeof(option))) {
+        if (!g_configWatcher.open(option, g_config))
+            ::MessageBox(0, "Config file - FAILED", 0, 0);
+        g_session.setConfig(g_config);
+    }
+
+    // -level <file> : play a custom table instead of the stock one
+    // -generate <seed> : replace the bricks with a generated layout on the same table
+    // both load in the background while the stock table is already on screen
+    bool generate = false;
+    if (getOption(cmdLine, "-level", option, sizeof(option)))
+        g_levelPath = option;
+    if (getOption(cmdLine, "-generate", option, sizeof(option))) {
+        g_levelSeed = (unsigned)strtoul(option, NULL, 10);
+        generate = true;
+    }
+    if (!g_levelPath.empty() || generate)
+        requestLevel(g_levelPath.c_str(), generate, g_levelSeed);
+
     if (!Setup())
     {
         ::MessageBox(0, "Setup() - FAILED", 0, 0);
         return 0;
     }
 
-    d3d::EnterMsgLoop(Display);
+    // -telemetry <file> : record every step for offline analysis
+    if (getOption(cmdLine, "-telemetry", option, sizeof(option))) {
+        if (g_loader.isBusy())
+            g_telemetryPath = option;
+        else if (!g_telemetry.open(option, g_session))
+            ::MessageBox(0, "Telemetry file - FAILED", 0, 0);
+    }
+
+    // -export <name> : publish every step for viewers and tools (stateInspect).
+    // a table still loading replaces the layout when it arrives
+    if (getOption(cmdLine, "-export", option, sizeof(option))) {
+        if (!g_export.open(option, g_session))
+            ::MessageBox(0, "State export - FAILED", 0, 0);
+    }
+
+    // -fps <n> : cap the frame rate. the wait happens before input is read
+    // (the latency statistics are shown in the window title)
+    if (getOption(cmdLine, "-fps", option, sizeof(option)))
+        g_pacer.setTargetFps((float)atof(option));
+
+    d3d::EnterMsgLoop(Display, &g_config.clockScale, WaitForFrame);
 
+    g_telemetry.close();
+    g_export.close();
     Cleanup();
+    delete g_pending;
+    delete g_world;
 
     Device->Release();
 
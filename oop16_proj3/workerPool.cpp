@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: workerPool.cpp
+//
+// Desc: Worker threads that share the chunks of a loop.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "workerPool.h"
+
+CWorkerPool::CWorkerPool(int threadCount)
+{
+    m_generation = 0;
+    m_busy = 0;
+    m_quit = false;
+    m_job = NULL;
+    m_user = NULL;
+    m_count = 0;
+    m_chunk = 1;
+    m_next = 0;
+
+    if (threadCount <= 0)
+        threadCount = (int)std::thread::hardware_concurrency();
+    if (threadCount <= 0)
+        threadCount = 1;
+
+    // the thread calling run() is one of the workers
+    for (int i = 1; i < threadCount; i++)
+        m_workers.push_back(std::thread(&CWorkerPool::workerLoop, this));
+}
+
+CWorkerPool::~CWorkerPool(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for (size_t i = 0; i < m_workers.size(); i++)
+        m_workers[i].join();
+}
+
+void CWorkerPool::run(int count, int chunk, WorkerJob job, void* user)
+{
+    if (count <= 0)
+        return;
+    if (chunk < 1)
+        chunk = 1;
+
+    // a range that fits one chunk is not worth waking anybody
+    if (m_workers.empty() || count <= chunk) {
+        job(0, count, user);
+        return;
+    }
+
+    m_job = job;
+    m_user = user;
+    m_count = count;
+    m_chunk = chunk;
+    m_next = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_busy = (int)m_workers.size();
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busy == 0; });
+}
+
+void CWorkerPool::workerLoop(void)
+{
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this, seen] { return m_quit || m_generation != seen; });
+            if (m_quit)
+                return;
+            seen = m_generation;
+        }
+
+        runChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy--;
+        }
+        m_done.notify_one();
+    }
+}
+
+void CWorkerPool::runChunks(void)
+{
+    for (;;) {
+        int begin = m_next.fetch_add(m_chunk);
+        if (begin >= m_count)
+            break;
+        int end = begin + m_chunk < m_count ? begin + m_chunk : m_count;
+        m_job(begin, end, m_user);
+    }
+}
@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: workerPool.h
+//
+// Desc: Pool of worker threads for data parallel loops. run() splits a range
+//       of items into chunks that the threads, the calling one included,
+//       take one by one until none are left. CSessionScheduler,
+//       CSpatialIndex and CSoftRenderer each own one.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __workerPoolH__
+#define __workerPoolH__
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// does items [begin, end) of a run()
+typedef void (*WorkerJob)(int begin, int end, void* user);
+
+class CWorkerPool {
+public:
+    // threadCount <= 0 picks one thread per hardware core
+    explicit CWorkerPool(int threadCount = 0);
+    ~CWorkerPool(void);
+
+    // threads that work on a run(), the calling one included
+    int getThreadCount(void) const { return (int)m_workers.size() + 1; }
+
+    // job over items [0, count) in chunks of 'chunk' items. the calling thread
+    // works too and returns when all are done; a range that fits one chunk
+    // runs on the calling thread alone. not to be called from a job
+    void run(int count, int chunk, WorkerJob job, void* user);
+
+private:
+    CWorkerPool(const CWorkerPool&);
+    CWorkerPool& operator=(const CWorkerPool&);
+
+    void workerLoop(void);
+    void runChunks(void);
+
+    std::vector<std::thread>    m_workers;
+    std::mutex                  m_mutex;
+    std::condition_variable     m_wake;
+    std::condition_variable     m_done;
+    unsigned                    m_generation;
+    int                         m_busy;
+    bool                        m_quit;
+
+    WorkerJob                   m_job;
+    void*                       m_user;
+    int                         m_count;
+    int                         m_chunk;
+    std::atomic<int>            m_next;
+};
+
+#endif // __workerPoolH__
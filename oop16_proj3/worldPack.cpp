@@ -0,0 +1,560 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: worldPack.cpp
+//
+// Desc: Lane-interleaved stepping of many stock tables.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "worldPack.h"
+#include <cmath>
+#include <cstring>
+
+// the brick mask has one bit per stock brick
+static_assert(BRICK_COUNT <= 64, "stock bricks must fit in a BrickMask");
+
+#ifdef PHYSICS_FIXED_POINT
+
+// one fixed-point CGameSession per world. the lanes below are float code and
+// would not match it
+
+CWorldPack::CWorldPack(int worldCount)
+{
+    m_worldCount = worldCount > 0 ? worldCount : 0;
+    m_sessions.resize(m_worldCount);
+    defaultPhysicsConfig(m_config);
+    setConfig(m_config);
+}
+
+void CWorldPack::reset(int world)
+{
+    m_sessions[world].reset();
+}
+
+void CWorldPack::resetAll(void)
+{
+    for (int w = 0; w < m_worldCount; w++)
+        reset(w);
+}
+
+void CWorldPack::moveWhiteBall(int world, float dx)
+{
+    m_sessions[world].moveWhiteBall(dx);
+}
+
+void CWorldPack::shoot(int world)
+{
+    ShotSpin none = { 0, 0, 0 };
+    shoot(world, none);
+}
+
+void CWorldPack::shoot(int world, const ShotSpin& spin)
+{
+    m_sessions[world].setShotSpin(spin);
+    m_sessions[world].shoot();
+}
+
+void CWorldPack::setConfig(const PhysicsConfig& config)
+{
+    m_config = config;
+    for (int w = 0; w < m_worldCount; w++)
+        m_sessions[w].setConfig(config);
+}
+
+void CWorldPack::step(float timeDelta)
+{
+    for (int w = 0; w < m_worldCount; w++)
+        m_sessions[w].step(timeDelta);
+}
+
+BallState CWorldPack::getRedBall(int world) const
+{
+    return m_sessions[world].getRedBall();
+}
+
+BallState CWorldPack::getWhiteBall(int world) const
+{
+    return m_sessions[world].getWhiteBall();
+}
+
+unsigned long long CWorldPack::getBrickMask(int world) const
+{
+    unsigned long long mask = 0;
+    for (int i = 0; i < BRICK_COUNT; i++) {
+        if (m_sessions[world].isBrickAlive(i))
+            mask |= 1ull << i;
+    }
+    return mask;
+}
+
+#else // PHYSICS_FIXED_POINT
+
+// mask ? a : b for a mask of all ones or all zeros, on the bits. gcc keeps a
+// loop with a ?: on floats after a long inlined body scalar; this vectorizes
+static inline float laneSelect(int mask, float a, float b)
+{
+    int ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    int bits = (ia & mask) | (ib & ~mask);
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+CWorldPack::CWorldPack(int worldCount)
+{
+    // same table as a stock CGameSession
+    CGameSession stock;
+    for (int k = 0; k < WALL_COUNT; k++) {
+        const WallState& wall = stock.getWall(k);
+        m_planes.nx[k] = wall.nx;
+        m_planes.nz[k] = wall.nz;
+        m_planes.d[k] = wall.d;
+    }
+    const WallState& right = stock.getWall(WALL_RIGHT);
+    const WallState& left = stock.getWall(WALL_LEFT);
+    m_minX = (float)(right.d * right.nx + M_RADIUS);
+    m_maxX = (float)(left.d * left.nx - M_RADIUS);
+    m_startX = stock.getWhiteBall().x;
+    m_startZ = stock.getWhiteBall().z;
+    PhysicsConfig config;
+    defaultPhysicsConfig(config);
+    setConfig(config);
+
+    m_worldCount = worldCount > 0 ? worldCount : 0;
+    m_blocks.resize((m_worldCount + LANES - 1) / LANES);
+    resetAll();
+}
+
+void CWorldPack::reset(int world)
+{
+    Block& b = m_blocks[world / LANES];
+    int l = world % LANES;
+
+    b.whiteX[l] = m_startX;
+    b.whiteZ[l] = m_startZ;
+    b.redX[l] = m_startX;
+    b.redZ[l] = m_startZ - (float)(M_RADIUS + M_RADIUS);
+    b.redVX[l] = 0;
+    b.redVZ[l] = 0;
+    b.redWX[l] = 0;
+    b.redWY[l] = 0;
+    b.redWZ[l] = 0;
+    b.alive[l] = BRICK_COUNT == 64 ? ~(BrickMask)0 : ((BrickMask)1 << BRICK_COUNT) - 1;
+    b.bricksLeft[l] = BRICK_COUNT;
+    b.start[l] = 1;
+    b.restart[l] = 0;
+    b.complete[l] = 0;
+    for (int k = 0; k < WALL_COUNT; k++)
+        b.warmWall[k][l] = 0;
+    b.warmWhite[l] = 0;
+}
+
+void CWorldPack::resetAll(void)
+{
+    for (int w = 0; w < m_worldCount; w++)
+        reset(w);
+
+    // unused lanes of the last block stay parked as finished worlds
+    for (int w = m_worldCount; w < (int)m_blocks.size() * LANES; w++) {
+        reset(w);
+        m_blocks[w / LANES].restart[w % LANES] = 1;
+    }
+}
+
+void CWorldPack::moveWhiteBall(int world, float dx)
+{
+    Block& b = m_blocks[world / LANES];
+    int l = world % LANES;
+    float x = b.whiteX[l] + dx * (-0.01f);
+
+    if (x < m_minX) {
+        b.whiteX[l] = m_minX;
+    }
+    else if (x <= m_maxX) {
+        b.whiteX[l] = x;
+    }
+    else {
+        b.whiteX[l] = m_maxX;
+    }
+}
+
+void CWorldPack::shoot(int world)
+{
+    Block& b = m_blocks[world / LANES];
+    int l = world % LANES;
+    b.start[l] = 0;
+    shotVelocity(b.redX[l], b.redZ[l], b.whiteX[l], b.whiteZ[l], m_config.shotSpeed, &b.redVX[l], &b.redVZ[l]);
+}
+
+void CWorldPack::shoot(int world, const ShotSpin& spin)
+{
+    shoot(world);
+    if (!m_config.spin)
+        return;
+    Block& b = m_blocks[world / LANES];
+    int l = world % LANES;
+    BallState ball = getRedBall(world);
+    applyShotSpin(ball, spin);
+    b.redWX[l] = ball.wx;
+    b.redWY[l] = ball.wy;
+    b.redWZ[l] = ball.wz;
+}
+
+BallState CWorldPack::getRedBall(int world) const
+{
+    const Block& b = m_blocks[world / LANES];
+    int l = world % LANES;
+    BallState ball = { b.redX[l], (float)M_RADIUS, b.redZ[l], b.redVX[l], b.redVZ[l], b.redWX[l], b.redWY[l], b.redWZ[l] };
+    return ball;
+}
+
+BallState CWorldPack::getWhiteBall(int world) const
+{
+    const Block& b = m_blocks[world / LANES];
+    int l = world % LANES;
+    BallState ball = { b.whiteX[l], (float)M_RADIUS, b.whiteZ[l], 0, 0, 0, 0, 0 };
+    return ball;
+}
+
+void CWorldPack::setConfig(const PhysicsConfig& config)
+{
+    m_config = config;
+    makeMotionModel(config, m_motion);
+}
+
+void CWorldPack::step(float timeDelta)
+{
+    // the part of the friction factor that only depends on the frame time
+    double rate = 1 - (1 - m_config.decreaseRate) * timeDelta * 400;
+    if (rate < 0)
+        rate = 0;
+
+    for (size_t i = 0; i < m_blocks.size(); i++)
+        stepBlock(m_blocks[i], timeDelta, rate);
+}
+
+// one step of LANES worlds. every loop below has a fixed trip count and no
+// early exits, so each one is a candidate for vectorization. the arithmetic
+// matches ballUpdate() and hasIntersected() in gameSession.cpp operation for
+// operation, so a packed world stays identical to a CGameSession
+void CWorldPack::stepBlock(Block& b, float timeDelta, double rate)
+{
+    const float timeScale = m_config.timeScale;
+    const double decreaseRate = m_config.decreaseRate;
+    const float minVelocity = m_config.minVelocity;
+    const float mul = m_config.slowBoost;
+    const float maxSpeed = m_config.maxSpeed;
+    const float radius = (float)M_RADIUS;
+    const float radiusSum = (float)(M_RADIUS + M_RADIUS);
+    const float reach2 = radiusSum * radiusSum;
+
+    int active[LANES];
+    int anyActive = 0;
+    for (int l = 0; l < LANES; l++) {
+        active[l] = !b.restart[l] & !b.complete[l];
+        anyActive |= active[l];
+    }
+    if (!anyActive)
+        return;
+
+    // integration (ballUpdate), then snap a waiting red ball to the white ball
+    if (m_config.analyticMotion)
+        advanceBlock(b, timeDelta, active);
+    else {
+        for (int l = 0; l < LANES; l++) {
+            float x = b.redX[l], z = b.redZ[l];
+            float vx = b.redVX[l], vz = b.redVZ[l];
+
+            bool moving = fabs(vx) > 0.01 || fabs(vz) > 0.01;
+            float nx = x + timeScale * timeDelta * vx;
+            float nz = z + timeScale * timeDelta * vz;
+            x = moving ? nx : x;
+            z = moving ? nz : z;
+            vx = moving ? vx : 0.0f;
+            vz = moving ? vz : 0.0f;
+
+            vx = (float)(vx * decreaseRate);
+            vz = (float)(vz * decreaseRate);
+            float newVelocityX = (float)(vx * rate);
+            float newVelocityZ = (float)(vz * rate);
+            vx = newVelocityX < minVelocity ? newVelocityX * mul : newVelocityX;
+            vz = newVelocityZ < minVelocity ? newVelocityZ * mul : newVelocityZ;
+
+            float currentSpeed = sqrt(newVelocityX * newVelocityX + newVelocityZ * newVelocityZ);
+            float speedFactor = maxSpeed / currentSpeed;
+            bool capped = currentSpeed > maxSpeed;
+            vx = capped ? newVelocityX * speedFactor : vx;
+            vz = capped ? newVelocityZ * speedFactor : vz;
+
+            x = b.start[l] ? b.whiteX[l] : x;
+            z = b.start[l] ? b.redZ[l] : z;
+
+            b.redX[l] = active[l] ? x : b.redX[l];
+            b.redZ[l] = active[l] ? z : b.redZ[l];
+            b.redVX[l] = active[l] ? vx : b.redVX[l];
+            b.redVZ[l] = active[l] ? vz : b.redVZ[l];
+        }
+    }
+
+    // cloth friction of spinning balls (spinFriction), on the same lanes
+    if (m_config.spin) {
+        const float slide = m_config.slideFriction * timeDelta;
+        const float spinDecay = m_config.spinFriction * timeDelta;
+        for (int l = 0; l < LANES; l++) {
+            float vx = b.redVX[l], vz = b.redVZ[l];
+            float wx = b.redWX[l], wy = b.redWY[l], wz = b.redWZ[l];
+            spinFriction(vx, vz, wx, wy, wz, radius, slide, spinDecay);
+            int mask = -active[l];
+            b.redVX[l] = laneSelect(mask, vx, b.redVX[l]);
+            b.redVZ[l] = laneSelect(mask, vz, b.redVZ[l]);
+            b.redWX[l] = laneSelect(mask, wx, b.redWX[l]);
+            b.redWY[l] = laneSelect(mask, wy, b.redWY[l]);
+            b.redWZ[l] = laneSelect(mask, wz, b.redWZ[l]);
+        }
+    }
+
+    // wall test (wallPenetration), one bit per wall
+    int walls[LANES];
+    for (int l = 0; l < LANES; l++) {
+        int mask = 0;
+        for (int k = 0; k < WALL_COUNT; k++) {
+            float penetration = radius - (m_planes.nx[k] * b.redX[l] + m_planes.nz[k] * b.redZ[l] - m_planes.d[k]);
+            mask |= (penetration > 0.0f) << k;
+        }
+        walls[l] = mask;
+    }
+
+    // brick test, one bit per live brick touched
+    BrickMask bricks[LANES];
+    for (int l = 0; l < LANES; l++)
+        bricks[l] = 0;
+    for (int i = 0; i < BRICK_COUNT; i++) {
+        float bx = spherePos[i][0];
+        float bz = spherePos[i][1];
+        for (int l = 0; l < LANES; l++) {
+            float dx = bx - b.redX[l];
+            float dz = bz - b.redZ[l];
+            bricks[l] |= (BrickMask)(dx * dx + dz * dz <= reach2) << i;
+        }
+    }
+
+    // white ball test. touching it only matters when the red ball moves,
+    // since the bounce of a ball at rest changes nothing
+    int white[LANES];
+    for (int l = 0; l < LANES; l++) {
+        float dx = b.whiteX[l] - b.redX[l];
+        float dz = b.whiteZ[l] - b.redZ[l];
+        white[l] = (dx * dx + dz * dz <= reach2) & ((b.redVX[l] != 0.0f) | (b.redVZ[l] != 0.0f));
+    }
+
+    // contacts are rare : only those lanes leave the packed path
+    for (int l = 0; l < LANES; l++) {
+        BrickMask hit = bricks[l] & b.alive[l];
+        if (active[l] && (walls[l] | hit | white[l])) {
+            resolveLane(b, l, hit, walls[l], white[l] != 0);
+        }
+        else {
+            // nothing touched, so nothing to warm start the solver from next step
+            for (int k = 0; k < WALL_COUNT; k++)
+                b.warmWall[k][l] = 0;
+            b.warmWhite[l] = 0;
+        }
+    }
+}
+
+// integration by the closed-form model. it needs a log and an exp per moving
+// ball, so this runs lane by lane
+void CWorldPack::advanceBlock(Block& b, float timeDelta, const int* active)
+{
+    for (int l = 0; l < LANES; l++) {
+        if (!active[l])
+            continue;
+        if (b.start[l]) {
+            b.redX[l] = b.whiteX[l];
+            continue;
+        }
+        BallState ball = { b.redX[l], (float)M_RADIUS, b.redZ[l], b.redVX[l], b.redVZ[l], 0, 0, 0 };
+        advanceBall(m_motion, ball, timeDelta);
+        b.redX[l] = ball.x;
+        b.redZ[l] = ball.z;
+        b.redVX[l] = ball.vx;
+        b.redVZ[l] = ball.vz;
+    }
+}
+
+// contact passes of CGameSession::step() for one lane : find every contact
+// first, then resolve them in the session's order (walls, bricks, white ball)
+void CWorldPack::resolveLane(Block& b, int l, BrickMask bricks, int walls, bool white)
+{
+    const float radius = (float)M_RADIUS;
+
+    Contact contacts[WALL_COUNT + BRICK_COUNT + 1];
+    int count = 0;
+
+    float x = b.redX[l];
+    float z = b.redZ[l];
+
+    for (int k = 0; k < WALL_COUNT; k++) {
+        if (!(walls >> k & 1))
+            continue;
+        Contact c = { m_planes.nx[k], m_planes.nz[k],
+            radius - (m_planes.nx[k] * x + m_planes.nz[k] * z - m_planes.d[k]), k, false };
+        contacts[count++] = c;
+    }
+    for (int i = 0; i < BRICK_COUNT + 1; i++) {
+        bool isBrick = i < BRICK_COUNT;
+        if (isBrick ? !(bricks >> i & 1) : !white)
+            continue;
+        float dx = x - (isBrick ? spherePos[i][0] : b.whiteX[l]);
+        float dz = z - (isBrick ? spherePos[i][1] : b.whiteZ[l]);
+        float distance = sqrt(dx * dx + dz * dz);
+        Contact c = { dx / distance, dz / distance, 0.0f, -1, !isBrick };
+        contacts[count++] = c;
+    }
+
+    bool restart = false;
+    if (m_config.solverIterations > 0) {
+        restart = solveLane(b, l, contacts, count);
+    }
+    else {
+        for (int i = 0; i < count; i++) {
+            const Contact& c = contacts[i];
+            float& vx = b.redVX[l];
+            float& vz = b.redVZ[l];
+
+            float normalSpeed = vx * c.nx + vz * c.nz;
+
+            if (c.wall < 0) {
+                float dot = c.nx * vx + c.nz * vz;
+                vx = -2 * c.nx * dot + vx;
+                vz = -2 * c.nz * dot + vz;
+                laneContactSpin(b, l, c, vx * c.nx + vz * c.nz - normalSpeed);
+                continue;
+            }
+
+            b.redX[l] += c.nx * c.penetration;
+            b.redZ[l] += c.nz * c.penetration;
+
+            if (c.wall == WALL_BOTTOM) {
+                restart = true;
+                continue;
+            }
+
+            float dotProduct = vx * c.nx + vz * c.nz;
+            if (dotProduct >= 0.0f)
+                continue;
+
+            float reflectionX = vx - 2 * dotProduct * c.nx;
+            float reflectionZ = vz - 2 * dotProduct * c.nz;
+            float minVelocity = m_config.minVelocity;
+            if (sqrt(reflectionX * reflectionX + reflectionZ * reflectionZ) < minVelocity) {
+                if (reflectionX != 0.0f)
+                    reflectionX = reflectionX > 0.0f ? minVelocity : -minVelocity;
+                if (reflectionZ != 0.0f)
+                    reflectionZ = reflectionZ > 0.0f ? minVelocity : -minVelocity;
+            }
+            vx = reflectionX;
+            vz = reflectionZ;
+            laneContactSpin(b, l, c, vx * c.nx + vz * c.nz - normalSpeed);
+        }
+    }
+
+    if (restart) {
+        b.restart[l] = 1;
+    }
+    else {
+        for (int i = 0; i < BRICK_COUNT; i++) {
+            if (bricks >> i & 1)
+                b.bricksLeft[l]--;
+        }
+        b.alive[l] &= ~bricks;
+    }
+
+    if (b.bricksLeft[l] == 0)
+        b.complete[l] = 1;
+}
+
+// the solver path of CGameSession::solveBallContacts() for one lane, with the
+// warm start impulses kept per wall and for the white ball. bricks vanish when
+// touched, so theirs are never needed again. returns whether the red ball
+// reached the bottom wall
+bool CWorldPack::solveLane(Block& b, int l, const Contact* contacts, int count)
+{
+    SolverContact solver[WALL_COUNT + BRICK_COUNT + 1];
+    bool restart = false;
+    for (int i = 0; i < count; i++) {
+        const Contact& c = contacts[i];
+        SolverContact& s = solver[i];
+        s.nx = c.nx;
+        s.nz = c.nz;
+        s.penetration = c.penetration;
+        s.bodyVX = 0;
+        s.bodyVZ = 0;
+        s.restitution = 1;
+        if (c.wall >= 0) {
+            s.flags = c.wall == WALL_BOTTOM ? SOLVE_POSITION : SOLVE_POSITION | SOLVE_VELOCITY;
+            s.impulse = b.warmWall[c.wall][l];
+            restart |= c.wall == WALL_BOTTOM;
+        }
+        else {
+            s.flags = SOLVE_VELOCITY;
+            s.impulse = c.white ? b.warmWhite[l] : 0;
+        }
+    }
+
+    BallState ball = { b.redX[l], (float)M_RADIUS, b.redZ[l], b.redVX[l], b.redVZ[l], b.redWX[l], b.redWY[l], b.redWZ[l] };
+    solveContacts(ball, solver, count, m_config.solverIterations);
+
+    bool bounced = false;
+    for (int k = 0; k < WALL_COUNT; k++)
+        b.warmWall[k][l] = 0;
+    b.warmWhite[l] = 0;
+    for (int i = 0; i < count; i++) {
+        const Contact& c = contacts[i];
+        if (solver[i].flags & SOLVE_VELOCITY)
+            contactSpin(ball, c, solver[i].impulse);
+        if (c.wall >= 0) {
+            b.warmWall[c.wall][l] = solver[i].impulse;
+            bounced |= c.wall != WALL_BOTTOM && solver[i].closing > 0;
+        }
+        else if (c.white) {
+            b.warmWhite[l] = solver[i].impulse;
+        }
+    }
+    float minVelocity = m_config.minVelocity;
+    if (bounced && sqrt(ball.vx * ball.vx + ball.vz * ball.vz) < minVelocity) {
+        if (ball.vx != 0.0f)
+            ball.vx = ball.vx > 0.0f ? minVelocity : -minVelocity;
+        if (ball.vz != 0.0f)
+            ball.vz = ball.vz > 0.0f ? minVelocity : -minVelocity;
+    }
+
+    b.redX[l] = ball.x;
+    b.redZ[l] = ball.z;
+    b.redVX[l] = ball.vx;
+    b.redVZ[l] = ball.vz;
+    b.redWY[l] = ball.wy;
+    return restart;
+}
+
+// CGameSession::contactSpin() : the paddle and the bricks stand still here
+void CWorldPack::contactSpin(BallState& ball, const Contact& c, float normalImpulse) const
+{
+    if (m_config.spin)
+        contactFriction(ball, c.nx, c.nz, 0.0f, 0.0f, normalImpulse, m_config.contactFriction);
+}
+
+void CWorldPack::laneContactSpin(Block& b, int l, const Contact& c, float normalImpulse) const
+{
+    if (!m_config.spin)
+        return;
+    BallState ball = { b.redX[l], (float)M_RADIUS, b.redZ[l], b.redVX[l], b.redVZ[l], b.redWX[l], b.redWY[l], b.redWZ[l] };
+    contactSpin(ball, c, normalImpulse);
+    b.redVX[l] = ball.vx;
+    b.redVZ[l] = ball.vz;
+    b.redWY[l] = ball.wy;
+}
+
+#endif // PHYSICS_FIXED_POINT
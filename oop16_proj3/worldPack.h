@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// File: worldPack.h
+//
+// Desc: Many independent copies of the stock table stepped together, for
+//       training runs that need millions of game steps. A single game is
+//       too small to keep a core busy, so worlds are stored lane-interleaved:
+//       blocks of LANES worlds, each field an array with one entry per world.
+//       Integration and the wall, brick and white ball tests run as straight
+//       loops over the lanes of a block, which the compiler turns into SIMD
+//       code. Only the few worlds that touched something in a step leave the
+//       packed path and resolve their contacts one by one, with exactly the
+//       rules of CGameSession::step().
+//
+//       The PHYSICS_FIXED_POINT build keeps the API but runs each world as
+//       its own CGameSession, since only the session has the Q16.16 rules.
+//       Worlds then stay bit-identical to a fixed-point CGameSession on any
+//       machine, at single-session speed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __worldPackH__
+#define __worldPackH__
+
+#include "gameSession.h"
+#include <vector>
+
+class CWorldPack {
+public:
+    enum { LANES = 8 };
+
+    explicit CWorldPack(int worldCount);
+
+    int getWorldCount(void) const { return m_worldCount; }
+
+    // same as CGameSession::reset / moveWhiteBall / shoot for one world
+    void reset(int world);
+    void resetAll(void);
+    void moveWhiteBall(int world, float dx);
+    void shoot(int world);
+    void shoot(int world, const ShotSpin& spin);
+
+    // physics values of every world, from the next step on
+    void setConfig(const PhysicsConfig& config);
+    const PhysicsConfig& getConfig(void) const { return m_config; }
+
+    // advance every world that has neither restarted nor completed
+    void step(float timeDelta);
+
+    BallState getRedBall(int world) const;
+    BallState getWhiteBall(int world) const;
+#ifdef PHYSICS_FIXED_POINT
+    bool isStarted(int world)  const { return m_sessions[world].isStarted(); }
+    bool isRestart(int world)  const { return m_sessions[world].isRestart(); }
+    bool isComplete(int world) const { return m_sessions[world].isComplete(); }
+    int  getBricksLeft(int world) const { return m_sessions[world].getBricksLeft(); }
+    bool isBrickAlive(int world, int brick) const { return m_sessions[world].isBrickAlive(brick); }
+    // bit i set : stock brick i is still on the table
+    unsigned long long getBrickMask(int world) const;
+
+private:
+    int                         m_worldCount;
+    std::vector<CGameSession>   m_sessions;
+    PhysicsConfig               m_config;
+#else
+    bool isStarted(int world)  const { return lane(world, &Block::start) != 0; }
+    bool isRestart(int world)  const { return lane(world, &Block::restart) != 0; }
+    bool isComplete(int world) const { return lane(world, &Block::complete) != 0; }
+    int  getBricksLeft(int world) const { return lane(world, &Block::bricksLeft); }
+    bool isBrickAlive(int world, int brick) const { return (lane(world, &Block::alive) >> brick & 1) != 0; }
+    // bit i set : stock brick i is still on the table
+    unsigned long long getBrickMask(int world) const { return lane(world, &Block::alive); }
+
+private:
+    typedef unsigned long long BrickMask;   // one bit per stock brick
+
+    struct Block
+    {
+        float       redX[LANES], redZ[LANES];
+        float       redVX[LANES], redVZ[LANES];
+        float       redWX[LANES], redWY[LANES], redWZ[LANES];
+        float       whiteX[LANES], whiteZ[LANES];
+        BrickMask   alive[LANES];
+        int         bricksLeft[LANES];
+        int         start[LANES];
+        int         restart[LANES];
+        int         complete[LANES];
+        float       warmWall[WALL_COUNT][LANES];    // contact solver impulses of the last step
+        float       warmWhite[LANES];
+    };
+
+    template<class T> T lane(int world, T (Block::*field)[LANES]) const
+    {
+        return (m_blocks[world / LANES].*field)[world % LANES];
+    }
+
+    void stepBlock(Block& block, float timeDelta, double rate);
+    void advanceBlock(Block& block, float timeDelta, const int* active);
+    // a contact of a lane's red ball. wall : WallId, or -1 for a brick or the white ball
+    struct Contact
+    {
+        float   nx, nz, penetration;
+        int     wall;
+        bool    white;
+    };
+
+    void resolveLane(Block& block, int l, BrickMask bricks, int walls, bool white);
+    bool solveLane(Block& block, int l, const Contact* contacts, int count);
+    void contactSpin(BallState& ball, const Contact& c, float normalImpulse) const;
+    void laneContactSpin(Block& block, int l, const Contact& c, float normalImpulse) const;
+
+    int                 m_worldCount;
+    std::vector<Block>  m_blocks;
+
+    PhysicsConfig       m_config;
+    MotionModel         m_motion;
+    WallPlanes          m_planes;
+    float               m_minX, m_maxX;     // white ball range
+    float               m_startX, m_startZ;
+#endif
+};
+
+#endif // __worldPackH__